@@ -0,0 +1,54 @@
+#include <stdlib.h>
+#include <string>
+
+#include "nvdla_task_scheduler.h"
+
+// Same traces and arguments as pipeline_execute, but (batch, stage) tasks are dispatched to
+// whichever NVDLA is free instead of a static wave front, see nvdla_task_scheduler.h.
+// usage: dynamic_pipeline_execute <trace_file_prefix> <batch_num> <stage_num> [nvdla_num] [pinned]
+// nvdla_num defaults to stage_num. With pinned = 1 (e.g., for the PipelineWeightPin and PipelineActPin
+// remappers), stage i always runs on NVDLA i, which needs nvdla_num = stage_num.
+
+int main(int argc, char *argv[]) {
+    if(argc < 4) {
+        printf("usage: %s <trace_file_prefix> <batch_num> <stage_num> [nvdla_num] [pinned]\n", argv[0]);
+        return 0;
+    }
+    std::string trace_file_prefix = std::string(argv[1]);
+
+    int batch_num = atoi(argv[2]);      // for lenet testcase, batch_num = 4
+    int stage_num = atoi(argv[3]);      // for lenet testcase, stage_num = 2
+    int nvdla_num = argc > 4 ? atoi(argv[4]) : stage_num;
+    bool pinned = argc > 5 && atoi(argv[5]);
+    if(pinned && nvdla_num != stage_num) {
+        printf("Pinned stages need one NVDLA per stage.\n");
+        return 0;
+    }
+
+    TraceArena arena(batch_num * stage_num);
+    NVDLATaskGraph graph;
+
+    // task (batch b, stage s) is b * stage_num + s
+    for(int b = 0; b < batch_num; b++) {
+        for(int s = 0; s < stage_num; s++) {
+            // batch id and stage id start from 1 in file names
+            std::string name = std::to_string(b + 1) + '_' + std::to_string(s + 1);
+            char* region = arena.region(b * stage_num + s);
+            uint32_t trace_size = get_trace_from_file(trace_file_prefix + name, region);
+            int t = graph.add_task("batch " + std::to_string(b + 1) + " stage " + std::to_string(s + 1),
+                                   (uint64_t)region, trace_size, s % nvdla_num, pinned);
+
+            // a stage needs the output of the previous one, and a stage reuses its intermediate
+            // activations for every batch, so batches go through a stage in order
+            if(s > 0) graph.add_dependency(t - 1, t);
+            if(b > 0) graph.add_dependency(t - stage_num, t);
+        }
+    }
+
+    WorkStealingScheduler scheduler(graph, nvdla_num);
+    scheduler.run();
+    printf("finished all ops\n");
+    scheduler.report();
+
+    return 0;
+}
@@ -72,17 +72,13 @@ int main(int argc, char *argv[]) {
         trace_sizes[i] = get_trace_from_file(dir, i, (char*)region_nvdlas[i]);
     }
 
-    bool need_waiting[4] = {false, false, false, false};
-
     for(int i = 0; i < worker_num; i++) {
         m5_start_accel_id((uint64_t)region_nvdlas[i], trace_sizes[i], (uint64_t)region_nvdlas[i], i);
-        need_waiting[i] = true;
     }
 
-    while(need_waiting[0] || need_waiting[1] || need_waiting[2] || need_waiting[3]) {
-        for(int i = 0; i < worker_num; i++) {
-            need_waiting[i] = m5_wait_accel_id(i);
-        }
+    // the CPU sleeps until each NVDLA is done instead of polling
+    for(int i = 0; i < worker_num; i++) {
+        while(m5_sleep_accel(1ULL << i));
     }
 
     return 0;
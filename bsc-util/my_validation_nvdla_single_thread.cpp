@@ -57,13 +57,17 @@ int main(int argc, char *argv[]) {
         fclose(fp);
     }
 
+    // run the same trace on NVDLA 0..num_nvdla-1, e.g. to measure how the throughput scales
+    int num_nvdla = argc > 3 ? atoi(argv[3]) : 1;
+
     printf("start_time = %f\n", wall_time());
-    m5_start_accel_id((uint64_t)region_nvdla, size, (uint64_t)region_nvdla, 0);
+    for (int i = 0; i < num_nvdla; i++)
+        m5_start_accel_id((uint64_t)region_nvdla, size, (uint64_t)region_nvdla, i);
 
 
-    bool needToWaitForNVDLA = true;
-    while (needToWaitForNVDLA)
-        needToWaitForNVDLA = m5_wait_accel_id(0);
+    // sleep instead of polling, the CPU is woken up when an NVDLA is done
+    for (int i = 0; i < num_nvdla; i++)
+        while (m5_sleep_accel(1ULL << i));
 
     printf("end_time = %f\n", wall_time());
     return 0;
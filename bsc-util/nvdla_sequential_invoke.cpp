@@ -59,17 +59,12 @@ int main(int argc, char *argv[]) {
     //! nvdla 0 running start
     m5_start_accel_id((uint64_t)region_nvdla_0, size, (uint64_t)region_nvdla_0, 0);
 
-    bool needToWaitForNVDLA = true;
-    while (needToWaitForNVDLA)
-        needToWaitForNVDLA = m5_wait_accel_id(0);
-
-    needToWaitForNVDLA = true;
+    while (m5_sleep_accel(1 << 0));
     //! nvdla 0 running complete
 
     //! nvdla 1 running start
     m5_start_accel_id((uint64_t)region_nvdla_1, size, (uint64_t)region_nvdla_1, 1);
-    while (needToWaitForNVDLA)
-        needToWaitForNVDLA = m5_wait_accel_id(1);
+    while (m5_sleep_accel(1 << 1));
     //! nvdla 1 running complete
 
     return 0;
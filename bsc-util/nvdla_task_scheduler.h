@@ -0,0 +1,272 @@
+#ifndef NVDLA_TASK_SCHEDULER_H
+#define NVDLA_TASK_SCHEDULER_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <deque>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "gem5/m5ops.h"
+
+#define REGION_NVDLA 1024*1024
+
+// Dynamic scheduling of NVDLA traces. The workload is a DAG of tasks (one trace each, e.g., one
+// (batch, stage) of a pipeline), and a task is launched on whichever NVDLA is free once all the
+// tasks it depends on have finished. Ready tasks go to the deque of their preferred NVDLA; an idle
+// NVDLA takes the oldest task of its own deque, or else steals the youngest one from the longest
+// other deque. Pinned tasks (e.g., their weights are pinned in the CVSRAM of one NVDLA) are never
+// stolen.
+
+
+inline double wall_time() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return 1. * t.tv_sec + 1.e-9 * t.tv_nsec;
+}
+
+
+// copy file_name_prefix + "_trace.bin" and its rd_only_var_log to dst, the way rtlNVDLA expects them
+inline size_t get_trace_from_file(const std::string& file_name_prefix, char* dst) {
+    // open trace file
+    std::string trace_file_name = file_name_prefix + "_trace.bin";
+    FILE* fp = fopen(trace_file_name.c_str(), "rb");
+
+    if(!fp) {
+        printf("Trace file %s open failed.\n", trace_file_name.c_str());
+        exit(0);
+    }
+
+    size_t size = fread(dst, 1, REGION_NVDLA, fp);
+    fclose(fp);
+    if(size > REGION_NVDLA - 8) {
+        printf("Trace file %s does not fit in a %d-byte region.\n", trace_file_name.c_str(), REGION_NVDLA);
+        exit(0);
+    }
+
+    // open rd_only_var_log
+    std::string var_log_file_name = file_name_prefix + "_rd_only_var_log";
+    fp = fopen(var_log_file_name.c_str(), "rb");
+
+    if(fp) {    // some tests may not have this log file, that's ok
+        size += fread(dst + size, 1, REGION_NVDLA - 8 - size, fp);
+        fclose(fp);
+    }
+
+    // write the following 8 bytes (2 x uint32_t with 0xffffffff) to mark the end of rd_only_var_log
+    for(int i = 0; i < 8; i++) dst[size++] = 0xff;
+
+    return size;
+}
+
+
+// All the trace regions in a single allocation. Every task gets its own region, filled once and
+// reused each time the graph is run.
+class TraceArena {
+  public:
+    explicit TraceArena(int num_regions) : num_regions(num_regions) {
+        base = (char*)aligned_alloc(sizeof(int)*16, (size_t)REGION_NVDLA * num_regions);
+        if(!base) {
+            printf("Cannot allocate %d trace regions.\n", num_regions);
+            exit(0);
+        }
+    }
+    ~TraceArena() { free(base); }
+
+    TraceArena(const TraceArena&) = delete;
+    TraceArena& operator=(const TraceArena&) = delete;
+
+    char* region(int i) const { return base + (size_t)i * REGION_NVDLA; }
+
+  private:
+    char* base;
+    int num_regions;
+};
+
+
+struct NVDLATask {
+    std::string name;
+    uint64_t trace_addr;
+    uint32_t trace_size;
+    int affinity;           // the NVDLA whose deque it goes to once ready
+    bool pinned;            // it can only run on its affinity NVDLA
+    std::vector<int> successors;
+    int num_deps;           // number of tasks it depends on
+    int waiting_deps;       // how many of them are not finished yet in the current run
+    int accel;              // the NVDLA it ran on
+    double start;
+    double end;
+};
+
+
+class NVDLATaskGraph {
+  public:
+    int add_task(const std::string& name, uint64_t trace_addr, uint32_t trace_size, int affinity, bool pinned) {
+        NVDLATask task;
+        task.name = name;
+        task.trace_addr = trace_addr;
+        task.trace_size = trace_size;
+        task.affinity = affinity;
+        task.pinned = pinned;
+        task.num_deps = 0;
+        task.waiting_deps = 0;
+        task.accel = -1;
+        task.start = task.end = 0.;
+        tasks.push_back(task);
+        return tasks.size() - 1;
+    }
+
+    // task "to" cannot start before task "from" has finished
+    void add_dependency(int from, int to) {
+        tasks[from].successors.push_back(to);
+        tasks[to].num_deps++;
+    }
+
+    std::vector<NVDLATask> tasks;
+};
+
+
+class WorkStealingScheduler {
+  public:
+    WorkStealingScheduler(NVDLATaskGraph& graph, int num_nvdla)
+        : graph(graph), num_nvdla(num_nvdla), deques(num_nvdla), running(num_nvdla, -1),
+          busy_time(num_nvdla, 0.), num_tasks(num_nvdla, 0), num_stolen(num_nvdla, 0), makespan(0.) {
+        if(num_nvdla < 1 || num_nvdla > 64) {
+            printf("Unsupported number of NVDLAs: %d.\n", num_nvdla);
+            exit(0);
+        }
+        for(const NVDLATask& task : graph.tasks) {
+            if(task.pinned && task.affinity >= num_nvdla) {
+                printf("Task %s is pinned to NVDLA %d but there are only %d NVDLAs.\n",
+                       task.name.c_str(), task.affinity + 1, num_nvdla);
+                exit(0);
+            }
+        }
+    }
+
+    // run the whole graph and return its makespan, it can be run again afterwards
+    double run() {
+        for(int i = 0; i < num_nvdla; i++) {
+            deques[i].clear();
+            running[i] = -1;
+            busy_time[i] = 0.;
+            num_tasks[i] = num_stolen[i] = 0;
+        }
+
+        double run_start = wall_time();
+        int num_finished = 0;
+        for(int i = 0; i < graph.tasks.size(); i++) {
+            graph.tasks[i].waiting_deps = graph.tasks[i].num_deps;
+            graph.tasks[i].accel = -1;
+            if(graph.tasks[i].num_deps == 0) make_ready(i);
+        }
+
+        while(num_finished < graph.tasks.size()) {
+            for(int i = 0; i < num_nvdla; i++) {
+                if(running[i] >= 0) continue;
+                int t = next_task(i);
+                if(t >= 0) launch(t, i);
+            }
+
+            // sleep until one of the busy NVDLAs is done instead of polling them
+            uint64_t busy_mask = 0;
+            for(int i = 0; i < num_nvdla; i++) if(running[i] >= 0) busy_mask |= 1ULL << i;
+            if(!busy_mask) {
+                printf("No task can be launched, the task graph has a dependency cycle.\n");
+                exit(0);
+            }
+            m5_sleep_accel(busy_mask);
+
+            for(int i = 0; i < num_nvdla; i++) {
+                if(running[i] < 0 || m5_wait_accel_id(i)) continue;
+                finish(running[i], i);
+                running[i] = -1;
+                num_finished++;
+            }
+        }
+
+        makespan = wall_time() - run_start;
+        return makespan;
+    }
+
+    void report() const {
+        printf("makespan = %f\n", makespan);
+        for(int i = 0; i < num_nvdla; i++) {
+            printf("NVDLA %d: %d tasks (%d stolen), busy %f, utilization %.2f%%\n", i + 1, num_tasks[i], num_stolen[i],
+                   busy_time[i], makespan > 0. ? 100. * busy_time[i] / makespan : 0.);
+        }
+    }
+
+  private:
+    void make_ready(int t) {
+        deques[graph.tasks[t].affinity % num_nvdla].push_back(t);
+    }
+
+    int next_task(int accel) {
+        if(!deques[accel].empty()) {
+            int t = deques[accel].front();
+            deques[accel].pop_front();
+            return t;
+        }
+
+        // steal the youngest unpinned task of the longest deque
+        int victim = -1;
+        for(int i = 0; i < num_nvdla; i++) {
+            if(i == accel || deques[i].empty()) continue;
+            if(victim < 0 || deques[i].size() > deques[victim].size()) {
+                for(int t : deques[i]) {
+                    if(!graph.tasks[t].pinned) {
+                        victim = i;
+                        break;
+                    }
+                }
+            }
+        }
+        if(victim < 0) return -1;
+
+        for(auto it = deques[victim].rbegin(); it != deques[victim].rend(); ++it) {
+            int t = *it;
+            if(graph.tasks[t].pinned) continue;
+            deques[victim].erase(std::next(it).base());
+            num_stolen[accel]++;
+            return t;
+        }
+        return -1;
+    }
+
+    void launch(int t, int accel) {
+        NVDLATask& task = graph.tasks[t];
+        task.accel = accel;
+        task.start = wall_time();
+        running[accel] = t;
+        num_tasks[accel]++;
+
+        printf("NVDLA %d launched %s at t = %f\n", accel + 1, task.name.c_str(), task.start);
+        m5_start_accel_id(task.trace_addr, task.trace_size, task.trace_addr, accel);
+    }
+
+    void finish(int t, int accel) {
+        NVDLATask& task = graph.tasks[t];
+        task.end = wall_time();
+        busy_time[accel] += task.end - task.start;
+
+        printf("NVDLA %d finished %s at t = %f\n", accel + 1, task.name.c_str(), task.end);
+        for(int s : task.successors) {
+            if(--graph.tasks[s].waiting_deps == 0) make_ready(s);
+        }
+    }
+
+    NVDLATaskGraph& graph;
+    int num_nvdla;
+    std::vector<std::deque<int>> deques;
+    std::vector<int> running;       // task running on each NVDLA, -1 if idle
+    std::vector<double> busy_time;
+    std::vector<int> num_tasks;
+    std::vector<int> num_stolen;
+    double makespan;
+};
+
+#endif // NVDLA_TASK_SCHEDULER_H
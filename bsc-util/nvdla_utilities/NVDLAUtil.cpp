@@ -6,12 +6,24 @@
 #include <cassert>
 #include <vector>
 #include <algorithm>
+#include <map>
+#include <unordered_map>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include <zlib.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 enum FuncType {
     no_func,
     parse_vp_log,
     comp_mem_trace,
-    nvdla_cpp_log2mem_trace
+    nvdla_cpp_log2mem_trace,
+    analyze_axilog
 };
 
 class AXI_Txn {
@@ -104,10 +116,13 @@ public:
 };
 
 
-void parse_args(int argc, char** argv, int* flags, std::vector<std::string>& in_files) {
+void parse_args(int argc, char** argv, int* flags, std::vector<std::string>& in_files, std::string& out_prefix) {
     bool func_determined = false;
     for(int i = 0; i < 16; i++)
         flags[i] = 0;
+    flags[7] = 10000;   // analyze-axilog: bandwidth interval in cycles
+    flags[9] = 64;      // analyze-axilog: bytes of an AXI beat
+    flags[10] = 1024;   // analyze-axilog: bytes of a DMA (spm line)
 
     for(int i = 1; i < argc; i++) {
         if(strcmp(argv[i], "--input1") == 0 || strcmp(argv[i], "-i1") == 0 || strcmp(argv[i], "--input2") == 0 || strcmp(argv[i], "-i2") == 0 || strcmp(argv[i], "-i") == 0) {
@@ -131,6 +146,8 @@ void parse_args(int argc, char** argv, int* flags, std::vector<std::string>& in_
                 flags[4] = comp_mem_trace;
             } else if(strcmp(argv[i], "nvdla-cpp-log2mem-trace") == 0) {
                 flags[4] = nvdla_cpp_log2mem_trace;
+            } else if(strcmp(argv[i], "analyze-axilog") == 0) {
+                flags[4] = analyze_axilog;
             } else {
                 std::cerr << "Error: invalid function type: " << argv[i] << "\n\nUse \"-h\" option to print help message.\n";
                 exit(1);
@@ -140,16 +157,49 @@ void parse_args(int argc, char** argv, int* flags, std::vector<std::string>& in_
         } else if(strcmp(argv[i], "--change-addr") == 0) {
             // change data address from 0xcxxxxxxxx to 0x8xxxxxxxx
             flags[5] = 1;
+        } else if(strcmp(argv[i], "--threads") == 0 || strcmp(argv[i], "-j") == 0) {
+            // number of threads of analyze-axilog
+            flags[6] = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "--interval") == 0) {
+            // window of the bandwidth time series of analyze-axilog, in cycles
+            flags[7] = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "--format") == 0) {
+            // output format of analyze-axilog
+            i++;
+            if(strcmp(argv[i], "json") == 0) {
+                flags[8] = 0;
+            } else if(strcmp(argv[i], "csv") == 0) {
+                flags[8] = 1;
+            } else {
+                std::cerr << "Error: invalid output format: " << argv[i] << "\n";
+                exit(1);
+            }
+        } else if(strcmp(argv[i], "--beat-bytes") == 0) {
+            flags[9] = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "--dma-line-bytes") == 0) {
+            flags[10] = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "--out-prefix") == 0 || strcmp(argv[i], "-o") == 0) {
+            out_prefix = argv[++i];
         } else if(strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
             printf("Usage: ./NVDLAUtil [-i1] in_file_1 ([-i2] in_file_2) [--function <function>] [--print-options]\n\n\n");
             printf("\t--function | -f: select the function to operate on\n");
             printf("\t <function>: parse-vp-log (convert VP debug info to NVDLA register traces (.txn), memory traces or both)\n");
             printf("\t             comp-mem-trace (compare memory trace files)\n");
-            printf("\t             nvdla-cpp-log2mem-trace (convert terminal output of nvdla.cpp to memory traces)\n\n");
+            printf("\t             nvdla-cpp-log2mem-trace (convert terminal output of nvdla.cpp to memory traces)\n");
+            printf("\t             analyze-axilog (event counts, read latencies, SPM hit rates and bandwidth of the\n");
+            printf("\t                             axilog files of a sweep directory, or of a single axilog file)\n\n");
             printf("\t[--print-options]:\n");
             printf("\t\t--print-mem-rd: print AXI data read addresses (aligned to 0x40)\n");
             printf("\t\t--print-mem-wr: print AXI data write addresses (aligned to 0x40)\n");
             printf("\t\t--print-reg-txn: print CSB register transactions\n");
+            printf("\t[analyze-axilog options]:\n");
+            printf("\t\t--threads | -j <n>: number of threads (default: all hardware threads)\n");
+            printf("\t\t--interval <cycles>: window of the bandwidth time series (default: 10000)\n");
+            printf("\t\t--format json|csv: json (default) goes to stdout, or to <prefix>axilog.json with -o;\n");
+            printf("\t\t                   csv writes <prefix>events.csv, latency.csv, latency_hist.csv and bandwidth.csv\n");
+            printf("\t\t--out-prefix | -o <prefix>: prefix of the output files\n");
+            printf("\t\t--beat-bytes <n>: bytes of an AXI beat (default: 64)\n");
+            printf("\t\t--dma-line-bytes <n>: bytes fetched by a DMA, i.e., spm_line_size (default: 1024)\n");
 
             exit(0);
         } else {
@@ -383,10 +433,624 @@ void NVDLA_CPP_Log2MemTrace(const std::string& file_name, const int* print_flags
 }
 
 
+// analyze-axilog: decodes the 16-byte records of the AXI_RESP_FAST_IO log (see PRINT_16B in
+// ext/rtl/model_nvdla/axiResponder.hh). Both the axilog.<index> files of AxiLogWriter (src/rtl/axiLogWriter.hh),
+// made of independent zlib blocks, and the legacy raw axilog are mmapped and split into chunks that are decoded
+// by a pool of threads in a single pass. Latencies are then paired per log file, also in parallel.
+enum AxiLogCmd {
+    LOG_RD_REQ = 0,
+    LOG_WR_REQ,
+    LOG_EB_HIT,
+    LOG_DMA_RD_ISSUE,
+    LOG_DATA_USED,
+    LOG_PFT_BACK,
+    LOG_AXI_BACK,
+    LOG_DMA_BACK,
+    LOG_DMA_PFT_ISSUE,
+    LOG_PFT_ISSUE,
+    NUM_LOG_CMDS
+};
+
+static const char* axi_log_cmd_names[NUM_LOG_CMDS] = {
+    "rd_req", "wr_req", "eb_hit", "dma_rd_issue", "data_used",
+    "pft_back", "axi_back", "dma_back", "dma_pft_issue", "pft_issue"
+};
+
+// rd_req beats -> axi_back, pft_issue -> pft_back, dma_rd_issue / dma_pft_issue -> dma_back
+enum LatencyKind {
+    LAT_AXI = 0,
+    LAT_AXI_PREFETCH,
+    LAT_DMA,
+    LAT_DMA_PREFETCH,
+    NUM_LAT_KINDS
+};
+
+static const char* latency_kind_names[NUM_LAT_KINDS] = {"axi", "axi_prefetch", "dma", "dma_prefetch"};
+
+struct AxiLogChunk {
+    int source;             // index of the log file
+    const uint8_t* data;
+    size_t bytes;
+    size_t raw_bytes;       // bytes of records once inflated
+    bool compressed;
+};
+
+struct BandwidthWindow {
+    uint64_t data_used{};
+    uint64_t axi_back{};
+    uint64_t pft_back{};
+    uint64_t dma_back{};
+    uint64_t wr_req{};
+
+    void add(const BandwidthWindow& other) {
+        data_used += other.data_used;
+        axi_back += other.axi_back;
+        pft_back += other.pft_back;
+        dma_back += other.dma_back;
+        wr_req += other.wr_req;
+    }
+};
+
+struct DlaLogStats {
+    uint64_t cmd_count[NUM_LOG_CMDS]{};
+    uint64_t rd_beats{};
+    std::map<uint64_t, BandwidthWindow> windows;    // window id (tick / interval) -> traffic
+
+    void add(const DlaLogStats& other) {
+        for(int i = 0; i < NUM_LOG_CMDS; i++)
+            cmd_count[i] += other.cmd_count[i];
+        rd_beats += other.rd_beats;
+        for(auto& window : other.windows)
+            windows[window.first].add(window.second);
+    }
+};
+
+// the records latencies are made of, kept in log order
+struct LatencyEvent {
+    uint64_t addr;
+    uint32_t tick;
+    uint8_t dla;
+    uint8_t cmd;
+    uint8_t burst;
+};
+
+struct ChunkResult {
+    std::map<int, DlaLogStats> dlas;
+    std::vector<LatencyEvent> events;
+    bool ok{true};
+};
+
+struct DlaLatency {
+    std::vector<uint32_t> latencies[NUM_LAT_KINDS];
+    uint64_t unmatched_issues[NUM_LAT_KINDS]{};
+    uint64_t orphan_returns[NUM_LAT_KINDS]{};
+};
+
+struct MappedLog {
+    std::string path;
+    const uint8_t* data;
+    size_t size;
+};
+
+
+void DecodeAxiLogChunk(const AxiLogChunk& chunk, uint32_t interval, ChunkResult& result) {
+    std::vector<uint64_t> inflated;
+    const uint64_t* words;
+    size_t num_words;
+    if(chunk.compressed) {
+        inflated.resize(chunk.raw_bytes / sizeof(uint64_t));
+        uLongf len = chunk.raw_bytes;
+        if(uncompress((Bytef*)inflated.data(), &len, chunk.data, chunk.bytes) != Z_OK || len != chunk.raw_bytes) {
+            result.ok = false;
+            return;
+        }
+        words = inflated.data();
+        num_words = inflated.size();
+    } else {
+        words = (const uint64_t*)chunk.data;
+        num_words = chunk.bytes / sizeof(uint64_t);
+    }
+
+    // records of a chunk mostly come from one NVDLA and fall in few windows, so cache the last ones looked up
+    int last_dla = -1;
+    DlaLogStats* stats = nullptr;
+    uint64_t last_window = 0;
+    BandwidthWindow* window = nullptr;
+
+    for(size_t i = 0; i + 1 < num_words; i += 2) {
+        uint64_t addr = words[i];
+        uint64_t info = words[i + 1];
+        uint32_t tick = info & 0xffffffff;
+        uint8_t dla = (info >> 40) & 0xff;
+        uint8_t cmd = (info >> 56) & 0xf;
+        uint8_t burst = (info >> 60) & 0xf;
+        if(cmd >= NUM_LOG_CMDS) {
+            result.ok = false;
+            return;
+        }
+
+        if(dla != last_dla) {
+            stats = &result.dlas[dla];
+            last_dla = dla;
+            window = nullptr;
+        }
+        stats->cmd_count[cmd]++;
+
+        if(cmd == LOG_WR_REQ || cmd == LOG_DATA_USED || cmd == LOG_PFT_BACK || cmd == LOG_AXI_BACK ||
+           cmd == LOG_DMA_BACK) {
+            if(!window || tick / interval != last_window) {
+                last_window = tick / interval;
+                window = &stats->windows[last_window];
+            }
+        }
+
+        switch(cmd) {
+            case LOG_RD_REQ:
+                stats->rd_beats += burst + 1;
+                break;
+            case LOG_WR_REQ:
+                window->wr_req++;
+                break;
+            case LOG_DATA_USED:
+                window->data_used++;
+                break;
+            case LOG_PFT_BACK:
+                window->pft_back++;
+                break;
+            case LOG_AXI_BACK:
+                window->axi_back++;
+                break;
+            case LOG_DMA_BACK:
+                window->dma_back++;
+                break;
+            default:
+                break;
+        }
+
+        if(cmd == LOG_RD_REQ || cmd == LOG_PFT_ISSUE || cmd == LOG_PFT_BACK || cmd == LOG_AXI_BACK ||
+           cmd == LOG_DMA_RD_ISSUE || cmd == LOG_DMA_PFT_ISSUE || cmd == LOG_DMA_BACK)
+            result.events.push_back({addr, tick, dla, cmd, burst});
+    }
+}
+
+
+struct PendingIssue {
+    uint32_t tick;
+    uint8_t kind;
+};
+
+typedef std::unordered_map<uint64_t, std::vector<PendingIssue>> PendingIssueMap;
+
+void PairAxiLogEvents(const std::vector<ChunkResult>& results, const std::vector<size_t>& chunk_ids,
+                      const std::map<int, DlaLogStats>& totals, uint32_t beat_bytes,
+                      std::map<int, DlaLatency>& latencies) {
+    // issues are matched to the returns of the same address of the same NVDLA in FIFO order
+    std::vector<PendingIssueMap> axi(256), pft(256), dma(256);
+    std::vector<bool> track_axi(256, false);
+    for(auto& dla : totals)
+        track_axi[dla.first] = dla.second.cmd_count[LOG_AXI_BACK] != 0;     // with DMA, demand beats never come back
+
+    auto issue = [](PendingIssueMap& pending, uint64_t addr, uint32_t tick, int kind) {
+        pending[addr].push_back({tick, (uint8_t)kind});
+    };
+    auto back = [](PendingIssueMap& pending, uint64_t addr, uint32_t tick, int orphan_kind, DlaLatency& lat) {
+        auto it = pending.find(addr);
+        if(it == pending.end()) {
+            lat.orphan_returns[orphan_kind]++;
+            return;
+        }
+        PendingIssue first = it->second.front();
+        it->second.erase(it->second.begin());
+        if(it->second.empty())
+            pending.erase(it);
+        lat.latencies[first.kind].push_back(tick - first.tick);  // ticks are 32 bits and may wrap
+    };
+
+    for(size_t chunk_id : chunk_ids) {
+        for(const LatencyEvent& event : results[chunk_id].events) {
+            DlaLatency& lat = latencies[event.dla];
+            switch(event.cmd) {
+                case LOG_RD_REQ:
+                    if(track_axi[event.dla]) {
+                        uint64_t beat_addr = event.addr & ~(uint64_t)(beat_bytes - 1);
+                        for(int j = 0; j <= event.burst; j++, beat_addr += beat_bytes)
+                            issue(axi[event.dla], beat_addr, event.tick, LAT_AXI);
+                    }
+                    break;
+                case LOG_AXI_BACK:
+                    back(axi[event.dla], event.addr, event.tick, LAT_AXI, lat);
+                    break;
+                case LOG_PFT_ISSUE:
+                    issue(pft[event.dla], event.addr, event.tick, LAT_AXI_PREFETCH);
+                    break;
+                case LOG_PFT_BACK:
+                    back(pft[event.dla], event.addr, event.tick, LAT_AXI_PREFETCH, lat);
+                    break;
+                case LOG_DMA_RD_ISSUE:
+                    issue(dma[event.dla], event.addr, event.tick, LAT_DMA);
+                    break;
+                case LOG_DMA_PFT_ISSUE:
+                    issue(dma[event.dla], event.addr, event.tick, LAT_DMA_PREFETCH);
+                    break;
+                case LOG_DMA_BACK:
+                    back(dma[event.dla], event.addr, event.tick, LAT_DMA, lat);
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+    for(int dla = 0; dla < 256; dla++) {
+        for(PendingIssueMap* pending : {&axi[dla], &pft[dla], &dma[dla]}) {
+            for(auto& addr_issues : *pending)
+                for(const PendingIssue& pending_issue : addr_issues.second)
+                    latencies[dla].unmatched_issues[pending_issue.kind]++;
+        }
+    }
+}
+
+
+bool MapAxiLog(const std::string& path, MappedLog& log) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+        return false;
+    struct stat st{};
+    if(fstat(fd, &st) != 0) {
+        close(fd);
+        return false;
+    }
+    log.path = path;
+    log.size = st.st_size;
+    log.data = nullptr;
+    if(log.size) {
+        void* addr = mmap(nullptr, log.size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(addr == MAP_FAILED) {
+            close(fd);
+            return false;
+        }
+        madvise(addr, log.size, MADV_SEQUENTIAL);
+        log.data = (const uint8_t*)addr;
+    }
+    close(fd);
+    return true;
+}
+
+
+std::vector<std::string> GetAxiLogPaths(const std::string& path) {
+    std::vector<std::string> paths;
+    struct stat st{};
+    if(stat(path.c_str(), &st) != 0) {
+        std::cerr << "Error: cannot access " << path << "\n";
+        exit(1);
+    }
+    if(!S_ISDIR(st.st_mode)) {
+        paths.push_back(path);
+        return paths;
+    }
+
+    // axilog.<index> of every NVDLA sorted by index, then the legacy axilog. The index is the accel_index of the
+    // NVDLA, unique over the NVDLAs of all the CPUs (id_nvdla restarts on every CPU)
+    std::vector<std::pair<long, std::string>> id_paths;
+    bool has_legacy = false;
+    DIR* dir = opendir(path.c_str());
+    struct dirent* entry;
+    while(dir && (entry = readdir(dir)) != nullptr) {
+        std::string name(entry->d_name);
+        if(name == "axilog") {
+            has_legacy = true;
+        } else if(name.compare(0, 7, "axilog.") == 0 && name.size() > 7 &&
+                  name.find_first_not_of("0123456789", 7) == std::string::npos) {
+            id_paths.emplace_back(atol(name.c_str() + 7), path + "/" + name);
+        }
+    }
+    if(dir)
+        closedir(dir);
+
+    std::sort(id_paths.begin(), id_paths.end());
+    for(auto& id_path : id_paths)
+        paths.push_back(id_path.second);
+    if(has_legacy)
+        paths.push_back(path + "/axilog");
+    return paths;
+}
+
+
+void SplitAxiLog(const MappedLog& log, int source, std::vector<AxiLogChunk>& chunks) {
+    const size_t record_bytes = 16;
+    const size_t chunk_records = 64 * 1024;
+
+    if(log.size >= 16 && memcmp(log.data, "AXILOGZ1", 8) == 0) {
+        // header: magic, uint32 id of the NVDLA, uint32 0; then blocks of uint32 raw bytes, uint32 compressed bytes
+        size_t offset = 16;
+        while(offset + 8 <= log.size) {
+            uint32_t sizes[2];
+            memcpy(sizes, log.data + offset, sizeof(sizes));
+            offset += sizeof(sizes);
+            if(offset + sizes[1] > log.size || sizes[0] % record_bytes) {
+                std::cerr << "Warning: " << log.path << " is truncated, ignoring its last block\n";
+                break;
+            }
+            chunks.push_back({source, log.data + offset, sizes[1], sizes[0], true});
+            offset += sizes[1];
+        }
+        return;
+    }
+
+    // legacy raw records, ended by a zero word
+    size_t num_records = log.size / record_bytes;
+    const uint64_t* words = (const uint64_t*)log.data;
+    for(size_t i = 0; i < num_records; i++) {
+        if(words[2 * i] == 0) {
+            num_records = i;
+            break;
+        }
+    }
+    for(size_t first = 0; first < num_records; first += chunk_records) {
+        size_t records = std::min(chunk_records, num_records - first);
+        chunks.push_back({source, log.data + first * record_bytes, records * record_bytes,
+                          records * record_bytes, false});
+    }
+}
+
+
+struct LatencySummary {
+    uint64_t count;
+    uint32_t min, p50, p90, p99, max;
+    double mean;
+    std::vector<std::pair<uint32_t, uint64_t>> histogram;   // (lower bound of a power-of-two bucket, count)
+};
+
+LatencySummary SummarizeLatencies(std::vector<uint32_t>& latencies) {
+    LatencySummary summary{};
+    summary.count = latencies.size();
+    if(latencies.empty())
+        return summary;
+
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&latencies](double q) {
+        size_t rank = (size_t)(q * latencies.size() + 0.999999);
+        return latencies[std::min(latencies.size(), std::max(rank, (size_t)1)) - 1];
+    };
+    summary.min = latencies.front();
+    summary.max = latencies.back();
+    summary.p50 = percentile(0.5);
+    summary.p90 = percentile(0.9);
+    summary.p99 = percentile(0.99);
+
+    double sum = 0;
+    for(uint32_t latency : latencies) {
+        sum += latency;
+        uint32_t bucket = 0;
+        if(latency) {
+            bucket = 1;
+            while(latency >> 1 >= bucket)
+                bucket <<= 1;
+        }
+        if(summary.histogram.empty() || summary.histogram.back().first != bucket)
+            summary.histogram.emplace_back(bucket, 0);
+        summary.histogram.back().second++;
+    }
+    summary.mean = sum / latencies.size();
+    return summary;
+}
+
+
+FILE* OpenAxiLogOutput(const std::string& name) {
+    FILE* fp = fopen(name.c_str(), "w");
+    if(!fp) {
+        std::cerr << "Error: cannot open " << name << "\n";
+        exit(1);
+    }
+    return fp;
+}
+
+
+void AnalyzeAxiLog(const std::string& path, const int* flags, const std::string& out_prefix) {
+    unsigned num_threads = flags[6] > 0 ? flags[6] : std::max(1u, std::thread::hardware_concurrency());
+    uint32_t interval = flags[7] > 0 ? flags[7] : 10000;
+    uint64_t beat_bytes = flags[9];
+    uint64_t dma_line_bytes = flags[10];
+    if(beat_bytes == 0 || (beat_bytes & (beat_bytes - 1))) {
+        std::cerr << "Error: --beat-bytes must be a power of two\n";
+        exit(1);
+    }
+
+    std::vector<std::string> paths = GetAxiLogPaths(path);
+    if(paths.empty()) {
+        std::cerr << "Error: no axilog found in " << path << "\n";
+        exit(1);
+    }
+
+    std::vector<MappedLog> logs(paths.size());
+    std::vector<AxiLogChunk> chunks;
+    for(size_t i = 0; i < paths.size(); i++) {
+        if(!MapAxiLog(paths[i], logs[i])) {
+            std::cerr << "Error: cannot map " << paths[i] << "\n";
+            exit(1);
+        }
+        SplitAxiLog(logs[i], (int)i, chunks);
+    }
+
+    // pass 1: inflate and decode the chunks in parallel
+    std::vector<ChunkResult> results(chunks.size());
+    std::atomic<size_t> next_chunk(0);
+    std::vector<std::thread> workers;
+    for(unsigned t = 0; t < std::min<size_t>(num_threads, std::max<size_t>(chunks.size(), 1)); t++) {
+        workers.emplace_back([&]() {
+            size_t i;
+            while((i = next_chunk++) < chunks.size())
+                DecodeAxiLogChunk(chunks[i], interval, results[i]);
+        });
+    }
+    for(auto& worker : workers)
+        worker.join();
+    workers.clear();
+
+    std::map<int, DlaLogStats> totals;
+    std::vector<std::vector<size_t>> source_chunks(logs.size());
+    for(size_t i = 0; i < chunks.size(); i++) {
+        if(!results[i].ok) {
+            std::cerr << "Error: corrupted block in " << logs[chunks[i].source].path << "\n";
+            exit(1);
+        }
+        for(auto& dla : results[i].dlas)
+            totals[dla.first].add(dla.second);
+        source_chunks[chunks[i].source].push_back(i);
+    }
+
+    // pass 2: pair issues and returns, each log file on its own thread
+    std::vector<std::map<int, DlaLatency>> source_latencies(logs.size());
+    std::atomic<size_t> next_source(0);
+    for(unsigned t = 0; t < std::min<size_t>(num_threads, logs.size()); t++) {
+        workers.emplace_back([&]() {
+            size_t i;
+            while((i = next_source++) < logs.size())
+                PairAxiLogEvents(results, source_chunks[i], totals, beat_bytes, source_latencies[i]);
+        });
+    }
+    for(auto& worker : workers)
+        worker.join();
+    results.clear();
+    for(auto& log : logs) {
+        if(log.data)
+            munmap((void*)log.data, log.size);
+    }
+
+    std::map<int, DlaLatency> latencies;
+    for(auto& source : source_latencies) {
+        for(auto& dla : source) {
+            DlaLatency& lat = latencies[dla.first];
+            for(int k = 0; k < NUM_LAT_KINDS; k++) {
+                lat.latencies[k].insert(lat.latencies[k].end(), dla.second.latencies[k].begin(),
+                                        dla.second.latencies[k].end());
+                lat.unmatched_issues[k] += dla.second.unmatched_issues[k];
+                lat.orphan_returns[k] += dla.second.orphan_returns[k];
+            }
+        }
+    }
+    for(auto& dla : totals)
+        latencies[dla.first];
+
+    std::map<int, std::vector<LatencySummary>> summaries;
+    for(auto& dla : latencies) {
+        for(int k = 0; k < NUM_LAT_KINDS; k++)
+            summaries[dla.first].push_back(SummarizeLatencies(dla.second.latencies[k]));
+    }
+
+    // SPM hit rate: with the embedded buffer, every demand beat either hits or waits for a DMA
+    auto spm_hit_rate = [](const DlaLogStats& stats) {
+        return stats.rd_beats ? (double)stats.cmd_count[LOG_EB_HIT] / stats.rd_beats : 0.0;
+    };
+    auto mem_rd_bytes = [&](const BandwidthWindow& w) {
+        return (w.axi_back + w.pft_back) * beat_bytes + w.dma_back * dma_line_bytes;
+    };
+
+    if(flags[8]) {
+        FILE* fp = OpenAxiLogOutput(out_prefix + "events.csv");
+        fprintf(fp, "nvdla");
+        for(auto name : axi_log_cmd_names)
+            fprintf(fp, ",%s", name);
+        fprintf(fp, ",rd_beats,spm_hits,spm_hit_rate\n");
+        for(auto& dla : totals) {
+            fprintf(fp, "%d", dla.first);
+            for(auto count : dla.second.cmd_count)
+                fprintf(fp, ",%lu", count);
+            fprintf(fp, ",%lu,%lu,%.6f\n", dla.second.rd_beats, dla.second.cmd_count[LOG_EB_HIT],
+                    spm_hit_rate(dla.second));
+        }
+        fclose(fp);
+
+        fp = OpenAxiLogOutput(out_prefix + "latency.csv");
+        FILE* hist_fp = OpenAxiLogOutput(out_prefix + "latency_hist.csv");
+        fprintf(fp, "nvdla,kind,count,unmatched_issues,orphan_returns,min,mean,p50,p90,p99,max\n");
+        fprintf(hist_fp, "nvdla,kind,bucket,count\n");
+        for(auto& dla : summaries) {
+            for(int k = 0; k < NUM_LAT_KINDS; k++) {
+                const LatencySummary& s = dla.second[k];
+                fprintf(fp, "%d,%s,%lu,%lu,%lu,%u,%.3f,%u,%u,%u,%u\n", dla.first, latency_kind_names[k], s.count,
+                        latencies[dla.first].unmatched_issues[k], latencies[dla.first].orphan_returns[k],
+                        s.min, s.mean, s.p50, s.p90, s.p99, s.max);
+                for(auto& bucket : s.histogram)
+                    fprintf(hist_fp, "%d,%s,%u,%lu\n", dla.first, latency_kind_names[k], bucket.first, bucket.second);
+            }
+        }
+        fclose(fp);
+        fclose(hist_fp);
+
+        fp = OpenAxiLogOutput(out_prefix + "bandwidth.csv");
+        fprintf(fp, "nvdla,window_start,nvdla_rd_bytes,mem_rd_bytes,wr_reqs\n");
+        for(auto& dla : totals) {
+            const auto& windows = dla.second.windows;
+            if(windows.empty())
+                continue;
+            for(uint64_t w = windows.begin()->first; w <= windows.rbegin()->first; w++) {
+                auto it = windows.find(w);
+                BandwidthWindow window = it == windows.end() ? BandwidthWindow() : it->second;
+                fprintf(fp, "%d,%lu,%lu,%lu,%lu\n", dla.first, w * interval, window.data_used * beat_bytes,
+                        mem_rd_bytes(window), window.wr_req);
+            }
+        }
+        fclose(fp);
+        return;
+    }
+
+    FILE* fp = out_prefix.empty() ? stdout : OpenAxiLogOutput(out_prefix + "axilog.json");
+    uint64_t total_counts[NUM_LOG_CMDS]{};
+    fprintf(fp, "{\n  \"interval\": %u,\n  \"beat_bytes\": %lu,\n  \"dma_line_bytes\": %lu,\n  \"nvdlas\": [",
+            interval, beat_bytes, dma_line_bytes);
+    bool first_dla = true;
+    for(auto& dla : totals) {
+        const DlaLogStats& stats = dla.second;
+        fprintf(fp, "%s\n    {\n      \"id\": %d,\n      \"events\": {", first_dla ? "" : ",", dla.first);
+        first_dla = false;
+        for(int c = 0; c < NUM_LOG_CMDS; c++) {
+            fprintf(fp, "%s\"%s\": %lu", c ? ", " : "", axi_log_cmd_names[c], stats.cmd_count[c]);
+            total_counts[c] += stats.cmd_count[c];
+        }
+        fprintf(fp, "},\n      \"spm\": {\"rd_beats\": %lu, \"hits\": %lu, \"hit_rate\": %.6f},\n",
+                stats.rd_beats, stats.cmd_count[LOG_EB_HIT], spm_hit_rate(stats));
+
+        fprintf(fp, "      \"latency\": {");
+        for(int k = 0; k < NUM_LAT_KINDS; k++) {
+            const LatencySummary& s = summaries[dla.first][k];
+            fprintf(fp, "%s\n        \"%s\": {\"count\": %lu, \"unmatched_issues\": %lu, \"orphan_returns\": %lu, "
+                        "\"min\": %u, \"mean\": %.3f, \"p50\": %u, \"p90\": %u, \"p99\": %u, \"max\": %u, "
+                        "\"histogram\": [", k ? "," : "", latency_kind_names[k], s.count,
+                    latencies[dla.first].unmatched_issues[k], latencies[dla.first].orphan_returns[k],
+                    s.min, s.mean, s.p50, s.p90, s.p99, s.max);
+            for(size_t b = 0; b < s.histogram.size(); b++)
+                fprintf(fp, "%s[%u, %lu]", b ? ", " : "", s.histogram[b].first, s.histogram[b].second);
+            fprintf(fp, "]}");
+        }
+        fprintf(fp, "\n      },\n");
+
+        // [window start, bytes read by the NVDLA, bytes read from memory, write requests]
+        fprintf(fp, "      \"bandwidth\": [");
+        if(!stats.windows.empty()) {
+            for(uint64_t w = stats.windows.begin()->first; w <= stats.windows.rbegin()->first; w++) {
+                auto it = stats.windows.find(w);
+                BandwidthWindow window = it == stats.windows.end() ? BandwidthWindow() : it->second;
+                fprintf(fp, "%s[%lu, %lu, %lu, %lu]", w == stats.windows.begin()->first ? "" : ", ", w * interval,
+                        window.data_used * beat_bytes, mem_rd_bytes(window), window.wr_req);
+            }
+        }
+        fprintf(fp, "]\n    }");
+    }
+    fprintf(fp, "\n  ],\n  \"events\": {");
+    for(int c = 0; c < NUM_LOG_CMDS; c++)
+        fprintf(fp, "%s\"%s\": %lu", c ? ", " : "", axi_log_cmd_names[c], total_counts[c]);
+    fprintf(fp, "}\n}\n");
+    if(fp != stdout)
+        fclose(fp);
+}
+
+
 int main(int argc, char** argv) {
     int print_flags[16];
     std::vector<std::string> in_files;
-    parse_args(argc, argv, print_flags, in_files);
+    std::string out_prefix;
+    parse_args(argc, argv, print_flags, in_files, out_prefix);
 
     switch(print_flags[4]) {
         case parse_vp_log:
@@ -398,6 +1062,9 @@ int main(int argc, char** argv) {
         case nvdla_cpp_log2mem_trace:
             NVDLA_CPP_Log2MemTrace(in_files[0], print_flags);
             break;
+        case analyze_axilog:
+            AnalyzeAxiLog(in_files[0], print_flags, out_prefix);
+            break;
         default:
             printf("Error: invalid function type\n");
             exit(1);
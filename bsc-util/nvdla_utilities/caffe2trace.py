@@ -125,7 +125,7 @@ def process_log(options):
 
     nvdla_utilities_dir = os.path.dirname(os.path.abspath(__file__))
     if not os.path.exists(os.path.join(nvdla_utilities_dir, "NVDLAUtil")):
-        os.system("cd " + nvdla_utilities_dir + " && g++ -std=c++11 NVDLAUtil.cpp -o NVDLAUtil")
+        os.system("cd " + nvdla_utilities_dir + " && g++ -std=c++11 -O2 NVDLAUtil.cpp -o NVDLAUtil -pthread -lz")
     os.system("cd " + nvdla_utilities_dir + " && ./NVDLAUtil -i " + os.path.join(options.out_dir, "sc.log") +
               " --print-reg-txn -f parse-vp-log --change-addr > " + os.path.join(options.out_dir, "input.txn"))
     os.system("cd " + nvdla_utilities_dir + " && ./NVDLAUtil -i " + os.path.join(options.out_dir, "sc.log") +
@@ -0,0 +1,108 @@
+import os
+import re
+import struct
+import zlib
+
+
+# Reader of the axilog files written by AxiLogWriter (src/rtl/axiLogWriter.hh): one file axilog.<index> per NVDLA,
+# made of zlib blocks of 16-byte records, with an index axilog.<index>.idx giving the first and last tick of each block.
+# The index is the accel_index of the NVDLA, unique over the NVDLAs of all the CPUs unlike id_nvdla, and is also the
+# NVDLA id in the records.
+# A legacy raw axilog (records written back to back, ended by a zero word) is read too if present.
+
+LOG_MAGIC = b"AXILOGZ1"
+IDX_MAGIC = b"AXILOGI1"
+IDX_ENTRY = struct.Struct("<QQQII")     # first tick, last tick, offset, records, compressed bytes
+BLOCK_HEADER = struct.Struct("<II")     # raw bytes, compressed bytes
+
+
+def get_axilog_paths(sweep_dir):
+    paths = []
+    for file in os.listdir(sweep_dir):
+        match = re.fullmatch(r"axilog\.([0-9]+)", file)
+        if match:
+            paths.append((int(match.group(1)), os.path.join(sweep_dir, file)))
+    return [path for _, path in sorted(paths)]
+
+
+def read_index(log_path):
+    idx_path = log_path + ".idx"
+    if not os.path.exists(idx_path):
+        return None
+    with open(idx_path, "rb") as fp:
+        if fp.read(len(IDX_MAGIC)) != IDX_MAGIC:
+            return None
+        data = fp.read()
+    return [IDX_ENTRY.unpack_from(data, i) for i in range(0, len(data) - IDX_ENTRY.size + 1, IDX_ENTRY.size)]
+
+
+def read_blocks(fp):
+    # used when the index is missing: walk the blocks one after the other
+    blocks = []
+    while True:
+        offset = fp.tell()
+        header = fp.read(BLOCK_HEADER.size)
+        if len(header) < BLOCK_HEADER.size:
+            break
+        raw_bytes, comp_bytes = BLOCK_HEADER.unpack(header)
+        blocks.append((None, None, offset, raw_bytes // 16, comp_bytes))
+        fp.seek(comp_bytes, os.SEEK_CUR)
+    return blocks
+
+
+def iter_block_records(raw):
+    for int64_0, int64_1 in struct.iter_unpack("<QQ", raw):
+        yield int64_0, int64_1
+
+
+def iter_log_records(log_path, start_tick=None, end_tick=None):
+    with open(log_path, "rb") as fp:
+        if fp.read(len(LOG_MAGIC)) != LOG_MAGIC:
+            return
+        fp.read(8)      # id of the NVDLA and padding
+        blocks = read_index(log_path)
+        if blocks is None:
+            blocks = read_blocks(fp)
+
+        for first_tick, last_tick, offset, _, _ in blocks:
+            # ticks are the low 32 bits of the current tick and may wrap, so only skip blocks that do not
+            if first_tick is not None and first_tick <= last_tick:
+                if end_tick is not None and first_tick > end_tick:
+                    continue
+                if start_tick is not None and last_tick < start_tick:
+                    continue
+            fp.seek(offset)
+            raw_bytes, comp_bytes = BLOCK_HEADER.unpack(fp.read(BLOCK_HEADER.size))
+            raw = zlib.decompress(fp.read(comp_bytes))
+            assert len(raw) == raw_bytes
+            for record in iter_block_records(raw):
+                tick = record[1] & 0xffffffff
+                if start_tick is not None and tick < start_tick:
+                    continue
+                if end_tick is not None and tick > end_tick:
+                    continue
+                yield record
+
+
+def iter_legacy_records(log_path):
+    with open(log_path, "rb") as fp:
+        while True:
+            int64_0 = int.from_bytes(fp.read(8), byteorder="little")
+            if not int64_0:
+                break
+            int64_1 = int.from_bytes(fp.read(8), byteorder="little")
+            yield int64_0, int64_1
+
+
+def iter_axilog(sweep_dir, start_tick=None, end_tick=None):
+    """yields the (int64_0, int64_1) records of all the NVDLAs of sweep_dir, NVDLA by NVDLA,
+    optionally only those whose tick is within [start_tick, end_tick]"""
+    for log_path in get_axilog_paths(sweep_dir):
+        yield from iter_log_records(log_path, start_tick, end_tick)
+
+    legacy_path = os.path.join(sweep_dir, "axilog")
+    if os.path.exists(legacy_path):
+        for record in iter_legacy_records(legacy_path):
+            tick = record[1] & 0xffffffff
+            if (start_tick is None or tick >= start_tick) and (end_tick is None or tick <= end_tick):
+                yield record
@@ -0,0 +1,76 @@
+import os
+import sys
+import argparse
+from get_sweep_stats import get_host_seconds, get_simulated_seconds, natural_keys
+from sweeper import param_types
+
+# Throughput scaling over the number of NVDLAs of data points that only differ in "numNVDLA".
+# Sweep a json with e.g. "numNVDLA": [1, 2, 4, 8, 16] (see example_usage/experiments/jsons_scaling/) with the
+# my_validation_nvdla_single_thread scheduler, which runs the trace on every NVDLA,
+# and point this script to the output directory of main.py --run-points.
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(description="bench_nvdla_scaling.py options")
+    parser.add_argument("--get-root-dir", "-d", type=str, required=True,
+                        help="path to the root dir containing a set of experiments")
+    parser.add_argument("--out-dir", "-o", type=str, default=".",
+                        help="path to the directory to store the scaling table")
+    parser.add_argument("--out-prefix", "-p", type=str, default="", required=True,
+                        help="the prefix to the output file name")
+    return parser.parse_args()
+
+
+def get_num_passes(sweep_dir):
+    with open(os.path.join(sweep_dir, "stdout"), "r", errors="replace") as fp:
+        return sum(1 for line in fp if "*** PASS" in line)
+
+
+def main():
+    options = parse_args()
+    # the remapper follows the number of NVDLAs, see RemapperParam.is_meaningful
+    other_params = [name for name in param_types if name not in ("numNVDLA", "remapper")]
+
+    # {(values of all the other params): {num_nvdla: (sweep_dir, passes, simulated_seconds, host_seconds)}}
+    groups = {}
+    for root, dirs, files in sorted(os.walk(options.get_root_dir), key=natural_keys):
+        if "run.sh" not in files or not os.path.exists(os.path.join(root, "stdout")):
+            continue
+        num_nvdla = int(param_types["numNVDLA"].get(root))
+        key = tuple(str(param_types[name].get(root)) for name in other_params)
+        groups.setdefault(key, {})[num_nvdla] = (os.path.relpath(root, options.get_root_dir), get_num_passes(root),
+                                                 float(get_simulated_seconds(root)), get_host_seconds(root))
+
+    incomplete = 0
+    lines = ["sweep_dir,num_nvdla,passes,simulated_seconds,throughput,host_seconds,host_seconds_per_pass,"
+             "throughput_speedup"]
+    for key, points in groups.items():
+        base_throughput = None
+        for num_nvdla in sorted(points.keys()):
+            sweep_dir, passes, sim_seconds, host_seconds = points[num_nvdla]
+            # traces finished per simulated second
+            throughput = passes / sim_seconds if sim_seconds > 0 else 0.0
+            if base_throughput is None:
+                base_throughput = throughput
+            speedup = throughput / base_throughput if base_throughput > 0 else 0.0
+            host_per_pass = host_seconds / passes if passes > 0 else 0.0
+            if passes != num_nvdla:
+                print("WARNING: %s: %d of %d NVDLAs passed" % (sweep_dir, passes, num_nvdla))
+                incomplete += 1
+            lines.append("%s,%d,%d,%f,%.3f,%d,%.3f,%.3f" % (sweep_dir, num_nvdla, passes, sim_seconds, throughput,
+                                                           host_seconds, host_per_pass, speedup))
+            print("%-40s nvdlas = %-3d throughput = %-10.3f host_seconds = %-6d speedup = %.3f" %
+                  (sweep_dir, num_nvdla, throughput, host_seconds, speedup))
+
+    with open(os.path.join(options.out_dir, options.out_prefix + "nvdla_scaling.csv"), "w") as fp:
+        fp.write("\n".join(lines))
+        fp.write("\n")
+
+    # every NVDLA of every point has to pass its trace for the table to mean anything
+    if incomplete:
+        print("ERROR: %d points did not pass on all their NVDLAs" % incomplete)
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,54 @@
+import os
+import argparse
+from get_sweep_stats import get_host_seconds, natural_keys
+from sweeper import param_types
+
+# Compare host seconds of data points that only differ in "verilator-threads".
+# Sweep a json with e.g. "verilator-threads": [0, 4] (see example_usage/experiments/jsons_mt/)
+# and point this script to the output directory of main.py --run-points.
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(description="bench_verilator_mt.py options")
+    parser.add_argument("--get-root-dir", "-d", type=str, required=True,
+                        help="path to the root dir containing a set of experiments")
+    parser.add_argument("--out-dir", "-o", type=str, default=".",
+                        help="path to the directory to store the speedup table")
+    parser.add_argument("--out-prefix", "-p", type=str, default="", required=True,
+                        help="the prefix to the output file name")
+    return parser.parse_args()
+
+
+def main():
+    options = parse_args()
+    other_params = [name for name in param_types if name != "verilator-threads"]
+
+    # {(values of all the other params): {verilator_threads: (sweep_dir, host_seconds)}}
+    groups = {}
+    for root, dirs, files in sorted(os.walk(options.get_root_dir), key=natural_keys):
+        if "run.sh" not in files or not os.path.exists(os.path.join(root, "stdout")):
+            continue
+        threads = param_types["verilator-threads"].get(root)
+        threads = 0 if threads is None else int(threads)
+        key = tuple(str(param_types[name].get(root)) for name in other_params)
+        groups.setdefault(key, {})[threads] = (os.path.relpath(root, options.get_root_dir), get_host_seconds(root))
+
+    lines = ["sweep_dir,verilator_threads,host_seconds,baseline_host_seconds,speedup"]
+    for key, points in groups.items():
+        if 0 not in points:
+            continue
+        base_seconds = points[0][1]
+        for threads in sorted(points.keys()):
+            sweep_dir, seconds = points[threads]
+            speedup = base_seconds / seconds if seconds > 0 else 0.0
+            lines.append("%s,%d,%d,%d,%.3f" % (sweep_dir, threads, seconds, base_seconds, speedup))
+            print("%-40s threads = %-3d host_seconds = %-6d speedup = %.3f" %
+                  (sweep_dir, threads, seconds, speedup))
+
+    with open(os.path.join(options.out_dir, options.out_prefix + "verilator_mt_speedup.csv"), "w") as fp:
+        fp.write("\n".join(lines))
+        fp.write("\n")
+
+
+if __name__ == "__main__":
+    main()
@@ -3,9 +3,11 @@ import re
 import collections
 import argparse
 import json
+import subprocess
 from os.path import exists
 from params import *
 from sweeper import param_types
+from axilog import iter_axilog
 
 
 sweep_header = ["sweep_name", "sweep_id"]
@@ -26,6 +28,8 @@ stat_header2identifier = {   # including both private and shared stats' headers
 }
 
 max_num_nvdla = 0
+nvdla_util = None       # path to NVDLAUtil, to count axilog events natively
+axilog_analysis = {}    # sweep_dir -> output of `NVDLAUtil --function analyze-axilog`
 
 
 def get_max_num_nvdla(options):
@@ -36,37 +40,33 @@ def get_max_num_nvdla(options):
             max_num_nvdla = max(max_num_nvdla, num_nvdla)
 
 
+def analyze_axilog(sweep_dir):
+    # one multi-threaded pass of NVDLAUtil over the axilog files serves all the axilog-based metrics of a sweep point
+    if sweep_dir not in axilog_analysis:
+        out = subprocess.run([nvdla_util, "-i", sweep_dir, "--function", "analyze-axilog"],
+                             stdout=subprocess.PIPE, check=True).stdout
+        axilog_analysis.clear()
+        axilog_analysis[sweep_dir] = json.loads(out)
+    return axilog_analysis[sweep_dir]
+
+
 def get_num_dma_prefetch(sweep_dir):
+    if nvdla_util is not None:
+        return analyze_axilog(sweep_dir)["events"]["dma_pft_issue"]
     counter = 0
-    axi_path = os.path.join(sweep_dir, "axilog")
-    if os.path.exists(axi_path):
-        fp = open(axi_path, "rb")
-
-        while True:
-            int64_0 = int.from_bytes(fp.read(8), byteorder="little")
-            if not int64_0:
-                break
-            int64_1 = int.from_bytes(fp.read(8), byteorder="little")
-            if (int(int64_1) >> 56) & 0xf == 0x8:
-                counter += 1
-        fp.close()
+    for _, int64_1 in iter_axilog(sweep_dir):
+        if (int(int64_1) >> 56) & 0xf == 0x8:
+            counter += 1
     return counter
 
 
 def get_num_dma(sweep_dir):
+    if nvdla_util is not None:
+        return analyze_axilog(sweep_dir)["events"]["dma_rd_issue"]
     counter = 0
-    axi_path = os.path.join(sweep_dir, "axilog")
-    if os.path.exists(axi_path):
-        fp = open(axi_path, "rb")
-
-        while True:
-            int64_0 = int.from_bytes(fp.read(8), byteorder="little")
-            if not int64_0:
-                break
-            int64_1 = int.from_bytes(fp.read(8), byteorder="little")
-            if (int(int64_1) >> 56) & 0xf == 0x3:
-                counter += 1
-        fp.close()
+    for _, int64_1 in iter_axilog(sweep_dir):
+        if (int(int64_1) >> 56) & 0xf == 0x3:
+            counter += 1
     return counter
 
 
@@ -143,17 +143,9 @@ def get_memory_cycles(sweep_dir):
     item_vals_of_nvdlas = ["0" for _ in range(max_num_nvdla)]
 
     print_insts = []
-    axi_path = os.path.join(sweep_dir, "axilog")
-    if os.path.exists(axi_path):
-        fp = open(os.path.join(sweep_dir, "axilog"), "rb")
-        while True:
-            int64_0 = int.from_bytes(fp.read(8), byteorder="little")
-            if not int64_0:
-                break
-            int64_1 = int.from_bytes(fp.read(8), byteorder="little")
-            assert int64_1
-            print_insts.append((int(int64_0), int(int64_1)))
-        fp.close()
+    for int64_0, int64_1 in iter_axilog(sweep_dir):
+        assert int64_1
+        print_insts.append((int(int64_0), int(int64_1)))
 
     dbb_inflight = [[(0, 0)] for _ in range(max_num_nvdla)]     # [[(cycle_id, num), ...], ...]
     cvsram_inflight = [[(0, 0)] for _ in range(max_num_nvdla)]
@@ -348,6 +340,9 @@ def parse_args():
                         help="path to the directory to store the summary of a set of experiments")
     parser.add_argument("--out-prefix", "-p", type=str, default="", required=True,
                         help="the prefix to the output file name")
+    parser.add_argument("--nvdla-util", type=str, default="",
+                        help="path to a compiled NVDLAUtil, used to analyze axilog files instead of reading them "
+                             "in Python")
 
     return parser.parse_args()
 
@@ -379,7 +374,10 @@ def summary(options):
 
 
 def main():
+    global nvdla_util
     options = parse_args()
+    if options.nvdla_util != "":
+        nvdla_util = os.path.abspath(options.nvdla_util)
     summary(options)
 
 
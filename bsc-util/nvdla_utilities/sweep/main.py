@@ -29,6 +29,9 @@ def main():
         help="path to the disk image for full system simulation")
     parser.add_argument(
         "--gem5-binary", help="Path to the gem5 binary.")
+    parser.add_argument(
+        "--gem5-mt-binary", help="Path to the gem5 binary linked against the multi-threaded NVDLA model "
+                                 "(make nvdla_mt), used by data points with verilator-threads > 0.")
 
     # workload-related info
     parser.add_argument(
@@ -74,6 +77,11 @@ def main():
             assert os.path.exists(opt_path), f"gem5.fast/.opt binary does not exist!"
             args.gem5_binary = opt_path
 
+    if not args.gem5_mt_binary:
+        mt_path = os.path.abspath(os.path.join(os.path.dirname(__file__), "../../../build/ARM_MT/gem5.fast"))
+        if os.path.exists(mt_path):
+            args.gem5_mt_binary = mt_path
+
     sweeper = Sweeper(args)
 
     # Start enumerating all the data points.
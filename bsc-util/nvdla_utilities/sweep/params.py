@@ -130,6 +130,59 @@ class DDRTypeParam(BaseParam):
         return ["DDR3_1600_8x8"]
 
 
+class MemSizeParam(BaseParam):
+    # without cvsram every NVDLA takes a 256MB SRAM window of DRAM, the default 2GB leaves room for five
+    def __init__(self, name, sweep_vals):
+        BaseParam.__init__(self, name, sweep_vals)
+
+    def apply(self, point_dir):
+        change_config_file(
+            point_dir, "run.sh", {"mem-size": self.curr_sweep_value()})
+
+    @classmethod
+    def get(self, point_dir):
+        run_sh_path = os.path.join(point_dir, "run.sh")
+        assert os.path.exists(run_sh_path)
+        with open(run_sh_path, "r") as fp:
+            run_sh_lines = fp.readlines()
+
+        for line in run_sh_lines:
+            pos = line.find("--mem-size")
+            if pos == -1:
+                continue
+            return re.search(r"--mem-size\s+([0-9a-zA-Z]+)", line).group(1)
+
+    @classmethod
+    def default_value(cls):
+        return ["2GB"]
+
+
+class CPUTypeParam(BaseParam):
+    def __init__(self, name, sweep_vals):
+        BaseParam.__init__(self, name, sweep_vals)
+
+    def apply(self, point_dir):
+        change_config_file(
+            point_dir, "run.sh", {"cpu-type": self.curr_sweep_value()})
+
+    @classmethod
+    def get(self, point_dir):
+        run_sh_path = os.path.join(point_dir, "run.sh")
+        assert os.path.exists(run_sh_path)
+        with open(run_sh_path, "r") as fp:
+            run_sh_lines = fp.readlines()
+
+        for line in run_sh_lines:
+            pos = line.find("--cpu-type")
+            if pos == -1:
+                continue
+            return re.search(r"--cpu-type\s+([0-9a-zA-Z\_\-]+)", line).group(1)
+
+    @classmethod
+    def default_value(cls):
+        return ["timing"]
+
+
 class NumNVDLAParam(BaseParam):
     def __init__(self, name, sweep_vals):
         BaseParam.__init__(self, name, sweep_vals)
@@ -1022,6 +1075,68 @@ class PftThresholdParam(BaseParam):
         return [16]
 
 
+class PftLookaheadParam(BaseParam):
+    def __init__(self, name, sweep_vals):
+        BaseParam.__init__(self, name, sweep_vals)
+
+    def apply(self, point_dir):
+        change_config_file(
+            point_dir, "run.sh", {"pft-lookahead": self.curr_sweep_value()})
+
+    def is_meaningful(self, type_val_pairs):
+        if type_val_pairs[PftEnableParam] != "--pft-enable" and self.curr_sweep_value() != self._sweep_vals[0]:
+            return False
+        return True
+
+    @classmethod
+    def get(self, point_dir):
+        run_sh_path = os.path.join(point_dir, "run.sh")
+        assert os.path.exists(run_sh_path)
+        with open(run_sh_path, "r") as fp:
+            run_sh_lines = fp.readlines()
+
+        for line in run_sh_lines:
+            pos = line.find("--pft-lookahead")
+            if pos == -1:
+                continue
+            return re.search(r"--pft-lookahead\s+([0-9]+)", line).group(1)
+
+    @classmethod
+    def default_value(cls):
+        return [1]
+
+
+class PftDepthParam(BaseParam):
+    def __init__(self, name, sweep_vals):
+        BaseParam.__init__(self, name, sweep_vals)
+
+    def apply(self, point_dir):
+        change_config_file(
+            point_dir, "run.sh", {"pft-depth": self.curr_sweep_value()})
+
+    def is_meaningful(self, type_val_pairs):
+        if type_val_pairs[PftEnableParam] != "--pft-enable" and self.curr_sweep_value() != self._sweep_vals[0]:
+            return False
+        return True
+
+    @classmethod
+    def get(self, point_dir):
+        run_sh_path = os.path.join(point_dir, "run.sh")
+        assert os.path.exists(run_sh_path)
+        with open(run_sh_path, "r") as fp:
+            run_sh_lines = fp.readlines()
+
+        for line in run_sh_lines:
+            pos = line.find("--pft-depth")
+            if pos == -1:
+                continue
+            return re.search(r"--pft-depth\s+([0-9]+)", line).group(1)
+
+    @classmethod
+    def default_value(cls):
+        return [0]
+
+
 class UseFakeMemParam(BaseParam):
     def __init__(self, name, sweep_vals):
         BaseParam.__init__(self, name, sweep_vals)
@@ -1192,11 +1307,10 @@ class RemapperParam(BaseParam):
         if type_val_pairs[NumNVDLAParam] == 1 and \
                 eval("issubclass(" + self.curr_sweep_value() + "Remapper, PipelineRemapper)"):
             return False
-        if type_val_pairs[NumNVDLAParam] != 1 and \
+        # with Identity, a single-thread scheduler runs the same trace on every NVDLA (throughput scaling)
+        if type_val_pairs[NumNVDLAParam] != 1 and self.curr_sweep_value() != "Identity" and \
                 eval("not issubclass(" + self.curr_sweep_value() + "Remapper, PipelineRemapper)"):
             return False
-        if type_val_pairs[NumNVDLAParam] != 1 and self.curr_sweep_value() == "Identity":
-            return False
         if type_val_pairs[CVSRAMEnableParam] != "--cvsram-enable" and \
                 eval("issubclass(" + self.curr_sweep_value() + "Remapper, CVSRAMRemapper)"):
             return False
@@ -1221,3 +1335,60 @@ class RemapperParam(BaseParam):
     @classmethod
     def default_value(cls):
         return ["Identity"]
+
+
+class VerilatorThreadsParam(BaseParam):
+    def __init__(self, name, sweep_vals):
+        BaseParam.__init__(self, name, sweep_vals)
+
+    def apply(self, point_dir):
+        change_config_file(
+            point_dir, "run.sh", {"verilator-threads": self.curr_sweep_value()})
+
+    @classmethod
+    def get(self, point_dir):
+        run_sh_path = os.path.join(point_dir, "run.sh")
+        assert os.path.exists(run_sh_path)
+        with open(run_sh_path, "r") as fp:
+            run_sh_lines = fp.readlines()
+
+        for line in run_sh_lines:
+            pos = line.find("--verilator-threads")
+            if pos == -1:
+                continue
+            return re.search(r"--verilator-threads\s+([0-9]+)", line).group(1)
+
+    @classmethod
+    def default_value(cls):
+        return [0]
+
+
+class NVDLAParallelParam(BaseParam):
+    def __init__(self, name, sweep_vals):
+        BaseParam.__init__(self, name, sweep_vals)
+
+    def apply(self, point_dir):
+        change_config_file(
+            point_dir, "run.sh", {"nvdla-parallel": self.curr_sweep_value()})
+
+    def is_meaningful(self, type_val_pairs):
+        if type_val_pairs[SharedSPMParam] != "" and self.curr_sweep_value() != "":
+            return False
+        return True
+
+    @classmethod
+    def get(self, point_dir):
+        run_sh_path = os.path.join(point_dir, "run.sh")
+        assert os.path.exists(run_sh_path)
+        with open(run_sh_path, "r") as fp:
+            run_sh_lines = fp.readlines()
+
+        for line in run_sh_lines:
+            pos = line.find("--nvdla-parallel")
+            if pos != -1:
+                return True
+        return False
+
+    @classmethod
+    def default_value(cls):
+        return [""]
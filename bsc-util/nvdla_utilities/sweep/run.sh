@@ -3,12 +3,14 @@
 -d %(output-dir)s \
 %(config-dir)s --big-cpus 0 --little-cpus 1 --last-cache-level 2 --caches --accelerators \
 --little-cpu-clock %(little-cpu-clock)s \
+--cpu-type %(cpu-type)s \
 --freq-ratio %(freq-ratio)s \
 --numNVDLA %(numNVDLA)s \
 --maxReqNVDLA 1000 --enableTimingAXI \
 --restore-from %(cpt-dir)s \
 --bootscript=bootscript.rcS \
 --ddr-type %(ddr-type)s \
+--mem-size %(mem-size)s \
 --buffer-mode %(buffer-mode)s \
 %(dma-enable)s \
 %(shared-spm)s \
@@ -37,9 +39,13 @@
 --accel-sh-cache-clus %(accel-sh-cache-clus)s \
 %(pft-enable)s \
 --pft-threshold %(pft-threshold)s \
+--pft-lookahead %(pft-lookahead)s \
+--pft-depth %(pft-depth)s \
 %(use-fake-mem)s \
 %(cvsram-enable)s \
 --cvsram-size %(cvsram-size)s \
 --cvsram-bandwidth %(cvsram-bandwidth)s \
 --remapper %(remapper)s \
+--verilator-threads %(verilator-threads)s \
+%(nvdla-parallel)s \
 > stdout 2> stderr
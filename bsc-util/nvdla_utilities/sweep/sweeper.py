@@ -17,6 +17,8 @@ param_types = {
     "little-cpu-clock": LittleCPUClockParam,
     "freq-ratio": FreqRatioParam,
     "ddr-type": DDRTypeParam,
+    "mem-size": MemSizeParam,
+    "cpu-type": CPUTypeParam,
     "numNVDLA": NumNVDLAParam,
     "buffer-mode": BufferModeParam,
     "dma-enable": DMAEnableParam,
@@ -46,11 +48,15 @@ param_types = {
     "accel-sh-cache-clus": AccelShCacheClusParam,
     "pft-enable": PftEnableParam,
     "pft-threshold": PftThresholdParam,
+    "pft-lookahead": PftLookaheadParam,
+    "pft-depth": PftDepthParam,
     "use-fake-mem": UseFakeMemParam,
     "cvsram-enable": CVSRAMEnableParam,
     "cvsram-size": CVSRAMSizeParam,
     "cvsram-bandwidth": CVSRAMBandwidthParam,
-    "remapper": RemapperParam
+    "remapper": RemapperParam,
+    "verilator-threads": VerilatorThreadsParam,
+    "nvdla-parallel": NVDLAParallelParam
 }
 
 
@@ -71,6 +77,7 @@ class Sweeper:
         self.disk_image = args.disk_image
         self.template_dir = os.path.dirname(os.path.abspath(__file__))
         self.gem5_binary = args.gem5_binary
+        self.gem5_mt_binary = args.gem5_mt_binary
         self.sim_dir = args.sim_dir
         self.scheduler = args.scheduler
 
@@ -199,19 +206,36 @@ class Sweeper:
             rd_only_var_log = "rd_only_var_log" if mapper_pfx == "Identity" else trace_id + "_rd_only_var_log"
             run_cmd = "/home/" + self.scheduler + " " + os.path.join(new_sim_dir, trace_bin) + " " + \
                       os.path.join(self.sim_dir, rd_only_var_log)
+            # with several NVDLAs, every one of them runs the trace
+            for p in self.params_list[json_id][0]:
+                if isinstance(p, NumNVDLAParam) and int(p.curr_sweep_value()) > 1:
+                    run_cmd += " " + str(p.curr_sweep_value())
         elif "pipeline" in self.scheduler:
             if mapper_pfx == "Pipeline" or mapper_pfx == "PipelineWeightPin" or mapper_pfx == "PipelineActPin":
                 run_cmd = "/home/" + self.scheduler + " " + \
                           os.path.join(new_sim_dir, self.model_name + "_" + trace_id + "_") + \
                           " " + str(self.num_batches) + " " + str(mapper.num_stages)
+                # the dynamic scheduler may run the stages on fewer NVDLAs, unless they are pinned to theirs
+                if "dynamic" in self.scheduler:
+                    for p in self.params_list[json_id][0]:
+                        if isinstance(p, NumNVDLAParam):
+                            run_cmd += " " + str(p.curr_sweep_value())
+                    run_cmd += " 0" if mapper_pfx == "Pipeline" else " 1"
             else:
                 assert False
         else:
             assert False
 
+        # points with a multi-threaded verilator model need the binary linked against library_vcd_mt
+        gem5_binary = self.gem5_binary
+        for p in self.params_list[json_id][0]:
+            if isinstance(p, VerilatorThreadsParam) and int(p.curr_sweep_value()) > 0:
+                assert self.gem5_mt_binary is not None, "--gem5-mt-binary is needed to sweep verilator-threads"
+                gem5_binary = self.gem5_mt_binary
+
         # cpt-dir should be changed after regenerating a checkpoint
         change_config_file(point_dir, "run.sh",
-                           {"gem5-binary": self.gem5_binary.replace(self.home_path, self.new_home)})
+                           {"gem5-binary": gem5_binary.replace(self.home_path, self.new_home)})
 
         change_config_file(point_dir, "run.sh",
                            {"output-dir": os.path.abspath(point_dir).replace(self.home_path, self.new_home)})
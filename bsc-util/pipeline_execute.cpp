@@ -119,6 +119,11 @@ int main(int argc, char *argv[]) {
             }
         }
 
+        // sleep until one of the busy NVDLAs is done instead of polling them
+        uint64_t busy_mask = 0;
+        for(int i = 0; i < worker_num; i++) if(accel_busy[i]) busy_mask |= 1ULL << i;
+        m5_sleep_accel(busy_mask);
+
         for(int i = 0; i < worker_num; i++) {
             if(accel_busy[i]) {
                 accel_busy[i] = m5_wait_accel_id(i);
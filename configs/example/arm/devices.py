@@ -152,9 +152,9 @@ class CpuCluster(SubSystem):
         self.l2 = self._l2_type()
         for cpu in self.cpus:
             cpu.connectAllPorts(self.toL2Bus)
-            for i in range(4):
+            for accel in cpu.accel:
                 # mem_side is for loading NVDLA traces, not for runtime memory accesses
-                exec("cpu.accel_%d.mem_side = self.toL2Bus.cpu_side_ports" % i)
+                accel.mem_side = self.toL2Bus.cpu_side_ports
 
         self.toL2Bus.mem_side_ports = self.l2.cpu_side
 
@@ -175,7 +175,10 @@ class CpuCluster(SubSystem):
                 assert False
 
             if options.pft_enable:
-                pft_ctrl_str += ", prefetch_enable=1, pft_threshold=options.pft_threshold"
+                pft_ctrl_str += ", prefetch_enable=1, pft_threshold=options.pft_threshold" \
+                                ", dma_pft_threshold=options.dma_pft_threshold" \
+                                ", pft_lookahead=options.pft_lookahead, pft_depth=options.pft_depth" \
+                                ", pft_max_bw=options.pft_max_bw"
             else:
                 pft_ctrl_str += ", prefetch_enable=0"
 
@@ -184,29 +187,52 @@ class CpuCluster(SubSystem):
                 assert not options.add_accel_private_cache and not options.add_accel_shared_cache
                 dma_ctrl_str = "dma_enable=1, spm_latency=options.embed_spm_lat, spm_line_size=1024, " \
                                "spm_size=options.embed_spm_size, use_shared_spm=options.shared_spm, " \
-                               "assoc=options.embed_spm_assoc.lower()"
+                               "assoc=options.embed_spm_assoc.lower(), flat_spm=options.embed_spm_flat, " \
+                               "dma_read_channels=options.dma_read_channels"
+                if options.embed_spm_rp:
+                    dma_ctrl_str += ", spm_replacement_policy=ObjectList.rp_list.get(options.embed_spm_rp)()"
             else:
                 dma_ctrl_str = "dma_enable=0"
 
             fakemem_ctrl_str = "use_fake_mem=options.use_fake_mem, freq_ratio=options.freq_ratio, " \
-                               "print_path=os.path.join(os.path.abspath('.'), 'axilog')"
+                               "print_path=os.path.join(os.path.abspath('.'), 'axilog'), " \
+                               "axilog_compression=options.axilog_compression, " \
+                               "verilator_threads=options.verilator_threads, " \
+                               "verilator_cpu_base=options.verilator_cpu_base, " \
+                               "idle_skip_threshold=options.nvdla_idle_skip, " \
+                               "max_coalesce_bytes=options.nvdla_coalesce_bytes, " \
+                               "trace_fetch_depth=options.nvdla_trace_fetch_depth, " \
+                               "trace_functional_load=options.nvdla_trace_functional, " \
+                               "bulk_load_mem=options.nvdla_bulk_loadmem, " \
+                               "write_dump_files=not options.nvdla_no_dump_files, " \
+                               "checkpoint_layer=options.nvdla_checkpoint_layer, " \
+                               "fast_reset=options.nvdla_fast_reset"
+            if options.nvdla_record_replay:
+                # NVDLA i (accel_index) records replay.i, see configs/example/nvdla_replay.py
+                fakemem_ctrl_str += ", replay_trace=os.path.join(os.path.abspath('.'), 'replay')"
+            # classic caches only take packets within one cache line
+            if options.nvdla_coalesce_bytes > 64:
+                assert not options.add_accel_private_cache and not options.add_accel_shared_cache
             assert os.path.exists(os.path.join(os.path.abspath('.'), "run.sh"))     # make sure this is a simulation dir
-            os.system("rm " + os.path.join(os.path.abspath('.'), 'axilog') +
-                      " && touch " + os.path.join(os.path.abspath('.'), 'axilog'))
+            # NVDLA i (accel_index) writes axilog.i and its index axilog.i.idx
+            os.system("rm -f " + os.path.join(os.path.abspath('.'), 'axilog') + "*")
 
-            for i in range(4):
+            # NVDLA i is cpu.accel_i (which keeps its stats under accel_i) and is started through accel_port[i]
+            for i in range(options.numNVDLA):
                 exec("cpu.accel_%d = rtlNVDLA(%s, %s, %s)" % (i, dma_ctrl_str, pft_ctrl_str, fakemem_ctrl_str))
+            cpu.accel = [getattr(cpu, "accel_%d" % i) for i in range(options.numNVDLA)]
 
-            for i in range(4):
-                exec("cpu.accel_port_%d = cpu.accel_%d.cpu_side" % (i, i))
-                # e.g. cpu.accel_port_0 = cpu.accel_0.cpu_side
+            for accel in cpu.accel:
+                cpu.accel_port = accel.cpu_side
 
-            outside_ports = ["cpu.accel_%d.dram_port" % i for i in range(4)]
+            outside_ports = ["cpu.accel_%d.dram_port" % i for i in range(options.numNVDLA)]
 
             if options.cvsram_enable:
-                for i in range(4):
+                # the last numNVDLA memory ranges of the system are the cvsram windows, see SimpleSystem
+                for i in range(options.numNVDLA):
                     exec("self.accel_%d_cvsram = SimpleMemory(latency='2ns', latency_var='0ns', bandwidth='" % i +
-                         options.cvsram_bandwidth + "', port=cpu.accel_%d.sram_port, range=system.mem_ranges[i-4])" % i)
+                         options.cvsram_bandwidth + "', port=cpu.accel_%d.sram_port, "
+                         "range=system.mem_ranges[i-options.numNVDLA])" % i)
             if options.add_accel_private_cache:
                 for i in range(options.numNVDLA):
                     exec("self.accel_%d_pr_cache = Cache(tag_latency=options.accel_pr_cache_tag_lat,\
@@ -243,7 +269,7 @@ class CpuCluster(SubSystem):
             for port in outside_ports:
                 exec("%s = membus" % port)
 
-            for i in range(4):
+            for i in range(options.numNVDLA):
                 # still keep dma_port for cached config to avoid disconnection errors
                 exec("cpu.accel_%d.dma_port = membus" % i)
 
@@ -256,26 +282,33 @@ class CpuCluster(SubSystem):
                 # enable Timing
                 exec("cpu.accel_%d.enableTimingAXI = options.enableTimingAXI" % i)
 
-                # ids
+                # ids, id_nvdla restarts on every CPU while accel_index is unique in the system
                 exec("cpu.accel_%d.id_nvdla = %d" % (i, i))
+                exec("cpu.accel_%d.accel_index = %d" % (i, system._num_accels))
+                system._num_accels += 1
 
             # DRAM base addr, let all NVDLAs share common DRAM addr space,
             # while keep SRAM addr spaces private
-            cpu.accel_0.base_addr_dram = 0xA0000000
-            cpu.accel_1.base_addr_dram = 0xA0000000
-            cpu.accel_2.base_addr_dram = 0xA0000000
-            cpu.accel_3.base_addr_dram = 0xA0000000
-            # SRAM base addr
-            if options.cvsram_enable:
-                cpu.accel_0.base_addr_sram = system.mem_ranges[-4].start
-                cpu.accel_1.base_addr_sram = system.mem_ranges[-3].start
-                cpu.accel_2.base_addr_sram = system.mem_ranges[-2].start
-                cpu.accel_3.base_addr_sram = system.mem_ranges[-1].start
-            else:       # give a random address base
-                cpu.accel_0.base_addr_sram = 0xA5000000
-                cpu.accel_1.base_addr_sram = 0xB5000000
-                cpu.accel_2.base_addr_sram = 0xC5000000
-                cpu.accel_3.base_addr_sram = 0xD5000000
+            sram_window = 0x10000000
+            sram_ranges = [r for r in system.mem_ranges if int(r.end) > 0xA5000000]
+            next_sram = 0xA5000000
+            for i, accel in enumerate(cpu.accel):
+                accel.base_addr_dram = 0xA0000000
+                # SRAM base addr
+                if options.cvsram_enable:
+                    accel.base_addr_sram = system.mem_ranges[i - options.numNVDLA].start
+                    continue
+                # without cvsram the SRAM traffic goes to DRAM, one 256MB window per NVDLA carved out of
+                # the memory ranges from 0xA5000000 on
+                while sram_ranges and next_sram + sram_window > int(sram_ranges[0].end):
+                    sram_ranges.pop(0)
+                    if sram_ranges:
+                        next_sram = max(next_sram, int(sram_ranges[0].start))
+                if not sram_ranges:
+                    m5.fatal("no room in memory for the SRAM window of NVDLA %d, use --cvsram-enable or a "
+                             "larger --mem-size" % i)
+                accel.base_addr_sram = next_sram
+                next_sram += sram_window
 
     def addPMUs(self, ints, events=[]):
         """
@@ -309,6 +342,8 @@ class CpuCluster(SubSystem):
         except AttributeError:
             for cpu in self.cpus:
                 cpu.connectAllPorts(bus)
+                for accel in cpu.accel:
+                    accel.mem_side = bus.cpu_side_ports
 
 
 class AtomicCluster(CpuCluster):
@@ -320,6 +355,13 @@ class AtomicCluster(CpuCluster):
     def addL1(self):
         pass
 
+class TimingSimpleCluster(CpuCluster):
+    def __init__(self, system, num_cpus, cpu_clock, cpu_voltage="1.0V"):
+        cpu_config = [ ObjectList.cpu_list.get("TimingSimpleCPU"), L1I, L1D,
+                       WalkCache, L2 ]
+        super(TimingSimpleCluster, self).__init__(system, num_cpus, cpu_clock,
+                                                  cpu_voltage, *cpu_config)
+
 class KvmCluster(CpuCluster):
     def __init__(self, system, num_cpus, cpu_clock, cpu_voltage="1.0V"):
         cpu_config = [ ObjectList.cpu_list.get("ArmV8KvmCPU"), None, None,
@@ -497,7 +539,7 @@ class SimpleSystem(BaseSimpleSystem):
     """
     def __init__(self, caches, mem_size, accelerators,
                  cvsram_enable, cvsram_size,
-                 platform=None, **kwargs):
+                 platform=None, num_accelerators=1, **kwargs):
         super(SimpleSystem, self).__init__(mem_size, platform, **kwargs)
 
         self.membus = MemBus()
@@ -505,10 +547,12 @@ class SimpleSystem(BaseSimpleSystem):
         self.iobridge = Bridge(delay='50ns')
 
         self._accelerators = accelerators
+        # NVDLAs added so far over all the CPUs, see addPrivateAccelerator
+        self._num_accels = 0
 
         self._caches = caches
         if cvsram_enable:
-            for _ in range(4):
+            for _ in range(num_accelerators):
                 self.mem_ranges.append(AddrRange(start=self.mem_ranges[-1].end, size="256MB"))
                 # there are strided activation tensors. Use a fixed large memory size to avoid overflow currently
         if self._caches:
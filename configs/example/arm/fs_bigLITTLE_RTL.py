@@ -52,7 +52,7 @@ from common import Options
 from common.cores.arm import ex5_LITTLE
 
 import devices
-from devices import AtomicCluster, KvmCluster, FastmodelCluster
+from devices import AtomicCluster, TimingSimpleCluster, KvmCluster, FastmodelCluster
 
 default_kernel = '/home/gem5_linux_images/\
 aarch-system-20220707/binaries/vmlinux.arm64'
@@ -112,17 +112,18 @@ class Ex5LittleCluster(devices.CpuCluster):
 
 def createSystem(caches, kernel, accelerators, ddr_type, bootscript,
                  machine_type="VExpress_GEM5", disks=[], cvsram_enable=False, cvsram_size="1MB",
-                 mem_size=default_mem_size, bootloader=None):
+                 mem_size=default_mem_size, bootloader=None, num_accelerators=1):
     platform = ObjectList.platform_list.get(machine_type)
     m5.util.inform("Simulated platform: %s", platform.__name__)
 
     sys = devices.SimpleSystem(caches, mem_size, accelerators, cvsram_enable, cvsram_size, platform(),
+                               num_accelerators=num_accelerators,
                                workload=ArmFsLinux(
                                    object_file=SysPaths.binary(kernel)),
                                readfile=bootscript)
 
     # sys.mem_ctrls = [ SimpleMemory(range=r, port=sys.membus.mem_side_ports) for r in sys.mem_ranges ]
-    src_mem_ranges = sys.mem_ranges[:-4] if cvsram_enable else sys.mem_ranges
+    src_mem_ranges = sys.mem_ranges[:-num_accelerators] if cvsram_enable else sys.mem_ranges
     sys.mem_ctrls = [MemCtrl(dram=eval(ddr_type + "(range=r)"), port=sys.membus.mem_side_ports) for r in src_mem_ranges]
 
     sys.connect()
@@ -146,6 +147,7 @@ def createSystem(caches, kernel, accelerators, ddr_type, bootscript,
 
 cpu_types = {
     "atomic" : (AtomicCluster, AtomicCluster),
+    "timing-simple" : (TimingSimpleCluster, TimingSimpleCluster),
     "timing" : (BigCluster, LittleCluster),
     "exynos" : (Ex5BigCluster, Ex5LittleCluster),
 }
@@ -241,6 +243,19 @@ def addOptions(parser):
     # options.embed_spm_assoc
     parser.add_argument("--embed-spm-assoc", type=str, default="full", help="embedded buffer associativity: "
                                                                             "use string, full: fully-associative")
+    # options.embed_spm_flat
+    parser.add_argument("--embed-spm-flat", action="store_true", default=False,
+                        help="use the flat set layout (contiguous lines, packed tags, O(1) LRU) for the "
+                             "embedded buffer, worth it for large and highly associative buffers")
+    # options.embed_spm_rp
+    parser.add_argument("--embed-spm-rp", type=str, default=None,
+                        choices=ObjectList.rp_list.get_names(),
+                        help="replacement policy of the embedded buffer, LRU if not given. "
+                             "TreePLRURP takes its leaves from --embed-spm-assoc, so give it a number")
+    # options.dma_read_channels
+    parser.add_argument("--dma-read-channels", type=int, default=0,
+                        help="embedded buffer line fills the DMA engine keeps in flight (completing out of "
+                             "order), 0: one per embedded buffer line")
     # options.embed_spm_lat
     parser.add_argument("--embed-spm-lat", type=int, default=12, help="specify embedded SPM latency")
 
@@ -306,9 +321,63 @@ def addOptions(parser):
     parser.add_argument("--pft-enable", action="store_true", default=False, help="issue hardware prefetching when inflight request queue is underrun")
     # options.pft_threshold
     parser.add_argument("--pft-threshold", type=int, default=16, help="the threshold of current inflight memory requests to launch software prefetch")
+    # options.dma_pft_threshold
+    parser.add_argument("--dma-pft-threshold", type=int, default=8, help="prefetch only while fewer DMA line fills are in flight")
+    # options.pft_lookahead
+    parser.add_argument("--pft-lookahead", type=int, default=1, help="number of upcoming read-only variables prefetched at once")
+    # options.pft_depth
+    parser.add_argument("--pft-depth", type=int, default=0, help="bytes a read-only variable is prefetched ahead of the NVDLA, 0 for no limit")
+    # options.pft_max_bw
+    parser.add_argument("--pft-max-bw", type=int, default=0, help="stop prefetching while the measured read bandwidth is above "
+                        "this many bytes per NVDLA cycle, 0 for no limit")
     
     # options.use_fake_mem
     parser.add_argument("--use-fake-mem", action="store_true", default=False, help="whether to use fake memory to simulate")
+
+    # options.nvdla_parallel
+    parser.add_argument("--nvdla-parallel", action="store_true", default=False, help="run the RTL model of each NVDLA "
+                        "on its own event queue and host thread. Memory traffic is synchronized every --sim-quantum, "
+                        "so keep the quantum small (e.g., 1us) to limit the timing error")
+    # options.verilator_threads
+    parser.add_argument("--verilator-threads", type=int, default=0, help="worker threads of each verilated NVDLA model, "
+                        "must match the linked library (0: single-threaded, >0: library_vcd_mt)")
+    # options.verilator_cpu_base
+    parser.add_argument("--verilator-cpu-base", type=int, default=-1, help="first host cpu to pin verilator worker "
+                        "threads to, NVDLA i (counted over all the CPUs) uses the next verilator_threads cpus after "
+                        "base + i * verilator_threads")
+    # options.nvdla_idle_skip
+    parser.add_argument("--nvdla-idle-skip", type=int, default=0, help="stop evaluating the RTL after it has been "
+                        "stalled on memory for this many cycles and resume when data returns (0: never skip)")
+    # options.nvdla_coalesce_bytes
+    parser.add_argument("--nvdla-coalesce-bytes", type=int, default=64, help="merge contiguous AXI beats issued in "
+                        "the same cycle into packets of up to this many bytes (64: one packet per beat)")
+    # options.nvdla_trace_fetch_depth
+    parser.add_argument("--nvdla-trace-fetch-depth", type=int, default=16, help="cache line reads kept in flight "
+                        "while an NVDLA loads its trace")
+    # options.nvdla_trace_functional
+    parser.add_argument("--nvdla-trace-functional", action="store_true", default=False, help="load NVDLA traces "
+                        "functionally in zero simulated time instead of with timing reads")
+    # options.nvdla_no_dump_files
+    parser.add_argument("--nvdla-no-dump-files", action="store_true", default=False, help="only check the output "
+                        "tensors of NVDLA traces in memory, without writing them to files")
+    # options.axilog_compression
+    parser.add_argument("--axilog-compression", type=int, default=1, help="zlib level of the blocks of the "
+                        "per-NVDLA axilog files, 0 stores them uncompressed")
+    # options.nvdla_bulk_loadmem
+    parser.add_argument("--nvdla-bulk-loadmem", action="store_true", default=False, help="write load_mem payloads "
+                        "of NVDLA traces through a functional port proxy instead of one atomic packet per 64 bytes")
+    # options.nvdla_checkpoint_layer
+    parser.add_argument("--nvdla-checkpoint-layer", type=int, default=0, help="drop a checkpoint once an NVDLA "
+                        "has completed this many layers of its trace, needs a model verilated with --savable "
+                        "(0: never)")
+    # options.nvdla_fast_reset
+    parser.add_argument("--nvdla-fast-reset", type=int, default=0, choices=[0, 1, 2], help="reset the NVDLA RTL "
+                        "by restoring the state after the first reset of the process (1), also checking it against "
+                        "a full reset (2), needs a model verilated with --savable (0: always full reset)")
+    # options.nvdla_record_replay
+    parser.add_argument("--nvdla-record-replay", action="store_true", default=False, help="record the memory "
+                        "traffic of NVDLA i (counted over all the CPUs) to replay.i, to be replayed without the RTL by "
+                        "configs/example/nvdla_replay.py")
     
 
     parser.add_argument("-P", "--param", action="append", default=[],
@@ -355,7 +424,8 @@ def build(options):
                           cvsram_enable=options.cvsram_enable,
                           cvsram_size=options.cvsram_size,
                           mem_size=options.mem_size,
-                          bootloader=options.bootloader)
+                          bootloader=options.bootloader,
+                          num_accelerators=options.numNVDLA)
 
     root.system = system
     if options.kernel_cmd:
@@ -392,6 +462,12 @@ def build(options):
     # TODO: Maybe add the option to be global or shared
     if options.accelerators:
         system.addAccelerators(options)
+        if system.mem_mode != "timing":
+            # the NVDLAs are started and waited for by any CPU model, but
+            # their memory traffic is timing and only modeled as such
+            m5.util.warn("NVDLA memory traffic is timing, while the "
+                         "%s CPUs run in %s memory mode",
+                         options.cpu_type, system.mem_mode)
 
     # create caches
     system.addCaches(options.caches, options.last_cache_level)
@@ -405,6 +481,9 @@ def build(options):
     if issubclass(big_model, KvmCluster):
         _build_kvm(options, system, all_cpus)
 
+    if options.accelerators and options.nvdla_parallel:
+        _build_nvdla_parallel(options, all_cpus, issubclass(big_model, KvmCluster))
+
     # Linux device tree
     if options.dtb is not None:
         system.workload.dtb_filename = SysPaths.binary(options.dtb)
@@ -455,11 +534,23 @@ def _build_kvm(options, system, cpus):
 
 
 
+def _build_nvdla_parallel(options, cpus, kvm):
+    # Event queue 0 keeps the rest of the system and KVM CPUs (if any) take
+    # 1..len(cpus), the RTL model of every NVDLA gets one of the following.
+    # Only the tick of the NVDLAs moves, so ports and DMA engines are still
+    # served by the device event queue.
+    next_eq = len(cpus) + 1 if kvm and len(cpus) > 1 else 1
+    for cpu in cpus:
+        for i in range(options.numNVDLA):
+            getattr(cpu, "accel_%d" % i).tick_eventq_index = next_eq
+            next_eq += 1
+
+
 def instantiate(options, checkpoint_dir=None):
     # Setup the simulation quantum if we are running in PDES-mode
-    # (e.g., when using KVM)
+    # (e.g., when using KVM or --nvdla-parallel)
     root = Root.getInstance()
-    if root and _using_pdes(root):
+    if root and (_using_pdes(root) or (options.accelerators and options.nvdla_parallel)):
         m5.util.inform("Running in PDES mode with a %s simulation quantum.",
                        options.sim_quantum)
         root.sim_quantum = _to_ticks(options.sim_quantum)
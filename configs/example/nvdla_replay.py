@@ -0,0 +1,113 @@
+# Copyright (c) 2022 Barcelona Supercomputing Center
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are
+# met: redistributions of source code must retain the above copyright
+# notice, this list of conditions and the following disclaimer;
+# redistributions in binary form must reproduce the above copyright
+# notice, this list of conditions and the following disclaimer in the
+# documentation and/or other materials provided with the distribution;
+# neither the name of the copyright holders nor the names of its
+# contributors may be used to endorse or promote products derived from
+# this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+# "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+# A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+# OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+# LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+# DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+# THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+# Replays the memory traffic of NVDLAs recorded by
+# configs/example/arm/fs_bigLITTLE_RTL.py with --nvdla-record-replay, without
+# the RTL, on the memory system given by the common options. E.g.:
+#
+#   gem5.opt configs/example/nvdla_replay.py --mem-type=DDR4_2400_16x4 \
+#       --mem-size=4GB --replay-trace=m5out/replay.0
+#
+# Every replayNVDLA reports the cycles each recorded trace took against the
+# RTL run when it reaches its end.
+
+import argparse
+
+import m5
+from m5.objects import *
+from m5.util import addToPath, fatal
+
+addToPath('../')
+
+from common import Options
+from common import MemConfig
+
+parser = argparse.ArgumentParser()
+Options.addCommonOptions(parser)
+parser.add_argument("--replay-trace", action="append", default=[],
+                    help="replay trace of an NVDLA (e.g. replay.0), once per "
+                    "NVDLA replayed at the same time")
+parser.add_argument("--freq-ratio", type=int, default=0,
+                    help="=(cpu clock) / (frequency of NVDLA), 0 takes the "
+                    "one the traces were recorded with")
+parser.add_argument("--mem-base", type=str, default="0x80000000",
+                    help="start of memory, the recorded addresses have to "
+                    "fall into [mem-base, mem-base + mem-size)")
+parser.add_argument("--cvsram-bandwidth", type=str, default="128GB/s",
+                    help="bandwidth of the CVSRAM of each NVDLA")
+
+args = parser.parse_args()
+
+if not args.replay_trace:
+    fatal("Give the traces to replay with --replay-trace\n")
+
+system = System(mem_mode = 'timing',
+                mem_ranges = [AddrRange(int(args.mem_base, 0),
+                                        size = args.mem_size)],
+                cache_line_size = args.cacheline_size)
+
+system.voltage_domain = VoltageDomain(voltage = args.sys_voltage)
+system.clk_domain = SrcClockDomain(clock =  args.sys_clock,
+                                   voltage_domain = system.voltage_domain)
+
+# freq_ratio is relative to the clock of the CPU that drove the NVDLA
+system.cpu_voltage_domain = VoltageDomain()
+system.cpu_clk_domain = SrcClockDomain(clock = args.cpu_clock,
+                                       voltage_domain =
+                                       system.cpu_voltage_domain)
+
+system.membus = SystemXBar()
+system.system_port = system.membus.cpu_side_ports
+
+system.accel = [replayNVDLA(trace_file = trace,
+                            freq_ratio = args.freq_ratio,
+                            clk_domain = system.cpu_clk_domain)
+                for trace in args.replay_trace]
+# each NVDLA has a private CVSRAM, its data is not kept
+system.accel_cvsram = [SimpleMemory(latency = '2ns', latency_var = '0ns',
+                                    bandwidth = args.cvsram_bandwidth,
+                                    range = AddrRange(0, size = '1TB'),
+                                    in_addr_map = False, null = True)
+                       for trace in args.replay_trace]
+for accel, cvsram in zip(system.accel, system.accel_cvsram):
+    accel.dram_port = system.membus.cpu_side_ports
+    accel.sram_port = cvsram.port
+
+MemConfig.config_mem(args, system)
+
+root = Root(full_system = False, system = system)
+m5.instantiate()
+
+remaining = len(system.accel)
+while True:
+    event = m5.simulate()
+    if event.getCause() != "replay done":
+        break
+    remaining -= 1
+    if not remaining:
+        break
+
+print('Exiting @ tick %i because %s' % (m5.curTick(), event.getCause()))
@@ -0,0 +1,120 @@
+#ifndef GEM5_NVDLA_AXIBEAT_HH
+#define GEM5_NVDLA_AXIBEAT_HH
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// Data path kernels for one 512-bit AXI beat, shared by AXIResponder, the embedded buffer and the DMA
+// response path. The verilated w_wdata / r_rdata signals are arrays of 16 little-endian 32-bit words,
+// so on a little-endian host packing and unpacking them is a plain copy.
+// AVX2 is used when the model is compiled with -mavx2 (see SIMD_FLAGS in the Makefile), SSE2 otherwise
+// on x86-64, and portable scalar code elsewhere.
+
+#define AXI_BEAT_BYTES 64
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define AXI_BEAT_HOST_LE 1
+#else
+#define AXI_BEAT_HOST_LE 0
+#endif
+
+// dst[0:64) = src[0:64)
+inline void axi_beat_copy(uint8_t* dst, const uint8_t* src) {
+#if defined(__AVX2__)
+    _mm256_storeu_si256((__m256i*)dst, _mm256_loadu_si256((const __m256i*)src));
+    _mm256_storeu_si256((__m256i*)(dst + 32), _mm256_loadu_si256((const __m256i*)(src + 32)));
+#elif defined(__SSE2__)
+    for (int i = 0; i < AXI_BEAT_BYTES; i += 16)
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_loadu_si128((const __m128i*)(src + i)));
+#else
+    memcpy(dst, src, AXI_BEAT_BYTES);
+#endif
+}
+
+// bytes of a beat -> r_rdata words
+inline void axi_beat_pack(uint32_t* words, const uint8_t* bytes) {
+#if AXI_BEAT_HOST_LE
+    axi_beat_copy((uint8_t*)words, bytes);
+#else
+    for (int i = 0; i < AXI_BEAT_BYTES / 4; i++) {
+        words[i] = (bytes[4 * i]) +
+            (((uint32_t)bytes[4 * i + 1]) << 8) +
+            (((uint32_t)bytes[4 * i + 2]) << 16) +
+            (((uint32_t)bytes[4 * i + 3]) << 24);
+    }
+#endif
+}
+
+// w_wdata words -> bytes of a beat
+inline void axi_beat_unpack(uint8_t* bytes, const uint32_t* words) {
+#if AXI_BEAT_HOST_LE
+    axi_beat_copy(bytes, (const uint8_t*)words);
+#else
+    for (int i = 0; i < AXI_BEAT_BYTES / 4; i++) {
+        bytes[4 * i    ] = (words[i]      ) & 0xFF;
+        bytes[4 * i + 1] = (words[i] >>  8) & 0xFF;
+        bytes[4 * i + 2] = (words[i] >> 16) & 0xFF;
+        bytes[4 * i + 3] = (words[i] >> 24) & 0xFF;
+    }
+#endif
+}
+
+// 8 strobe bits -> 8 byte lanes of 0x00 / 0xFF, lane i (in memory order) selected by bit i
+inline uint64_t axi_strb_to_lanes(uint8_t strb) {
+    uint64_t x = (strb * 0x0101010101010101ULL) & 0x8040201008040201ULL;
+    // make every non-zero byte 0x80, then widen it to 0xFF
+    x = (((x & 0x7F7F7F7F7F7F7F7FULL) + 0x7F7F7F7F7F7F7F7FULL) | x) & 0x8080808080808080ULL;
+    return (x >> 7) * 0xFF;
+}
+
+// dst[i] = src[i] for every byte i whose bit is set in the wstrb-like mask strb
+inline void axi_beat_merge(uint8_t* dst, const uint8_t* src, uint64_t strb) {
+    if (strb == ~(uint64_t)0) {
+        axi_beat_copy(dst, src);
+        return;
+    }
+    if (strb == 0)
+        return;
+#if defined(__AVX2__)
+    // byte j of each 64-bit lane picks strobe byte (lane index), then tests bit j of it
+    const __m256i spread = _mm256_setr_epi64x(0x0000000000000000LL, 0x0101010101010101LL,
+                                              0x0202020202020202LL, 0x0303030303030303LL);
+    const __m256i bits = _mm256_set1_epi64x((long long)0x8040201008040201ULL);
+    for (int half = 0; half < 2; half++) {
+        __m256i m = _mm256_set1_epi32((int)(uint32_t)(strb >> (32 * half)));
+        m = _mm256_shuffle_epi8(m, spread);
+        m = _mm256_cmpeq_epi8(_mm256_and_si256(m, bits), bits);
+        __m256i d = _mm256_loadu_si256((const __m256i*)(dst + 32 * half));
+        __m256i s = _mm256_loadu_si256((const __m256i*)(src + 32 * half));
+        _mm256_storeu_si256((__m256i*)(dst + 32 * half), _mm256_blendv_epi8(d, s, m));
+    }
+#elif defined(__SSE2__) && AXI_BEAT_HOST_LE
+    for (int i = 0; i < AXI_BEAT_BYTES; i += 16) {
+        __m128i m = _mm_set_epi64x((long long)axi_strb_to_lanes(strb >> (i + 8)),
+                                   (long long)axi_strb_to_lanes(strb >> i));
+        __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+        __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_or_si128(_mm_and_si128(m, s), _mm_andnot_si128(m, d)));
+    }
+#elif AXI_BEAT_HOST_LE
+    for (int i = 0; i < AXI_BEAT_BYTES; i += 8) {
+        uint64_t m = axi_strb_to_lanes(strb >> i);
+        uint64_t d, s;
+        memcpy(&d, dst + i, 8);
+        memcpy(&s, src + i, 8);
+        d = (s & m) | (d & ~m);
+        memcpy(dst + i, &d, 8);
+    }
+#else
+    for (int i = 0; i < AXI_BEAT_BYTES; i++) {
+        if ((strb >> i) & 1)
+            dst[i] = src[i];
+    }
+#endif
+}
+
+#endif //GEM5_NVDLA_AXIBEAT_HH
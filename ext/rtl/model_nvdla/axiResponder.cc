@@ -13,6 +13,7 @@
 
 
 #include <assert.h>
+#include <algorithm>
 #include "axiResponder.hh"
 
 AXIResponder::AXIResponder(struct connections _dla,
@@ -22,9 +23,11 @@ AXIResponder::AXIResponder(struct connections _dla,
                            const unsigned int maxReq,
                            bool _dma_enable):
                                AXI_R_LATENCY(_dma_enable ? _wrapper->spm->spm_latency : 0), dla(_dla), name(_name),
-                               max_req_inflight((maxReq < 240) ? maxReq : 240), dma_enable(_dma_enable),
-                               inflight_count_for_sets(_wrapper->spm->num_sets, 0),
-                               pft_threshold(16), dma_pft_threshold(8), wrapper(_wrapper), sram(sram_) {
+                               max_req_inflight((maxReq < 240) ? maxReq : 240),
+                               // arready is kept high up to max_req_inflight, then one burst of up to 256 beats
+                               inflight_req(max_req_inflight + 256 + 1), dma_enable(_dma_enable),
+                               inflight_count_for_sets(_wrapper->spm->num_sets, 0), pending_demand_reads(0),
+                               read_bytes_this_cycle(0), read_bw(0.), wrapper(_wrapper), sram(sram_) {
     *dla.aw_awready = 1;
     *dla.w_wready = 1;
     *dla.b_bvalid = 0;
@@ -92,12 +95,7 @@ AXIResponder::eval_ram() {
         #endif
         axi_w_txn txn;
 
-        for (int i = 0; i < AXI_WIDTH / 32; i++) {
-            txn.wdata[4 * i    ] =  dla.w_wdata[i]        & 0xFF;
-            txn.wdata[4 * i + 1] = (dla.w_wdata[i] >>  8) & 0xFF;
-            txn.wdata[4 * i + 2] = (dla.w_wdata[i] >> 16) & 0xFF;
-            txn.wdata[4 * i + 3] = (dla.w_wdata[i] >> 24) & 0xFF;
-        }
+        axi_beat_unpack(txn.wdata, dla.w_wdata);
         txn.wstrb = *dla.w_wstrb;
         txn.wlast = *dla.w_wlast;
         w_fifo.push(txn);
@@ -215,12 +213,7 @@ AXIResponder::eval_ram() {
         *dla.r_rvalid = txn.rvalid;
         *dla.r_rid = txn.rid;
         *dla.r_rlast = txn.rlast;
-        for (int i = 0; i < AXI_WIDTH / 32; i++) {
-            dla.r_rdata[i] = txn.rdata[4 * i    ]         +
-                (((uint32_t) txn.rdata[4 * i + 1]) <<  8) +
-                (((uint32_t) txn.rdata[4 * i + 2]) << 16) +
-                (((uint32_t) txn.rdata[4 * i + 3]) << 24);
-        }
+        axi_beat_pack(dla.r_rdata, txn.rdata);
         #ifdef PRINT_DEBUG
             if (txn.rvalid) {
                 printf("(%lu) %s: read push: id %d, da %02x %02x %02x %02x %02x %02x %02x %02x\n",
@@ -263,6 +256,7 @@ AXIResponder::eval_timing() {
         txn.awid = *dla.aw_awid;
         txn.awaddr = *dla.aw_awaddr & ~(uint64_t)(AXI_WIDTH / 8 - 1);
         txn.awlen = *dla.aw_awlen;
+        txn.issue_tick = wrapper->tickcount;
         aw_fifo.push(std::move(txn));
 
         *dla.aw_awready = 0;
@@ -282,32 +276,30 @@ AXIResponder::eval_timing() {
 
         axi_w_txn txn;
 #ifndef NO_DATA
-        for (int i = 0; i < AXI_WIDTH / 32; i++) {
-            txn.wdata[4 * i    ] = (dla.w_wdata[i]      ) & 0xFF;
-            txn.wdata[4 * i + 1] = (dla.w_wdata[i] >>  8) & 0xFF;
-            txn.wdata[4 * i + 2] = (dla.w_wdata[i] >> 16) & 0xFF;
-            txn.wdata[4 * i + 3] = (dla.w_wdata[i] >> 24) & 0xFF;
-        }
+        axi_beat_unpack(txn.wdata, dla.w_wdata);
 #endif
         txn.wstrb = *dla.w_wstrb;
         txn.wlast = *dla.w_wlast;
         w_fifo.push(txn);
     }
 
+    // moving average over about 32 cycles
+    read_bw += (read_bytes_this_cycle - read_bw) / 32;
+    read_bytes_this_cycle = 0;
+
     /* read request */
     bool issued_req_this_cycle = process_read_req();
 
 #ifdef PRINT_DEBUG
-    if (inflight_req_order.size() > 0) {
+    if (inflight_req.size() > 0) {
         printf("(%lu) nvdla#%d %s: Remaining %d\n",
                 wrapper->tickcount, wrapper->id_nvdla, name,
-                inflight_req_order.size());
+                inflight_req.size());
     }
 #endif
 
     //! generate prefetch request
-    if ((wrapper->prefetch_enable && !sram) && inflight_req_order.size() < pft_threshold &&
-        inflight_dma_addr_queue.size() < dma_pft_threshold && !issued_req_this_cycle) {
+    if ((wrapper->prefetch_enable && !sram) && !issued_req_this_cycle) {
         generate_prefetch_request();
     }
 
@@ -343,6 +335,8 @@ AXIResponder::eval_timing() {
             #ifdef PRINT_DEBUG
                 printf("(%lu) nvdla#%d %s: write, last tick\n", wrapper->tickcount, wrapper->id_nvdla, name);
             #endif
+            if (wrapper->stats_recorder)
+                wrapper->stats_recorder->axi_write_done(sram, awtxn.awid, wrapper->tickcount - awtxn.issue_tick);
             aw_fifo.pop();
 
             axi_b_txn btxn;
@@ -389,12 +383,7 @@ AXIResponder::eval_timing() {
             *dla.r_rid = txn.rid;
             *dla.r_rlast = txn.rlast;
 #ifndef NO_DATA
-            for (int i = 0; i < AXI_WIDTH / 32; i++) {
-                dla.r_rdata[i] = (txn.rdata[4 * i]) +
-                    (((uint32_t)txn.rdata[4 * i + 1]) << 8) +
-                    (((uint32_t)txn.rdata[4 * i + 2]) << 16) +
-                    (((uint32_t)txn.rdata[4 * i + 3]) << 24);
-            }
+            axi_beat_pack(dla.r_rdata, txn.rdata);
 #endif
             #ifdef PRINT_DEBUG
             printf("(%lu) nvdla#%d %s: read push: id %d, da %08x %08x %08x %08x\n",
@@ -452,17 +441,15 @@ AXIResponder::process_read_req() {
                 txn.rlast = (j == len);
                 txn.rid = *dla.ar_arid;
                 txn.is_prefetch = 0;
+                txn.issue_tick = wrapper->tickcount;
 
                 if (wrapper->prefetch_enable && !sram) log_req_issue(start_addr);
 
                 // check spm and write queue
                 bool data_get_in_spm = wrapper->spm->read_spm_axi_line(start_addr, txn.rdata, *dla.ar_arid);
-                inflight_req_order.push_back(start_addr);
-
-                std::map<uint64_t, std::list<axi_r_txn>>::iterator req_it;
-                bool req_alloc_succ;
-                std::tie(req_it, req_alloc_succ) = inflight_req.emplace(start_addr, std::list<axi_r_txn>());
-                req_it->second.push_back(txn);
+                txn.rvalid = data_get_in_spm;
+                if (wrapper->stats_recorder) wrapper->stats_recorder->spm_read(data_get_in_spm);
+                uint64_t req_handle = inflight_req.push(start_addr, txn);
 
                 if (data_get_in_spm) {
                     // need to maintain the order of issuing requests
@@ -472,7 +459,6 @@ AXIResponder::process_read_req() {
                     PRINT_EB_HIT(wrapper->print_buffer, wrapper->buf_ptr,
                                  wrapper->id_nvdla, wrapper->tickcount, start_addr);
 #endif
-                    req_it->second.back().rvalid = 1;
                 } else {
                     // first check whether this addr has been covered by an inflight DMA request or not
                     uint64_t spm_line_addr = start_addr & ~((uint64_t)(wrapper->spm->spm_line_size - 1));
@@ -489,13 +475,14 @@ AXIResponder::process_read_req() {
                                            wrapper->tickcount, spm_line_addr);
 #endif
                         map_it->second.is_bypass = (wrapper->buf_mode != BUF_MODE_ALL);
-                        inflight_dma_addr_queue.push(spm_line_addr);
+                        map_it->second.is_prefetch = false;
+                        map_it->second.issue_tick = wrapper->tickcount;
                         wrapper->addDMAReadReq(spm_line_addr, wrapper->spm->spm_line_size);
                         inflight_count_for_sets[(spm_line_addr / wrapper->spm->spm_line_size) % wrapper->spm->num_sets]++;
                         issued_req_this_cycle = true;
                     }
-                    map_it->second.deps.emplace_back(start_addr, std::prev(req_it->second.end()));
-                    req_it->second.back().rvalid = 0;
+                    map_it->second.deps.emplace_back(start_addr, req_handle);
+                    pending_demand_reads++;
                 }
             }
         } else {
@@ -508,16 +495,16 @@ AXIResponder::process_read_req() {
                 txn.rlast = len == 0;
                 txn.rid = *dla.ar_arid;
                 txn.is_prefetch = 0;
+                txn.issue_tick = wrapper->tickcount;
 
                 bool prefetched = false;
                 if (wrapper->prefetch_enable && !sram)
                     prefetched = log_req_issue(addr);
                 bool cache_read = prefetched;
 
-                // put txn to the map
-                inflight_req[addr].push_back(txn);
-                // put in req the txn
-                inflight_req_order.push_back(addr);
+                // put txn to the inflight ring
+                inflight_req.push(addr, txn);
+                pending_demand_reads++;
 
                 wrapper->addReadReq(sram, true, true, addr, AXI_WIDTH / 8);
 
@@ -528,40 +515,36 @@ AXIResponder::process_read_req() {
         // next cycle we are not ready
         *dla.ar_arready = 0;
     } else {
-        *dla.ar_arready = (inflight_req_order.size() <= max_req_inflight);
+        *dla.ar_arready = (inflight_req.size() <= max_req_inflight);
     }
 
     return issued_req_this_cycle;
 }
 
 
+uint64_t
+AXIResponder::first_demand_read() {
+    // find the first non-prefetch inflight_req txn;
+    // arrived prefetches have already been retired in inflight_resp()
+    uint64_t h = inflight_req.front();
+    while (h != inflight_req.end() && inflight_req.at(h).is_prefetch)
+        h = inflight_req.next(h);
+    return h;
+}
+
+
 void
 AXIResponder::process_read_resp() {
-    auto it_addr = inflight_req_order.begin();
-    std::map<uint64_t, std::list<axi_r_txn>>::iterator req_it;
-    std::list<axi_r_txn>* req_list_ptr;
-
-    while (true) {
-        if (it_addr == inflight_req_order.end()) {
-            // this automatically filters out empty inflight_req_order
-            return;
-        }
-        req_it = inflight_req.find(*it_addr);
-        req_list_ptr = &(req_it->second);
-        if (req_list_ptr->front().is_prefetch) {
-            // find the first non-prefetch inflight_req addr;
-            // assume all entries in inflight_req & inflight_req_order for arrived prefetches
-            // have been removed in inflight_resp() and inflight_resp_dma()
-            it_addr++;
-        } else {
-            break;
-        }
+    uint64_t h = first_demand_read();
+    if (h == inflight_req.end()) {
+        // this automatically filters out empty inflight_req
+        return;
     }
 
     // that's a non-prefetch txn. we'll check valid or not below
-    uint64_t addr_front = *it_addr;
+    uint64_t addr_front = inflight_req.addr_of(h);
 
-    axi_r_txn &txn = req_list_ptr->front();
+    axi_r_txn &txn = inflight_req.at(h);
     if (txn.rvalid) {  // ensures the order of response
 #ifndef AXI_RESP_FAST_IO
         printf("(%lu) read data used by nvdla#%d (returned by gem5 or already in spm), addr %#lx\n",
@@ -570,16 +553,15 @@ AXIResponder::process_read_resp() {
         PRINT_DATA_USED(wrapper->print_buffer, wrapper->buf_ptr, wrapper->id_nvdla, name[0], wrapper->tickcount, addr_front);
 #endif
 
+        if (txn.rlast && wrapper->stats_recorder)
+            wrapper->stats_recorder->axi_read_done(sram, txn.rid, wrapper->tickcount - txn.issue_tick);
+
         // push the front one
         r_fifo.push(txn);
         // todo: add some AXI_R_DELAY txns. currently we are setting AXI_R_DELAY = 0 so it is also correct
 
         // remove the front
-        req_list_ptr->pop_front();
-        // check if empty to remove entry from map
-        if (req_list_ptr->empty()) inflight_req.erase(req_it);
-        // delete in the queue order
-        inflight_req_order.erase(it_addr);
+        inflight_req.retire(h);
     }
 }
 
@@ -591,51 +573,26 @@ AXIResponder::inflight_resp(uint64_t addr, const uint8_t* data) {
                 wrapper->tickcount, wrapper->id_nvdla, name, addr);
     #endif
 
-    auto addr_it = inflight_req.find(addr);
-    std::list<axi_r_txn>& req_list = addr_it->second;
+    // Get the oldest txn to addr still waiting for data
+    uint64_t h = inflight_req.find(addr);
+    while (h != inflight_req.NONE && inflight_req.at(h).rvalid)
+        h = inflight_req.next_same(h);
+    assert(h != inflight_req.NONE);
 
-    auto it = req_list.begin();
-    // Get the correct ptr
-    int count_pos = 0;
-    while (it != req_list.end() && it->rvalid) {
-       it++;
-       count_pos++;
-    }
-    assert(it != req_list.end());
+    axi_r_txn& txn = inflight_req.at(h);
 #ifndef NO_DATA
-    for (int i = 0; i < AXI_WIDTH / 8; i++) {
-        it->rdata[i] = data[i];
-    }
+    axi_beat_copy(txn.rdata, data);
 #endif
-    it->rvalid = 1;
-    if (it->is_prefetch) {
+    txn.rvalid = 1;
+    read_bytes_this_cycle += AXI_WIDTH / 8;
+    if (txn.is_prefetch) {
 #ifndef AXI_RESP_FAST_IO
         printf("(%lu) nvdla#%d read data returned by gem5 PREFETCH, addr %#lx\n", wrapper->tickcount, wrapper->id_nvdla, addr);
 #else
         PRINT_PFT_BACK(wrapper->print_buffer, wrapper->buf_ptr, wrapper->id_nvdla, wrapper->tickcount, addr);
 #endif
-        //! delete this txn in inflight_req_order and inflight_req
-        // first delete in inflight_req_order
-        bool deleted = false;
-        for (auto a_it = inflight_req_order.begin(); a_it != inflight_req_order.end(); a_it++) {
-            if ((*a_it) == addr) {
-                if (count_pos == 0) {
-                    // that's the exact addr_it that should be deleted
-                    inflight_req_order.erase(a_it);
-                    deleted = true;
-                    break;
-                } else {
-                    count_pos--;
-                }
-            }
-        }
-        assert(deleted);
-
-        // then delete in inflight_req
-        req_list.erase(it);
-        if (req_list.empty()) {
-            inflight_req.erase(addr_it);
-        }
+        //! delete this txn in inflight_req, the data now lives in the cache hierarchy
+        inflight_req.retire(h);
 
     } else {
 #ifndef AXI_RESP_FAST_IO
@@ -643,18 +600,17 @@ AXIResponder::inflight_resp(uint64_t addr, const uint8_t* data) {
 #else
         PRINT_AXI_BACK(wrapper->print_buffer, wrapper->buf_ptr, wrapper->id_nvdla, wrapper->tickcount, addr);
 #endif
+        pending_demand_reads--;
     }
     #ifdef PRINT_DEBUG
-    printf("Remaining %d\n", inflight_req_order.size());
+    printf("Remaining %d\n", inflight_req.size());
     printf("(%lu) nvdla#%d %s: Inflight Resp Timing Finished: addr %08lx \n",
             wrapper->tickcount, wrapper->id_nvdla, name, addr);
     #endif
 }
 
 void
-AXIResponder::inflight_dma_resp(const uint8_t* data, uint32_t len) {
-    //! we HAVE TO assume dma is in-order. If it is out-of-order due to bus arbitration, even DMAFifo can't handle it
-    uint64_t addr = inflight_dma_addr_queue.front();
+AXIResponder::inflight_dma_resp(uint64_t addr, const uint8_t* data, uint32_t len) {
 #ifndef AXI_RESP_FAST_IO
     printf("(%lu) nvdla#%d AXIResponder handling DMA return data addr %#lx with length %d.\n",
            wrapper->tickcount, wrapper->id_nvdla, addr, len);
@@ -664,21 +620,24 @@ AXIResponder::inflight_dma_resp(const uint8_t* data, uint32_t len) {
 
     auto addr_it = inflight_dma_attr.find(addr);
     assert(addr_it != inflight_dma_attr.end());
+    read_bytes_this_cycle += len;
+    if (wrapper->stats_recorder)
+        wrapper->stats_recorder->dma_read_done(addr_it->second.is_prefetch,
+                                               wrapper->tickcount - addr_it->second.issue_tick);
     if (!addr_it->second.is_bypass)     // if not bypass, then write this data
         wrapper->spm->fill_spm_line(addr, data);
 
-    for (auto dep : inflight_dma_attr[addr].deps) {
+    for (auto dep : addr_it->second.deps) {
         auto txn_addr = dep.first;
-        auto txn_it = dep.second;
+        axi_r_txn& txn = inflight_req.at(dep.second);
 #ifndef NO_DATA
-        for (uint64_t pos = 0; pos < AXI_WIDTH / 8; pos++)
-            txn_it->rdata[pos] = data[txn_addr - addr + pos];
+        axi_beat_copy(txn.rdata, data + (txn_addr - addr));
 #endif
-        txn_it->rvalid = 1;
+        txn.rvalid = 1;
+        pending_demand_reads--;
     }
 
     inflight_dma_attr.erase(addr_it);
-    inflight_dma_addr_queue.pop();
     inflight_count_for_sets[(addr / wrapper->spm->spm_line_size) % wrapper->spm->num_sets]--;
 }
 
@@ -697,21 +656,22 @@ AXIResponder::read_for_traceLoaderGem5(uint64_t start_addr, uint32_t length) {
         txn.rlast = (txn_start_addr + delta_addr + (AXI_WIDTH / 8) >= start_addr + length);
         txn.is_prefetch = 0;
         txn.rid = 0;
+        txn.issue_tick = wrapper->tickcount;
         if (dma_enable) {
             bool got = wrapper->spm->read_spm_axi_line(txn_addr, txn.rdata, 0);
             if (got) {
                 txn.rvalid = 1;
             } else {    // when verifying results, no need to use dma...
                 wrapper->addReadReq(sram, true, false, txn_addr, AXI_WIDTH / 8);
+                pending_demand_reads++;
             }
         } else {
             wrapper->addReadReq(sram, true, true, txn_addr, AXI_WIDTH / 8);
+            pending_demand_reads++;
         }
 
-        // put txn to the map
-        inflight_req[txn_addr].push_back(txn);
-        // put in req the txn
-        inflight_req_order.push_back(txn_addr);
+        // put txn to the inflight ring
+        inflight_req.push(txn_addr, txn);
     }
 }
 
@@ -719,8 +679,9 @@ AXIResponder::read_for_traceLoaderGem5(uint64_t start_addr, uint32_t length) {
 uint32_t
 AXIResponder::read_response_for_traceLoaderGem5(uint64_t start_addr, uint8_t* data_buffer) {
     // check status of memory reading request
-    assert(!inflight_req_order.empty());
-    uint64_t addr_front = inflight_req_order.front();
+    assert(!inflight_req.empty());
+    uint64_t h = inflight_req.front();
+    uint64_t addr_front = inflight_req.addr_of(h);
 
     if (addr_front != start_addr) {
         // this should not happen
@@ -729,24 +690,14 @@ AXIResponder::read_response_for_traceLoaderGem5(uint64_t start_addr, uint8_t* da
         abort();
     }
 
-    auto& addr_front_list = inflight_req[addr_front];
-
-    assert(!addr_front_list.empty());
-    axi_r_txn& txn = addr_front_list.front();
+    axi_r_txn& txn = inflight_req.at(h);
     if (txn.rvalid) {
         printf("(%lu) nvdla#%d memory request at addr %#lx has arrived.\n", wrapper->tickcount, wrapper->id_nvdla, start_addr);
 
         // get the value
-        for (uint32_t i = 0; i < AXI_WIDTH / 8; i++) {
-            data_buffer[i] = txn.rdata[i];
-        }
+        axi_beat_copy(data_buffer, txn.rdata);
 
-        addr_front_list.pop_front();
-        if (addr_front_list.empty()) {
-            inflight_req.erase(addr_front);
-        }
-
-        inflight_req_order.pop_front();
+        inflight_req.retire(h);
 
         return 1;
     } else {
@@ -757,63 +708,97 @@ AXIResponder::read_response_for_traceLoaderGem5(uint64_t start_addr, uint8_t* da
 
 uint32_t
 AXIResponder::getRequestsOnFlight() {
-    return inflight_req_order.size();
+    return inflight_req.size();
+}
+
+bool
+AXIResponder::is_quiet() {
+    if (*dla.ar_arvalid || *dla.aw_awvalid || *dla.w_wvalid)
+        return false;
+    if (!r_fifo.empty() || !aw_fifo.empty() || !w_fifo.empty() || !b_fifo.empty())
+        return false;
+
+    // the oldest non-prefetch txn must not be ready, otherwise process_read_resp() has work to do
+    uint64_t h = first_demand_read();
+    return h == inflight_req.end() || !inflight_req.at(h).rvalid;
+}
+
+bool
+AXIResponder::waits_for_memory() {
+    return pending_demand_reads > 0;
 }
 
 void
 AXIResponder::add_rd_var_log_entry(uint64_t addr, uint32_t size) {
-    read_var_log.emplace_back(addr, size, 0);
+    read_var_log.push_back(addr, size);
 }
 
 bool
 AXIResponder::log_req_issue(uint64_t addr) {
     bool prefetched = true;
-    for (auto it = read_var_log.begin(); it != read_var_log.end(); it++) {
-        uint32_t& log_entry_length = std::get<1>(*it);
-        uint64_t& log_entry_addr = std::get<0>(*it);
-
-        if (log_entry_addr <= addr && addr < log_entry_addr + log_entry_length) {
-            uint32_t& log_entry_issued_len = std::get<2>(*it);
-            if (addr >= log_entry_addr + log_entry_issued_len) {
-                if (addr > log_entry_addr + log_entry_issued_len) {
+    uint32_t h = read_var_log.find(addr);
+    if (h != readVarLog::NONE) {
+        read_var& var = read_var_log.at(h);
+        uint32_t offset = addr - var.addr;
+        var.used_len = std::max(var.used_len, offset + (AXI_WIDTH / 8));
+        if (offset >= var.issued_len) {
+            if (offset > var.issued_len) {
 #ifndef AXI_RESP_FAST_IO
-                    printf("(%lu) nvdla#%d addr issued is beyond the log. addr = %#lx, log_entry_addr = %#lx, "
-                           "log_entry_issued_len = %#x\n", wrapper->tickcount, wrapper->id_nvdla, addr, log_entry_addr,
-                           log_entry_issued_len);
+                printf("(%lu) nvdla#%d addr issued is beyond the log. addr = %#lx, log_entry_addr = %#lx, "
+                       "log_entry_issued_len = %#x\n", wrapper->tickcount, wrapper->id_nvdla, addr, var.addr,
+                       var.issued_len);
 #endif
-                    // todo: ignore the problem currently. I think it may be caused by repetitive accesses of
-                    //  inputs / biases. But now we've removed inputs from rd_only_var_log,
-                    //  I suppose this shouldn't happen again.
-                    log_entry_issued_len = addr - log_entry_addr;
-                }
-                // (addr == log_entry_addr + log_entry_issued_lens) is the normal case
-                log_entry_issued_len += (AXI_WIDTH / 8);
-                prefetched = false;
-
-                if (log_entry_issued_len >= log_entry_length)
-                    read_var_log.erase(it);
-            } else {
-                // printf("read req for %#x has been covered by a previous pft / fetch.\n", addr);
+                // todo: ignore the problem currently. I think it may be caused by repetitive accesses of
+                //  inputs / biases. But now we've removed inputs from rd_only_var_log,
+                //  I suppose this shouldn't happen again.
+                var.issued_len = offset;
             }
-            // since requests are either solely DMA or solely cache-line-sized,
-            // it is not possible that log_entry_issued_len is not aligned with spm_line_size
-            break;
+            // (offset == issued_len) is the normal case
+            var.issued_len += (AXI_WIDTH / 8);
+            prefetched = false;
+
+            if (var.issued_len >= var.length)
+                read_var_log.retire(h);
+        } else {
+            // printf("read req for %#x has been covered by a previous pft / fetch.\n", addr);
         }
+        // since requests are either solely DMA or solely cache-line-sized,
+        // it is not possible that issued_len is not aligned with spm_line_size
     }
     // a mem req might also be covered by a popped entry, so no assert for logged
     return prefetched;
 }
 
+bool
+AXIResponder::can_issue_prefetch() {
+    if (inflight_req.size() >= wrapper->pft_threshold || inflight_dma_attr.size() >= wrapper->dma_pft_threshold)
+        return false;
+    // leave the rest of the bandwidth to demand reads
+    return !wrapper->pft_max_bw || read_bw < wrapper->pft_max_bw;
+}
+
 void
 AXIResponder::generate_prefetch_request() {
-    if (read_var_log.empty())
-        return;
-    // assume the front of the list is a legal entry to prefetch
-    uint64_t& log_entry_addr = std::get<0>(read_var_log.front());
-    uint32_t& log_entry_length = std::get<1>(read_var_log.front());
-    uint32_t& log_entry_issued_len = std::get<2>(read_var_log.front());
+    // one line per cycle from each of the next pft_lookahead read-only variables, so that the weights of the
+    // next layers stream in while the current one is still computing
+    uint32_t streams = 0;
+    uint32_t h = read_var_log.front();
+    while (h != read_var_log.end() && streams < wrapper->pft_lookahead && can_issue_prefetch()) {
+        streams++;
+        uint32_t next = read_var_log.next(h);
+        read_var& var = read_var_log.at(h);
+        // do not run more than pft_depth bytes ahead of the RTL within one variable
+        if (!wrapper->pft_depth || var.issued_len < var.used_len + wrapper->pft_depth) {
+            if (prefetch_read_var(var))     // this prefetch is the end of the variable
+                read_var_log.retire(h);
+        }
+        h = next;
+    }
+}
 
-    uint64_t to_issue_addr = log_entry_addr + log_entry_issued_len;
+bool
+AXIResponder::prefetch_read_var(read_var& var) {
+    uint64_t to_issue_addr = var.addr + var.issued_len;
     bool can_preftch;
     switch (wrapper->buf_mode) {
         case BUF_MODE_ALL:
@@ -836,6 +821,7 @@ AXIResponder::generate_prefetch_request() {
         // write to the txn
         txn.rvalid = 0;     // since read addresses are streaming, we don't think this is present in spm (if dma_enable)
         txn.is_prefetch = 1;
+        txn.issue_tick = wrapper->tickcount;
         // if to_issue_addr is covered by a previous dma, it's useless to issue such prefetch request
 
         if (dma_enable) {
@@ -856,16 +842,17 @@ AXIResponder::generate_prefetch_request() {
                 PRINT_DMA_PFT_ISSUE(wrapper->print_buffer, wrapper->buf_ptr, wrapper->id_nvdla, wrapper->tickcount, spm_line_addr);
 #endif
                 map_it->second.is_bypass = false;
+                map_it->second.is_prefetch = true;
+                map_it->second.issue_tick = wrapper->tickcount;
 
-                inflight_dma_addr_queue.push(spm_line_addr);
                 wrapper->addDMAReadReq(spm_line_addr, wrapper->spm->spm_line_size);
                 inflight_count_for_sets[(spm_line_addr / wrapper->spm->spm_line_size) % wrapper->spm->num_sets]++;
 
-                log_entry_issued_len += spm_line_addr + wrapper->spm->spm_line_size - to_issue_addr;
                 // here we don't add dma prefetch to inflight_req and inflight_order
                 // because as long as spm can get the prefetched data, we don't bother axi responder to check it
-
-            }   // else we don't need a new dma request. it is covered by a previous one
+            }
+            // else the line is covered by a previous DMA request, move on to the next one
+            var.issued_len += spm_line_addr + wrapper->spm->spm_line_size - to_issue_addr;
         } else {
 #ifndef AXI_RESP_FAST_IO
             printf("(%lu) nvdla#%d PREFETCH request addr 0x%08lx issued.\n", wrapper->tickcount, wrapper->id_nvdla,
@@ -873,16 +860,68 @@ AXIResponder::generate_prefetch_request() {
 #else
             PRINT_PFT_ISSUE(wrapper->print_buffer, wrapper->buf_ptr, wrapper->id_nvdla, wrapper->tickcount, to_issue_addr);
 #endif
-            inflight_req[to_issue_addr].push_back(txn);
-            inflight_req_order.push_back(to_issue_addr);
+            inflight_req.push(to_issue_addr, txn);
 
             // cacheable for buf_mode = BUF_MODE_ALL, BUF_MODE_PFT and BUF_MODE_PFT_CUTOFF
             wrapper->addReadReq(sram, true, true, to_issue_addr, AXI_WIDTH / 8);
-            log_entry_issued_len += AXI_WIDTH / 8;
+            var.issued_len += AXI_WIDTH / 8;
             // todo: here the gap of issuing should be cache line size. currently cache line size == AXI_WIDTH/8
         }
     }
 
-    if (log_entry_issued_len >= log_entry_length)       // this prefetch is the end of the variable
-        read_var_log.pop_front();
+    return var.issued_len >= var.length;
+}
+
+void
+AXIResponder::save(std::ostream& os) {
+    ckpt_save(os, r_fifo);
+    ckpt_save(os, r0_fifo);
+    ckpt_save(os, aw_fifo);
+    ckpt_save(os, w_fifo);
+    ckpt_save(os, b_fifo);
+    ckpt_save(os, ram);
+    inflight_req.save(os);
+
+    ckpt_save(os, (uint64_t)inflight_dma_attr.size());
+    for (auto& entry : inflight_dma_attr) {
+        ckpt_save(os, entry.first);
+        ckpt_save(os, entry.second.is_bypass);
+        ckpt_save(os, entry.second.is_prefetch);
+        ckpt_save(os, entry.second.issue_tick);
+        ckpt_save(os, entry.second.deps);
+    }
+    ckpt_save(os, inflight_count_for_sets);
+    ckpt_save(os, pending_demand_reads);
+    read_var_log.save(os);
+    ckpt_save(os, read_bytes_this_cycle);
+    ckpt_save(os, read_bw);
+}
+
+void
+AXIResponder::restore(std::istream& is) {
+    ckpt_restore(is, r_fifo);
+    ckpt_restore(is, r0_fifo);
+    ckpt_restore(is, aw_fifo);
+    ckpt_restore(is, w_fifo);
+    ckpt_restore(is, b_fifo);
+    ckpt_restore(is, ram);
+    inflight_req.restore(is);
+
+    uint64_t num_dma = 0;
+    ckpt_restore(is, num_dma);
+    inflight_dma_attr.clear();
+    for (uint64_t i = 0; i < num_dma && is; i++) {
+        uint64_t addr;
+        ckpt_restore(is, addr);
+        DMAAttr& attr = inflight_dma_attr[addr];
+        ckpt_restore(is, attr.is_bypass);
+        ckpt_restore(is, attr.is_prefetch);
+        ckpt_restore(is, attr.issue_tick);
+        ckpt_restore(is, attr.deps);
+    }
+    ckpt_restore(is, inflight_count_for_sets);
+    ckpt_restore(is, pending_demand_reads);
+    read_var_log.restore(is);
+    ckpt_restore(is, read_bytes_this_cycle);
+    ckpt_restore(is, read_bw);
 }
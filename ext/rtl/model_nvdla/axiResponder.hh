@@ -36,8 +36,13 @@
 #include <list>
 #include <unordered_map>
 
+#include "axiBeat.hh"
+#include "inflightRing.hh"
+#include "readVarLog.hh"
 #include "wrapper_nvdla.hh"
 
+static_assert(AXI_WIDTH / 8 == AXI_BEAT_BYTES, "AXI data path kernels assume 512-bit beats");
+
 class Wrapper_nvdla;
 
 class AXIResponder {
@@ -84,6 +89,7 @@ private:
         uint8_t rdata[AXI_WIDTH / 8];
         uint8_t rid;
         uint8_t is_prefetch;
+        uint64_t issue_tick;    // when the RTL issued the read
     };
     std::queue<axi_r_txn> r_fifo;
     std::queue<axi_r_txn> r0_fifo;
@@ -92,6 +98,7 @@ private:
         uint8_t awid;
         uint64_t awaddr;
         uint8_t awlen;
+        uint64_t issue_tick;
     };
     std::queue<axi_aw_txn> aw_fifo;
 
@@ -113,27 +120,41 @@ private:
     const char *name;
 
     // gem5 memory
-    // map key:addr, data:txn
-    std::map<uint64_t, std::list<axi_r_txn>> inflight_req;
-    std::list<uint64_t> inflight_req_order;
+    // inflight read txns in issue order, indexed by addr
     const unsigned int max_req_inflight;
+    inflightRing<axi_r_txn> inflight_req;
 
     // dma & spm
-    // function together with inflight_req & inflight_req_order
+    // function together with inflight_req
     const bool dma_enable;
 
     struct DMAAttr {
         bool is_bypass;
-        std::vector<std::pair<uint64_t, std::list<axi_r_txn>::iterator> > deps;
+        bool is_prefetch;
+        uint64_t issue_tick;
+        std::vector<std::pair<uint64_t, uint64_t> > deps;     // (txn addr, handle in inflight_req)
     };
-    std::map<uint64_t, DMAAttr> inflight_dma_attr;  // record the inflight dma attribute: whether to bypass DMA
-    std::queue<uint64_t> inflight_dma_addr_queue;   // keep dma request order
+    std::map<uint64_t, DMAAttr> inflight_dma_attr;  // inflight dma line fills by spm line addr: whether to bypass, who waits
     std::vector<uint32_t> inflight_count_for_sets;  // count inflight dma requests for each embedded buffer set
 
+    // non-prefetch txns in inflight_req whose data has not arrived, i.e., the RTL is waiting for them
+    uint32_t pending_demand_reads;
+
     // prefetch
-    const uint32_t pft_threshold;
-    const uint32_t dma_pft_threshold;
-    std::list<std::tuple<uint64_t, uint32_t, uint32_t>> read_var_log;  // each tuple is (addr, length, issued_len) of a read-only variable
+    // read-only variables of the trace that are not fully issued yet, indexed by addr
+    readVarLog read_var_log;
+
+    // bytes returned by memory this cycle and their moving average per cycle, throttles prefetching
+    uint32_t read_bytes_this_cycle;
+    double read_bw;
+
+    // whether the inflight requests, DMA line fills and measured bandwidth leave room for one more prefetch
+    bool can_issue_prefetch();
+    // prefetch the next line of var, true if var is then fully issued
+    bool prefetch_read_var(read_var& var);
+
+    // handle of the oldest non-prefetch txn in inflight_req, inflight_req.end() if there is none
+    uint64_t first_demand_read();
 
 public:
     AXIResponder(struct connections _dla,
@@ -144,6 +165,13 @@ public:
                  bool _dma_enable);
 
     uint32_t getRequestsOnFlight();
+    // how often inflight_req had to grow on the heap
+    const uint64_t& getInflightGrows() const { return inflight_req.grows(); }
+
+    // no AXI handshake to serve and no read data ready to return to the RTL
+    bool is_quiet();
+    // some non-prefetch read issued by the RTL is still waiting for gem5 / DMA
+    bool waits_for_memory();
 
     // In this function we read from memory
     uint8_t read_ram(uint64_t addr);
@@ -168,13 +196,18 @@ public:
 
     // callback methods, called by gem5 ports in rtlNVDLA when data is returned
     void inflight_resp(uint64_t addr, const uint8_t* data);
-    void inflight_dma_resp(const uint8_t* data, uint32_t len);
+    // DMA line fills may complete in any order, addr tells which one it is
+    void inflight_dma_resp(uint64_t addr, const uint8_t* data, uint32_t len);
 
     // prefetching-related
     void add_rd_var_log_entry(uint64_t addr, uint32_t size);
     bool log_req_issue(uint64_t addr);
     void generate_prefetch_request();
 
+    // checkpoint of the FIFOs, inflight txns (with their data if it has arrived) and prefetch state
+    void save(std::ostream& os);
+    void restore(std::istream& is);
+
     Wrapper_nvdla *wrapper;
 
     const bool sram;
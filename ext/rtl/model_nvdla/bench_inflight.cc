@@ -0,0 +1,216 @@
+/*
+ * Micro-benchmark of the read issue path of AXIResponder.
+ *
+ * Replays a synthetic AXI read stream (bursts of beats issued while fewer than max_req_inflight
+ * reads are outstanding, memory responses arriving out of order, prefetches retired as soon as
+ * their data returns, demand reads retired in order) against the inflightRing used by
+ * AXIResponder and against the std::map<addr, std::list<txn>> + std::list<addr> bookkeeping it
+ * replaced. Both must retire the same txns in the same order.
+ *
+ * Build & run: make bench_inflight
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <list>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "inflightRing.hh"
+
+#define AXI_WIDTH 512
+
+struct axi_r_txn {
+    int rvalid;
+    int rlast;
+    bool burst;
+    uint8_t rdata[AXI_WIDTH / 8];
+    uint8_t rid;
+    uint8_t is_prefetch;
+};
+
+enum op_type { OP_ISSUE, OP_RESP, OP_RETIRE };
+struct op {
+    op_type type;
+    uint64_t addr;
+    uint8_t is_prefetch;
+};
+
+// the same stream is replayed by both implementations
+static std::vector<op> make_stream(uint32_t num_reads, uint32_t max_req_inflight) {
+    std::mt19937_64 rng(1);
+    std::vector<op> ops;
+    std::vector<std::pair<uint64_t, uint8_t>> waiting;   // issued, data not back
+    std::list<std::pair<uint64_t, bool>> order;          // demand reads: (addr, data back)
+    uint64_t next_addr = 0x80000000;
+    uint32_t inflight = 0;
+    uint32_t issued = 0;
+
+    while (issued < num_reads || inflight) {
+        if (issued < num_reads && inflight <= max_req_inflight) {
+            uint32_t beats = 1 + rng() % 8;
+            uint8_t pft = (rng() % 8 == 0);
+            for (uint32_t j = 0; j < beats; j++) {
+                // revisit some recent addresses so that chains of the same addr form
+                uint64_t addr = (rng() % 16 == 0 && next_addr > 0x80000000 + 4096) ?
+                                next_addr - 64 * (1 + rng() % 64) : next_addr;
+                next_addr += 64;
+                ops.push_back({OP_ISSUE, addr, pft});
+                waiting.emplace_back(addr, pft);
+                if (!pft) order.emplace_back(addr, false);
+                inflight++;
+                issued++;
+            }
+        }
+        for (uint32_t k = 0; k < 2 && !waiting.empty(); k++) {
+            // memory returns the oldest txn to an addr first, like gem5 does for the same port
+            uint32_t pick = rng() % (waiting.size() < 16 ? waiting.size() : 16);
+            uint64_t addr = waiting[pick].first;
+            for (uint32_t q = 0; q < pick; q++)
+                if (waiting[q].first == addr) { pick = q; break; }
+            ops.push_back({OP_RESP, addr, waiting[pick].second});
+            if (waiting[pick].second) {
+                inflight--;
+            } else {
+                for (auto& o : order)
+                    if (o.first == addr && !o.second) { o.second = true; break; }
+            }
+            waiting.erase(waiting.begin() + pick);
+        }
+        if (!order.empty() && order.front().second) {
+            ops.push_back({OP_RETIRE, order.front().first, 0});
+            order.pop_front();
+            inflight--;
+        }
+    }
+    return ops;
+}
+
+struct baseline {
+    std::map<uint64_t, std::list<axi_r_txn>> inflight_req;
+    std::list<uint64_t> inflight_req_order;
+
+    void issue(uint64_t addr, const axi_r_txn& txn) {
+        inflight_req[addr].push_back(txn);
+        inflight_req_order.push_back(addr);
+    }
+
+    void resp(uint64_t addr, const uint8_t* data) {
+        auto addr_it = inflight_req.find(addr);
+        std::list<axi_r_txn>& req_list = addr_it->second;
+        auto it = req_list.begin();
+        int count_pos = 0;
+        while (it != req_list.end() && it->rvalid) { it++; count_pos++; }
+        assert(it != req_list.end());
+        memcpy(it->rdata, data, AXI_WIDTH / 8);
+        it->rvalid = 1;
+        if (it->is_prefetch) {
+            for (auto a_it = inflight_req_order.begin(); a_it != inflight_req_order.end(); a_it++) {
+                if (*a_it == addr) {
+                    if (count_pos == 0) { inflight_req_order.erase(a_it); break; }
+                    count_pos--;
+                }
+            }
+            req_list.erase(it);
+            if (req_list.empty()) inflight_req.erase(addr_it);
+        }
+    }
+
+    uint64_t retire(uint8_t* data) {
+        auto it_addr = inflight_req_order.begin();
+        auto req_it = inflight_req.find(*it_addr);
+        while (req_it->second.front().is_prefetch) {
+            it_addr++;
+            req_it = inflight_req.find(*it_addr);
+        }
+        uint64_t addr = *it_addr;
+        assert(req_it->second.front().rvalid);
+        memcpy(data, req_it->second.front().rdata, AXI_WIDTH / 8);
+        req_it->second.pop_front();
+        if (req_it->second.empty()) inflight_req.erase(req_it);
+        inflight_req_order.erase(it_addr);
+        return addr;
+    }
+};
+
+struct ring {
+    inflightRing<axi_r_txn> inflight_req;
+
+    explicit ring(uint32_t max_req_inflight) : inflight_req(max_req_inflight + 256 + 1) {}
+
+    void issue(uint64_t addr, const axi_r_txn& txn) { inflight_req.push(addr, txn); }
+
+    void resp(uint64_t addr, const uint8_t* data) {
+        uint64_t h = inflight_req.find(addr);
+        while (h != inflight_req.NONE && inflight_req.at(h).rvalid) h = inflight_req.next_same(h);
+        assert(h != inflight_req.NONE);
+        axi_r_txn& txn = inflight_req.at(h);
+        memcpy(txn.rdata, data, AXI_WIDTH / 8);
+        txn.rvalid = 1;
+        if (txn.is_prefetch) inflight_req.retire(h);
+    }
+
+    uint64_t retire(uint8_t* data) {
+        uint64_t h = inflight_req.front();
+        while (inflight_req.at(h).is_prefetch) h = inflight_req.next(h);
+        uint64_t addr = inflight_req.addr_of(h);
+        assert(inflight_req.at(h).rvalid);
+        memcpy(data, inflight_req.at(h).rdata, AXI_WIDTH / 8);
+        inflight_req.retire(h);
+        return addr;
+    }
+};
+
+template <typename Impl>
+static double replay(Impl& impl, const std::vector<op>& ops, std::vector<uint64_t>& retired) {
+    axi_r_txn txn;
+    memset(&txn, 0, sizeof(txn));
+    uint8_t data[AXI_WIDTH / 8];
+    memset(data, 0x5a, sizeof(data));
+
+    auto start = std::chrono::steady_clock::now();
+    for (const op& o : ops) {
+        switch (o.type) {
+            case OP_ISSUE:
+                txn.is_prefetch = o.is_prefetch;
+                impl.issue(o.addr, txn);
+                break;
+            case OP_RESP:
+                impl.resp(o.addr, data);
+                break;
+            case OP_RETIRE:
+                retired.push_back(impl.retire(data));
+                break;
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / ops.size();
+}
+
+int main(int argc, char* argv[]) {
+    uint32_t num_reads = (argc > 1) ? atoi(argv[1]) : 2000000;
+    const uint32_t max_req_inflight = 240;
+    std::vector<op> ops = make_stream(num_reads, max_req_inflight);
+
+    std::vector<uint64_t> retired_base, retired_ring;
+    retired_base.reserve(num_reads);
+    retired_ring.reserve(num_reads);
+
+    baseline b;
+    ring r(max_req_inflight);
+    double ns_base = replay(b, ops, retired_base);
+    double ns_ring = replay(r, ops, retired_ring);
+
+    if (retired_base != retired_ring || !r.inflight_req.empty()) {
+        printf("inflightRing retired txns differently from the map/list baseline\n");
+        return 1;
+    }
+    printf("%lu ops (%u reads, max_req_inflight = %u)\n", ops.size(), num_reads, max_req_inflight);
+    printf("map + list:   %8.2f ns/op\n", ns_base);
+    printf("inflightRing: %8.2f ns/op (%.2fx)\n", ns_ring, ns_base / ns_ring);
+    return 0;
+}
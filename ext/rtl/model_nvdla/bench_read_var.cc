@@ -0,0 +1,162 @@
+/*
+ * Micro-benchmark of the read-only variable lookups of AXIResponder.
+ *
+ * Replays a synthetic DBB read stream (the RTL reading the weight tensors of a large network in log order,
+ * interleaved with activation reads that no variable covers, and one prefetch line per cycle from each of
+ * the next pft_lookahead variables) against the readVarLog used by AXIResponder and against the linear
+ * scan of a std::list it replaced. Both must classify every read and retire every variable the same way.
+ *
+ * Build & run: make bench_read_var
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <list>
+#include <random>
+#include <vector>
+
+#include "readVarLog.hh"
+
+#define AXI_WIDTH 512
+#define LINE (AXI_WIDTH / 8)
+
+enum op_type { OP_READ, OP_PREFETCH };
+struct op {
+    op_type type;
+    uint64_t addr;
+};
+
+// the same stream is replayed by both implementations
+static std::vector<op> make_stream(std::vector<std::pair<uint64_t, uint32_t>>& log, uint32_t num_vars) {
+    std::mt19937_64 rng(1);
+    uint64_t next_addr = 0x80000000;
+    for (uint32_t i = 0; i < num_vars; i++) {
+        uint32_t length = LINE * (16 + rng() % 4096);
+        log.emplace_back(next_addr, length);
+        // some biases are logged twice
+        if (rng() % 32 == 0) log.emplace_back(next_addr, length);
+        next_addr += length + LINE * (rng() % 64);
+    }
+
+    std::vector<op> ops;
+    uint64_t act_base = next_addr + (1 << 20);
+    for (auto& var : log) {
+        for (uint32_t offset = 0; offset < var.second; offset += LINE) {
+            ops.push_back({OP_READ, var.first + offset});
+            if (rng() % 2) ops.push_back({OP_READ, act_base + LINE * (rng() % 65536)});
+            ops.push_back({OP_PREFETCH, 0});
+        }
+    }
+    return ops;
+}
+
+static bool log_req_issue(read_var& var, uint64_t addr, bool& retire) {
+    uint32_t offset = addr - var.addr;
+    var.used_len = std::max(var.used_len, offset + LINE);
+    retire = false;
+    if (offset < var.issued_len) return true;
+    var.issued_len = offset + LINE;
+    retire = var.issued_len >= var.length;
+    return false;
+}
+
+static bool prefetch(read_var& var, uint32_t pft_depth) {
+    if (pft_depth && var.issued_len >= var.used_len + pft_depth) return false;
+    var.issued_len += LINE;
+    return var.issued_len >= var.length;
+}
+
+struct baseline {
+    std::list<read_var> read_var_log;
+
+    void add(uint64_t addr, uint32_t length) { read_var_log.push_back({addr, length, 0, 0}); }
+
+    bool read(uint64_t addr) {
+        for (auto it = read_var_log.begin(); it != read_var_log.end(); it++) {
+            if (it->addr <= addr && addr < it->addr + it->length) {
+                bool retire;
+                bool prefetched = log_req_issue(*it, addr, retire);
+                if (retire) read_var_log.erase(it);
+                return prefetched;
+            }
+        }
+        return true;
+    }
+
+    void generate_prefetch(uint32_t lookahead, uint32_t pft_depth) {
+        uint32_t streams = 0;
+        auto it = read_var_log.begin();
+        while (it != read_var_log.end() && streams++ < lookahead) {
+            if (prefetch(*it, pft_depth)) it = read_var_log.erase(it);
+            else it++;
+        }
+    }
+
+    uint32_t size() const { return read_var_log.size(); }
+};
+
+struct indexed {
+    readVarLog read_var_log;
+
+    void add(uint64_t addr, uint32_t length) { read_var_log.push_back(addr, length); }
+
+    bool read(uint64_t addr) {
+        uint32_t h = read_var_log.find(addr);
+        if (h == readVarLog::NONE) return true;
+        bool retire;
+        bool prefetched = log_req_issue(read_var_log.at(h), addr, retire);
+        if (retire) read_var_log.retire(h);
+        return prefetched;
+    }
+
+    void generate_prefetch(uint32_t lookahead, uint32_t pft_depth) {
+        uint32_t streams = 0;
+        uint32_t h = read_var_log.front();
+        while (h != read_var_log.end() && streams++ < lookahead) {
+            uint32_t next = read_var_log.next(h);
+            if (prefetch(read_var_log.at(h), pft_depth)) read_var_log.retire(h);
+            h = next;
+        }
+    }
+
+    uint32_t size() const { return read_var_log.size(); }
+};
+
+template <typename Impl>
+static double replay(Impl& impl, const std::vector<std::pair<uint64_t, uint32_t>>& log, const std::vector<op>& ops,
+                     std::vector<bool>& prefetched) {
+    for (auto& var : log) impl.add(var.first, var.second);
+
+    auto start = std::chrono::steady_clock::now();
+    for (const op& o : ops) {
+        if (o.type == OP_READ) prefetched.push_back(impl.read(o.addr));
+        else impl.generate_prefetch(4, 64 * LINE);
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / ops.size();
+}
+
+int main(int argc, char* argv[]) {
+    uint32_t num_vars = (argc > 1) ? atoi(argv[1]) : 320;   // about the weight tensors of ResNet50
+    std::vector<std::pair<uint64_t, uint32_t>> log;
+    std::vector<op> ops = make_stream(log, num_vars);
+
+    std::vector<bool> prefetched_base, prefetched_index;
+    baseline b;
+    indexed x;
+    double ns_base = replay(b, log, ops, prefetched_base);
+    double ns_index = replay(x, log, ops, prefetched_index);
+
+    if (prefetched_base != prefetched_index || b.size() != x.size()) {
+        printf("readVarLog classified reads differently from the list baseline\n");
+        return 1;
+    }
+    printf("%lu ops (%lu logged variables)\n", ops.size(), log.size());
+    printf("list scan:  %8.2f ns/op\n", ns_base);
+    printf("readVarLog: %8.2f ns/op (%.2fx)\n", ns_index, ns_base / ns_index);
+    return 0;
+}
@@ -166,6 +166,23 @@ bool CSBMaster::done() {
     return opq.empty();
 }
 
+bool CSBMaster::idle(int noop) {
+    if (opq.empty() || noop)
+        return true;
+    const csb_op &op = opq.front();
+    return !op.is_ext && !op.write && op.wait_until;
+}
+
 int CSBMaster::test_passed() {
     return _test_passed;
 }
+
+void CSBMaster::save(std::ostream& os) {
+    ckpt_save(os, opq);
+    ckpt_save(os, _test_passed);
+}
+
+void CSBMaster::restore(std::istream& is) {
+    ckpt_restore(is, opq);
+    ckpt_restore(is, _test_passed);
+}
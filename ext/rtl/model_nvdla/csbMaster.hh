@@ -50,6 +50,13 @@ public:
 
     bool done();
 
+    // nothing to send to the RTL but (maybe) polling an interrupt register
+    bool idle(int noop);
+
     int test_passed(); 
+
+    // checkpoint of the ops not sent yet, see Wrapper_nvdla::save
+    void save(std::ostream& os);
+    void restore(std::istream& is);
 };
 #endif // __CSB_MASTER__
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include "embeddedBuffer.hh"
 
 
@@ -10,8 +11,9 @@ abstractSet::abstractSet(Wrapper_nvdla* wrap, uint32_t _lat, uint32_t _line_size
 abstractSet::~abstractSet() = default;
 
 
-allBufferSet::allBufferSet(Wrapper_nvdla* wrap, uint32_t _lat, uint32_t _line_size, uint32_t _assoc) :
-        abstractSet(wrap, _lat, _line_size, _assoc) {
+allBufferSet::allBufferSet(Wrapper_nvdla* wrap, uint32_t _lat, uint32_t _line_size, uint32_t _assoc,
+                           spmReplacementPolicy* _rp, uint32_t _set_id) :
+        abstractSet(wrap, _lat, _line_size, _assoc), rp(_rp), set_id(_set_id) {
     for (uint32_t i = 0; i < assoc; i++) {
         lru_order.emplace_back(i);
     }
@@ -35,10 +37,10 @@ bool allBufferSet::read_spm_axi_line(uint64_t axi_addr, uint8_t* data_out) {
 
     auto& entry = lines[addr_map_it->second];
 #ifndef NO_DATA
-    for (int i = 0; i < AXI_WIDTH / 8; i++)
-        data_out[i] = entry.spm_line[offset + i];
+    axi_beat_copy(data_out, &entry.spm_line[offset]);
 #endif
     lru_order.splice(lru_order.end(), lru_order, entry.lru_it);
+    if (rp) rp->touch(set_id, addr_map_it->second, addr_base);
     return true;
 }
 
@@ -54,6 +56,7 @@ bool allBufferSet::read_spm_line(uint64_t aligned_addr, std::vector<uint8_t>& da
     entry.valid = 0;
     auto& line = entry.spm_line;
     data_out.assign(line.begin(), line.end());
+    if (rp) rp->invalidate(set_id, addr_map_it->second);
     addr_map.erase(addr_map_it);
     entry.map_it = addr_map.end();
     // leave the lru_it there. It will be managed once new data is written to this line
@@ -91,29 +94,23 @@ void allBufferSet::write_spm_axi_line_with_mask(uint64_t axi_addr, const uint8_t
         auto& entry = lines[addr_map_it->second];
         entry.map_it = addr_map_it;
         entry.valid = 1;
+        if (rp) rp->reset(set_id, to_write_vec_id, addr_base);
     }
     auto& entry = lines[addr_map_it->second];
     entry.dirty = 1;
 #ifndef NO_DATA
-    if (mask == 0xFFFFFFFFFFFFFFFF) {
-        for (int i = 0; i < AXI_WIDTH / 8; i++) {
-            entry.spm_line[offset + i] = data[i];
-        }
-    } else {
-        for (int i = 0; i < AXI_WIDTH / 8; i++) {
-            if (!((mask >> i) & 1))
-                continue;
-            entry.spm_line[offset + i] = data[i];
-        }
-    }
+    axi_beat_merge(&entry.spm_line[offset], data, mask);
 #endif
 }
 
 
 void allBufferSet::clear_and_write_back_dirty() {
     for (auto& line: lines) {
+        if (rp && line.valid)
+            rp->invalidate(set_id, &line - &lines[0]);
         if (line.dirty) {
             wrapper->addDMAWriteReq(line.map_it->first, line.spm_line);
+            if (wrapper->stats_recorder) wrapper->stats_recorder->spm_write_back();
             line.dirty = 0;
         }
         line.map_it = addr_map.end();
@@ -150,6 +147,7 @@ void allBufferSet::fill_spm_line(uint64_t aligned_addr, const uint8_t* data) {
         entry.map_it = addr_map_it;
         entry.valid = 1;
         entry.dirty = 0;
+        if (rp) rp->reset(set_id, to_write_vec_id, aligned_addr);
 #ifndef NO_DATA
         entry.spm_line.assign(data, data + spm_line_size);
 #endif
@@ -160,19 +158,334 @@ void allBufferSet::fill_spm_line(uint64_t aligned_addr, const uint8_t* data) {
 
 
 uint32_t allBufferSet::erase_victim() {
-    auto to_erase_id = lru_order.front();
+    auto to_erase_id = rp ? rp->get_victim(set_id) : lru_order.front();
+    assert(to_erase_id < assoc);
     auto& entry = lines[to_erase_id];
     assert(entry.valid);
     if (entry.dirty) {
         wrapper->addDMAWriteReq(entry.map_it->first, entry.spm_line);
+        if (wrapper->stats_recorder) wrapper->stats_recorder->spm_write_back();
     }
+    if (wrapper->stats_recorder) wrapper->stats_recorder->spm_evict();
     addr_map.erase(entry.map_it);
     entry.valid = 0;
     lru_order.splice(lru_order.end(), lru_order, entry.lru_it);
+    if (rp) rp->invalidate(set_id, to_erase_id);
     return to_erase_id;
 }
 
 
+// lines are saved in way order, the LRU order separately
+void allBufferSet::save(std::ostream& os) {
+    std::vector<uint32_t> order(lru_order.begin(), lru_order.end());
+    ckpt_save(os, order);
+    for (auto& line: lines) {
+        ckpt_save(os, line.valid);
+        ckpt_save(os, line.dirty);
+        ckpt_save(os, line.valid ? line.map_it->first : (uint64_t)0);
+        ckpt_save(os, line.spm_line);
+    }
+}
+
+
+void allBufferSet::restore(std::istream& is) {
+    std::vector<uint32_t> order;
+    ckpt_restore(is, order);
+    if (order.size() != assoc) {
+        is.setstate(std::ios::failbit);
+        return;
+    }
+    lru_order.assign(order.begin(), order.end());
+    for (auto it = lru_order.begin(); it != lru_order.end(); it++) {
+        lines[*it].lru_it = it;
+    }
+
+    addr_map.clear();
+    for (auto& line: lines) {
+        uint64_t tag;
+        ckpt_restore(is, line.valid);
+        ckpt_restore(is, line.dirty);
+        ckpt_restore(is, tag);
+        ckpt_restore(is, line.spm_line);
+        line.map_it = line.valid ? addr_map.emplace(tag, &line - &lines[0]).first : addr_map.end();
+    }
+
+    // the policy state is not part of the checkpoint, replay the insertions from the least recently used line
+    if (rp) {
+        for (uint32_t way = 0; way < assoc; way++) rp->invalidate(set_id, way);
+        for (uint32_t way: lru_order) {
+            if (lines[way].valid) rp->reset(set_id, way, lines[way].map_it->first);
+        }
+    }
+}
+
+
+const uint64_t flatBufferSet::INVALID_TAG;
+const uint32_t flatBufferSet::MAX_SCAN_WAYS;
+
+flatBufferSet::flatBufferSet(Wrapper_nvdla* wrap, uint32_t _lat, uint32_t _line_size, uint32_t _assoc) :
+        abstractSet(wrap, _lat, _line_size, _assoc),
+        data((uint64_t)_assoc * _line_size, 0),
+        tags((_assoc + 3) & ~3u, INVALID_TAG),
+        valid_bits((_assoc + 63) / 64, 0),
+        dirty_bits((_assoc + 63) / 64, 0),
+        num_valid(0),
+        lru_prev(_assoc + 1),
+        lru_next(_assoc + 1),
+        index_bits(0) {
+    // same initial order as the lru_order of allBufferSet: way 0 is the least recently used
+    for (uint32_t i = 0; i <= assoc; i++) {
+        lru_next[i] = (i == assoc) ? 0 : i + 1;
+        lru_prev[i] = (i == 0) ? assoc : i - 1;
+    }
+
+    if (assoc > MAX_SCAN_WAYS) {
+        // keep the index at most half full
+        index_bits = 1;
+        while (((uint64_t)1 << index_bits) < 2 * (uint64_t)assoc) index_bits++;
+        index_tag.assign((uint64_t)1 << index_bits, INVALID_TAG);
+        index_way.assign((uint64_t)1 << index_bits, 0);
+    }
+}
+
+
+uint32_t flatBufferSet::find_way(uint64_t tag) {
+    if (assoc > MAX_SCAN_WAYS) {
+        uint64_t index_mask = index_tag.size() - 1;
+        for (uint64_t b = (tag * 0x9E3779B97F4A7C15ULL) >> (64 - index_bits); ; b = (b + 1) & index_mask) {
+            if (index_tag[b] == tag) return index_way[b];
+            if (index_tag[b] == INVALID_TAG) return assoc;
+        }
+    }
+
+    const uint64_t* t = tags.data();
+#if defined(__AVX2__)
+    __m256i key = _mm256_set1_epi64x((long long)tag);
+    for (uint32_t w = 0; w < tags.size(); w += 4) {
+        __m256i eq = _mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i*)(t + w)), key);
+        int hit = _mm256_movemask_pd(_mm256_castsi256_pd(eq));
+        if (hit) return w + __builtin_ctz(hit);
+    }
+#elif defined(__SSE2__)
+    // no 64-bit compare in SSE2: both 32-bit halves have to match
+    __m128i key = _mm_set1_epi64x((long long)tag);
+    for (uint32_t w = 0; w < tags.size(); w += 2) {
+        __m128i eq = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(t + w)), key);
+        eq = _mm_and_si128(eq, _mm_shuffle_epi32(eq, _MM_SHUFFLE(2, 3, 0, 1)));
+        int hit = _mm_movemask_pd(_mm_castsi128_pd(eq));
+        if (hit) return w + __builtin_ctz(hit);
+    }
+#else
+    for (uint32_t w = 0; w < tags.size(); w++) {
+        if (t[w] == tag) return w;
+    }
+#endif
+    return assoc;
+}
+
+
+void flatBufferSet::index_insert(uint64_t tag, uint32_t way) {
+    if (assoc <= MAX_SCAN_WAYS) return;
+    uint64_t index_mask = index_tag.size() - 1;
+    uint64_t b = (tag * 0x9E3779B97F4A7C15ULL) >> (64 - index_bits);
+    while (index_tag[b] != INVALID_TAG)
+        b = (b + 1) & index_mask;
+    index_tag[b] = tag;
+    index_way[b] = way;
+}
+
+
+// linear probing deletion with backward shift, so that no tombstones are needed
+void flatBufferSet::index_erase(uint64_t tag) {
+    if (assoc <= MAX_SCAN_WAYS) return;
+    uint64_t index_mask = index_tag.size() - 1;
+    uint64_t hole = (tag * 0x9E3779B97F4A7C15ULL) >> (64 - index_bits);
+    while (index_tag[hole] != tag)
+        hole = (hole + 1) & index_mask;
+    for (uint64_t b = (hole + 1) & index_mask; index_tag[b] != INVALID_TAG; b = (b + 1) & index_mask) {
+        uint64_t home = (index_tag[b] * 0x9E3779B97F4A7C15ULL) >> (64 - index_bits);
+        // move b into the hole if its home does not lie cyclically in (hole, b]
+        if (((b - home) & index_mask) >= ((b - hole) & index_mask)) {
+            index_tag[hole] = index_tag[b];
+            index_way[hole] = index_way[b];
+            hole = b;
+        }
+    }
+    index_tag[hole] = INVALID_TAG;
+}
+
+
+// move way to the most recently used end
+void flatBufferSet::touch(uint32_t way) {
+    lru_next[lru_prev[way]] = lru_next[way];
+    lru_prev[lru_next[way]] = lru_prev[way];
+    lru_prev[way] = lru_prev[assoc];
+    lru_next[way] = assoc;
+    lru_next[lru_prev[assoc]] = way;
+    lru_prev[assoc] = way;
+}
+
+
+// drop the line in way, leaving its LRU position and dirty bit alone (as allBufferSet does)
+void flatBufferSet::invalidate(uint32_t way) {
+    index_erase(tags[way]);
+    tags[way] = INVALID_TAG;
+    valid_bits[way / 64] &= ~((uint64_t)1 << (way % 64));
+    num_valid--;
+}
+
+
+uint32_t flatBufferSet::erase_victim() {
+    uint32_t way = lru_next[assoc];
+    assert(valid_bits[way / 64] & ((uint64_t)1 << (way % 64)));
+    if (dirty_bits[way / 64] & ((uint64_t)1 << (way % 64))) {
+        wrapper->addDMAWriteReq(tags[way], &data[(uint64_t)way * spm_line_size], spm_line_size);
+        if (wrapper->stats_recorder) wrapper->stats_recorder->spm_write_back();
+    }
+    if (wrapper->stats_recorder) wrapper->stats_recorder->spm_evict();
+    invalidate(way);
+    touch(way);
+    return way;
+}
+
+
+// pick a way for tag (the lowest free one, or the LRU victim if the set is full) and mark it valid
+uint32_t flatBufferSet::alloc_way(uint64_t tag) {
+    uint32_t way = assoc;
+    if (num_valid >= assoc) {
+        way = erase_victim();   // lru maintenance of erasing (moving to lru back) is done inside
+    } else {
+        for (uint32_t i = 0; i < valid_bits.size(); i++) {
+            if (~valid_bits[i]) {
+                way = i * 64 + __builtin_ctzll(~valid_bits[i]);
+                break;
+            }
+        }
+        touch(way);
+    }
+    assert(way < assoc);
+    tags[way] = tag;
+    valid_bits[way / 64] |= (uint64_t)1 << (way % 64);
+    num_valid++;
+    index_insert(tag, way);
+    return way;
+}
+
+
+bool flatBufferSet::read_spm_axi_line(uint64_t axi_addr, uint8_t* data_out) {
+    assert((axi_addr & (uint64_t)(AXI_WIDTH / 8 - 1)) == 0);
+
+    uint64_t addr_base = axi_addr & ~(uint64_t)(spm_line_size - 1);
+    uint64_t offset = axi_addr & (uint64_t)(spm_line_size - 1);
+
+    uint32_t way = find_way(addr_base);
+    if (way == assoc)
+        return false;
+
+#ifndef NO_DATA
+    axi_beat_copy(data_out, &data[(uint64_t)way * spm_line_size + offset]);
+#endif
+    touch(way);
+    return true;
+}
+
+
+bool flatBufferSet::read_spm_line(uint64_t aligned_addr, std::vector<uint8_t>& data_out) {
+    assert((aligned_addr & (uint64_t)(spm_line_size - 1)) == 0);
+
+    uint32_t way = find_way(aligned_addr);
+    if (way == assoc) {
+        return false;
+    }
+    auto line = data.begin() + (uint64_t)way * spm_line_size;
+    data_out.assign(line, line + spm_line_size);
+    // this function is called in a prefetchBuffer. So leave dirty bit untouched since it should always be 0.
+    invalidate(way);
+    return true;
+}
+
+
+void flatBufferSet::write_spm_axi_line_with_mask(uint64_t axi_addr, const uint8_t* data_in, uint64_t mask) {
+    assert((axi_addr & (uint64_t)(AXI_WIDTH / 8 - 1)) == 0);
+
+    uint64_t addr_base = axi_addr & ~(uint64_t)(spm_line_size - 1);
+    uint64_t offset = axi_addr & (uint64_t)(spm_line_size - 1);
+
+    uint32_t way = find_way(addr_base);
+    if (way == assoc)
+        way = alloc_way(addr_base);
+    dirty_bits[way / 64] |= (uint64_t)1 << (way % 64);
+#ifndef NO_DATA
+    axi_beat_merge(&data[(uint64_t)way * spm_line_size + offset], data_in, mask);
+#endif
+}
+
+
+void flatBufferSet::clear_and_write_back_dirty() {
+    for (uint32_t i = 0; i < dirty_bits.size(); i++) {
+        for (uint64_t bits = dirty_bits[i]; bits; bits &= bits - 1) {
+            uint32_t way = i * 64 + __builtin_ctzll(bits);
+            wrapper->addDMAWriteReq(tags[way], &data[(uint64_t)way * spm_line_size], spm_line_size);
+            if (wrapper->stats_recorder) wrapper->stats_recorder->spm_write_back();
+        }
+        dirty_bits[i] = 0;
+        valid_bits[i] = 0;
+    }
+    // don't clear the lru order because it may be used for data coming in afterward
+    std::fill(tags.begin(), tags.end(), INVALID_TAG);
+    std::fill(index_tag.begin(), index_tag.end(), INVALID_TAG);
+    num_valid = 0;
+}
+
+
+void flatBufferSet::fill_spm_line(uint64_t aligned_addr, const uint8_t* data_in) {
+    assert((aligned_addr & (uint64_t)(spm_line_size - 1)) == 0);
+
+    if (find_way(aligned_addr) == assoc) {
+        uint32_t way = alloc_way(aligned_addr);
+        dirty_bits[way / 64] &= ~((uint64_t)1 << (way % 64));
+#ifndef NO_DATA
+        memcpy(&data[(uint64_t)way * spm_line_size], data_in, spm_line_size);
+#endif
+    } else {
+        printf("(%lu) Weird: request the DRAM when it hits the embedded buffer.\n", wrapper->tickcount);
+    }
+}
+
+
+// the index is derived from the tags, so it is rebuilt instead of saved
+void flatBufferSet::save(std::ostream& os) {
+    ckpt_save(os, data);
+    ckpt_save(os, tags);
+    ckpt_save(os, valid_bits);
+    ckpt_save(os, dirty_bits);
+    ckpt_save(os, num_valid);
+    ckpt_save(os, lru_prev);
+    ckpt_save(os, lru_next);
+}
+
+
+void flatBufferSet::restore(std::istream& is) {
+    ckpt_restore(is, data);
+    ckpt_restore(is, tags);
+    ckpt_restore(is, valid_bits);
+    ckpt_restore(is, dirty_bits);
+    ckpt_restore(is, num_valid);
+    ckpt_restore(is, lru_prev);
+    ckpt_restore(is, lru_next);
+    if (data.size() != (uint64_t)assoc * spm_line_size || lru_next.size() != assoc + 1) {
+        is.setstate(std::ios::failbit);
+        return;
+    }
+
+    std::fill(index_tag.begin(), index_tag.end(), INVALID_TAG);
+    for (uint32_t way = 0; way < assoc; way++) {
+        if (valid_bits[way / 64] & ((uint64_t)1 << (way % 64)))
+            index_insert(tags[way], way);
+    }
+}
+
+
 prefetchThrottleSet::prefetchThrottleSet(Wrapper_nvdla* wrap, uint32_t _lat, uint32_t _line_size, uint32_t _assoc):
         abstractSet(wrap, _lat, _line_size, _assoc),
         lines(_assoc, prefetchThrottleLineWithTag(_line_size)) {
@@ -233,6 +546,24 @@ void prefetchThrottleSet::fill_spm_line(uint64_t aligned_addr, const uint8_t* da
 }
 
 
+void prefetchThrottleSet::save(std::ostream& os) {
+    ckpt_save(os, addr_map);
+    for (auto& line: lines) {
+        ckpt_save(os, line.valid);
+        ckpt_save(os, line.spm_line);
+    }
+}
+
+
+void prefetchThrottleSet::restore(std::istream& is) {
+    ckpt_restore(is, addr_map);
+    for (auto& line: lines) {
+        ckpt_restore(is, line.valid);
+        ckpt_restore(is, line.spm_line);
+    }
+}
+
+
 embeddedBuffer::embeddedBuffer(Wrapper_nvdla* wrap, uint32_t _lat, uint32_t _line_size, uint32_t _line_num, uint32_t _assoc) :
         wrapper(wrap), spm_latency(_lat), spm_line_size(_line_size), spm_line_num(_line_num), assoc(_assoc),
         num_sets(_line_num / _assoc) {
@@ -243,7 +574,10 @@ embeddedBuffer::embeddedBuffer(Wrapper_nvdla* wrap, uint32_t _lat, uint32_t _lin
 allBuffer::allBuffer(Wrapper_nvdla* wrap, uint32_t _lat, uint32_t _line_size, uint32_t _line_num, uint32_t _assoc) :
         embeddedBuffer(wrap, _lat, _line_size, _line_num, _assoc) {
     for (uint32_t set_id = 0; set_id < num_sets; set_id++) {
-        sets.emplace_back(new allBufferSet(wrap, _lat, _line_size, _assoc));
+        if (wrap->flat_spm)
+            sets.emplace_back(new flatBufferSet(wrap, _lat, _line_size, _assoc));
+        else
+            sets.emplace_back(new allBufferSet(wrap, _lat, _line_size, _assoc, wrap->spm_rp, set_id));
     }
 }
 
@@ -272,7 +606,10 @@ prefetchBuffer::prefetchBuffer(Wrapper_nvdla* wrap, uint32_t _lat, uint32_t _lin
     switch (wrap->buf_mode) {
         case BUF_MODE_PFT:
             for (uint32_t set_id = 0; set_id < num_sets; set_id++) {
-                sets.emplace_back(new allBufferSet(wrap, _lat, _line_size, _assoc));
+                if (wrap->flat_spm)
+                    sets.emplace_back(new flatBufferSet(wrap, _lat, _line_size, _assoc));
+                else
+                    sets.emplace_back(new allBufferSet(wrap, _lat, _line_size, _assoc, wrap->spm_rp, set_id));
             }
             break;
         case BUF_MODE_PFT_CUTOFF:
@@ -308,8 +645,7 @@ bool prefetchBuffer::read_spm_axi_line(uint64_t axi_addr, uint8_t* data_out, uin
 #ifndef NO_DATA
     uint64_t offset = axi_addr & (uint64_t)(spm_line_size - 1);
     std::vector<uint8_t> &entry_vector = read_buffers[stream_id].second;
-    for (int i = 0; i < AXI_WIDTH / 8; i++)
-        data_out[i] = entry_vector[offset + i];
+    axi_beat_copy(data_out, &entry_vector[offset]);
 #endif
     return true;
 }
@@ -319,3 +655,19 @@ uint32_t prefetchBuffer::num_valid(uint64_t try_addr) {
     uint32_t set_id = (try_addr / spm_line_size) % num_sets;
     return sets[set_id]->size();
 };
+
+
+void prefetchBuffer::save(std::ostream& os) {
+    embeddedBuffer::save(os);
+    for (auto& buffer: read_buffers) {
+        ckpt_save(os, buffer);
+    }
+}
+
+
+void prefetchBuffer::restore(std::istream& is) {
+    embeddedBuffer::restore(is);
+    for (auto& buffer: read_buffers) {
+        ckpt_restore(is, buffer);
+    }
+}
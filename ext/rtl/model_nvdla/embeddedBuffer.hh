@@ -6,6 +6,7 @@
 #include <unordered_map>
 #include <vector>
 
+#include "axiBeat.hh"
 #include "wrapper_nvdla.hh"
 
 
@@ -21,12 +22,27 @@ protected:
 public:
     abstractSet(Wrapper_nvdla* wrap, uint32_t _lat, uint32_t _line_size, uint32_t _assoc);
     virtual ~abstractSet() = 0;
-    inline size_t size() { return addr_map.size(); }
+    inline virtual size_t size() { return addr_map.size(); }
     inline virtual bool read_spm_axi_line(uint64_t axi_addr, uint8_t* data_out) { assert(false); return true; }
     inline virtual bool read_spm_line(uint64_t aligned_addr, std::vector<uint8_t>& data_out) { assert(false); return true; }
     inline virtual void write_spm_axi_line_with_mask(uint64_t axi_addr, const uint8_t* data, uint64_t mask) { assert(false); }
     inline virtual void clear_and_write_back_dirty() { assert(false); }
     virtual void fill_spm_line(uint64_t aligned_addr, const uint8_t* data) = 0;
+    // checkpoint, the geometry is checked by Wrapper_nvdla::restore
+    virtual void save(std::ostream& os) = 0;
+    virtual void restore(std::istream& is) = 0;
+};
+
+
+// Replacement policy hook of allBufferSet, implemented outside of the model (e.g. on top of a gem5
+// replacement policy). Ways are numbered within their set. Without one, allBufferSet keeps using lru_order.
+class spmReplacementPolicy {
+public:
+    virtual ~spmReplacementPolicy() = default;
+    virtual void touch(uint32_t set_id, uint32_t way, uint64_t addr) = 0;       // read hit
+    virtual void reset(uint32_t set_id, uint32_t way, uint64_t addr) = 0;       // line inserted
+    virtual void invalidate(uint32_t set_id, uint32_t way) = 0;                 // line dropped
+    virtual uint32_t get_victim(uint32_t set_id) = 0;                           // only called on full sets
 };
 
 
@@ -45,9 +61,12 @@ protected:
     };
     std::vector<allBufferLineWithTag> lines;
     std::list<uint32_t> lru_order;
+    spmReplacementPolicy* const rp;     // victim selection overriding lru_order if not nullptr
+    const uint32_t set_id;
 
 public:
-    allBufferSet(Wrapper_nvdla* wrap, uint32_t _lat, uint32_t _line_size, uint32_t _assoc);
+    allBufferSet(Wrapper_nvdla* wrap, uint32_t _lat, uint32_t _line_size, uint32_t _assoc,
+                 spmReplacementPolicy* _rp = nullptr, uint32_t _set_id = 0);
     ~allBufferSet() override = default;
     bool read_spm_axi_line(uint64_t axi_addr, uint8_t* data_out) override;
     bool read_spm_line(uint64_t aligned_addr, std::vector<uint8_t>& data_out) override;
@@ -55,6 +74,54 @@ public:
     void clear_and_write_back_dirty() override;
     void fill_spm_line(uint64_t aligned_addr, const uint8_t* data) override;
     uint32_t erase_victim();
+    void save(std::ostream& os) override;
+    void restore(std::istream& is) override;
+};
+
+
+// Same behavior as allBufferSet (LRU, same victims), laid out for large sets:
+// the lines of the set are one contiguous array, tags are a packed array compared with SIMD for small
+// associativity and looked up through an open-addressing index otherwise, free ways are found in a bit
+// vector and the LRU order is an intrusive doubly-linked list over way indices. addr_map is unused.
+class flatBufferSet: virtual public abstractSet {
+protected:
+    static const uint64_t INVALID_TAG = ~(uint64_t)0;   // lines are aligned, so never a real tag
+    static const uint32_t MAX_SCAN_WAYS = 32;           // tag scan up to this associativity, index above
+
+    std::vector<uint8_t> data;          // way w at [w * spm_line_size, (w + 1) * spm_line_size)
+    std::vector<uint64_t> tags;         // padded to a multiple of 4 with INVALID_TAG
+    std::vector<uint64_t> valid_bits;
+    std::vector<uint64_t> dirty_bits;
+    uint32_t num_valid;
+
+    // way assoc is the sentinel: lru_next[assoc] is the least and lru_prev[assoc] the most recently used way
+    std::vector<uint32_t> lru_prev;
+    std::vector<uint32_t> lru_next;
+
+    // tag -> way, only used when assoc > MAX_SCAN_WAYS
+    std::vector<uint64_t> index_tag;
+    std::vector<uint32_t> index_way;
+    uint32_t index_bits;
+
+    uint32_t find_way(uint64_t tag);
+    void index_insert(uint64_t tag, uint32_t way);
+    void index_erase(uint64_t tag);
+    void touch(uint32_t way);
+    void invalidate(uint32_t way);
+    uint32_t alloc_way(uint64_t tag);
+    uint32_t erase_victim();
+
+public:
+    flatBufferSet(Wrapper_nvdla* wrap, uint32_t _lat, uint32_t _line_size, uint32_t _assoc);
+    ~flatBufferSet() override = default;
+    inline size_t size() override { return num_valid; }
+    bool read_spm_axi_line(uint64_t axi_addr, uint8_t* data_out) override;
+    bool read_spm_line(uint64_t aligned_addr, std::vector<uint8_t>& data_out) override;
+    void write_spm_axi_line_with_mask(uint64_t axi_addr, const uint8_t* data, uint64_t mask) override;
+    void clear_and_write_back_dirty() override;
+    void fill_spm_line(uint64_t aligned_addr, const uint8_t* data) override;
+    void save(std::ostream& os) override;
+    void restore(std::istream& is) override;
 };
 
 
@@ -74,6 +141,8 @@ public:
     bool read_spm_line(uint64_t aligned_addr, std::vector<uint8_t>& data_out) override;
     void clear_and_write_back_dirty() override;
     void fill_spm_line(uint64_t aligned_addr, const uint8_t* data) override;
+    void save(std::ostream& os) override;
+    void restore(std::istream& is) override;
 };
 
 
@@ -107,6 +176,18 @@ public:
         uint32_t set_id = (aligned_addr / spm_line_size) % num_sets;
         sets[set_id]->fill_spm_line(aligned_addr, data);
     }
+
+    inline virtual void save(std::ostream& os) {
+        for (auto& set: sets) {
+            set->save(os);
+        }
+    }
+
+    inline virtual void restore(std::istream& is) {
+        for (auto& set: sets) {
+            set->restore(is);
+        }
+    }
 };
 
 
@@ -129,6 +210,8 @@ public:
     ~prefetchBuffer() override;
     bool read_spm_axi_line(uint64_t axi_addr, uint8_t* data_out, uint8_t stream_id) override;
     uint32_t num_valid(uint64_t try_addr);
+    void save(std::ostream& os) override;
+    void restore(std::istream& is) override;
 };
 
 #endif //GEM5_NVDLA_EMBEDDEDBUFFER_HH
@@ -0,0 +1,225 @@
+#ifndef GEM5_NVDLA_INFLIGHTRING_HH
+#define GEM5_NVDLA_INFLIGHTRING_HH
+
+#include <assert.h>
+#include <stdint.h>
+#include <vector>
+
+#include "modelCheckpoint.hh"
+
+// Read transactions of an AXIResponder, kept in issue order.
+// Slots live in a power-of-two ring addressed by a monotonic sequence number (the handle), so
+// issuing, completing and retiring a txn never touches the heap. Txns to the same address are
+// chained in issue order and the chain heads are found through an open-addressing index.
+// Out-of-order retirement (arrived prefetches) leaves a hole that is skipped when the head passes it.
+// The ring grows (by doubling, on the heap) when the span from the oldest live txn to the next
+// handle exceeds its capacity. Holes count in that span, so besides long dump_mem reads of
+// traceLoaderGem5, prefetches retired behind an old outstanding demand read can grow it too.
+// grows() counts how often that happened.
+template <typename T>
+class inflightRing {
+public:
+    static const uint64_t NONE = ~(uint64_t)0;
+
+private:
+    struct slot {
+        T txn;
+        uint64_t addr;
+        uint64_t next_same;     // handle of the next inflight txn to the same addr
+        uint8_t live;
+    };
+    std::vector<slot> slots;
+    uint64_t mask;
+    uint64_t head;              // handle of the oldest live txn (== tail when empty)
+    uint64_t tail;              // handle the next pushed txn gets
+    uint32_t live_count;
+    uint64_t grow_count;
+
+    // addr -> first and last handle of its chain. addr == NONE marks an empty bucket.
+    // AXI addresses are aligned, so NONE never collides with a real one.
+    struct bucket {
+        uint64_t addr;
+        uint64_t first;
+        uint64_t last;
+    };
+    std::vector<bucket> index;
+    uint32_t index_bits;
+
+    inline uint64_t bucket_of(uint64_t addr) const {
+        return (addr * 0x9E3779B97F4A7C15ULL) >> (64 - index_bits);
+    }
+
+    bucket* lookup(uint64_t addr) {
+        uint64_t index_mask = index.size() - 1;
+        for (uint64_t b = bucket_of(addr); ; b = (b + 1) & index_mask) {
+            if (index[b].addr == addr) return &index[b];
+            if (index[b].addr == NONE) return nullptr;
+        }
+    }
+
+    void index_append(uint64_t addr, uint64_t h) {
+        uint64_t index_mask = index.size() - 1;
+        uint64_t b = bucket_of(addr);
+        while (index[b].addr != NONE && index[b].addr != addr)
+            b = (b + 1) & index_mask;
+        if (index[b].addr == NONE) {
+            index[b].addr = addr;
+            index[b].first = h;
+        } else {
+            slots[index[b].last & mask].next_same = h;
+        }
+        index[b].last = h;
+    }
+
+    // linear probing deletion with backward shift, so that no tombstones are needed
+    void index_erase(bucket* bkt) {
+        uint64_t index_mask = index.size() - 1;
+        uint64_t hole = bkt - &index[0];
+        for (uint64_t b = (hole + 1) & index_mask; index[b].addr != NONE; b = (b + 1) & index_mask) {
+            uint64_t home = bucket_of(index[b].addr);
+            // move b into the hole if its home does not lie cyclically in (hole, b]
+            if (((b - home) & index_mask) >= ((b - hole) & index_mask)) {
+                index[hole] = index[b];
+                hole = b;
+            }
+        }
+        index[hole].addr = NONE;
+    }
+
+    // empty ring of size slots (a power of two)
+    void alloc(uint64_t size) {
+        slots.assign(size, slot());
+        mask = size - 1;
+
+        // keep the index at most half full
+        index_bits = 1;
+        while (((uint64_t)1 << index_bits) < 2 * size) index_bits++;
+        index.assign((uint64_t)1 << index_bits, bucket{NONE, NONE, NONE});
+    }
+
+    void grow() {
+        grow_count++;
+        std::vector<slot> old_slots;
+        old_slots.swap(slots);
+        uint64_t old_mask = mask;
+
+        slots.resize(old_slots.size() * 2);
+        mask = slots.size() - 1;
+        for (uint64_t h = head; h != tail; h++)
+            slots[h & mask] = old_slots[h & old_mask];
+
+        // chains are kept in handles, only the index needs a bigger table
+        index_bits++;
+        index.assign(index.size() * 2, bucket{NONE, NONE, NONE});
+        for (uint64_t h = head; h != tail; h++) {
+            slot& s = slots[h & mask];
+            if (!s.live) continue;
+            s.next_same = NONE;
+            index_append(s.addr, h);
+        }
+    }
+
+public:
+    explicit inflightRing(uint32_t capacity) : head(0), tail(0), live_count(0), grow_count(0) {
+        uint64_t size = 1;
+        while (size < capacity) size <<= 1;
+        alloc(size);
+    }
+
+    inline uint32_t size() const { return live_count; }
+    inline bool empty() const { return live_count == 0; }
+    inline uint64_t capacity() const { return slots.size(); }
+    inline const uint64_t& grows() const { return grow_count; }
+
+    // iteration in issue order: for (h = front(); h != end(); h = next(h))
+    inline uint64_t front() const { return head; }
+    inline uint64_t end() const { return tail; }
+    inline uint64_t next(uint64_t h) const {
+        do { h++; } while (h != tail && !slots[h & mask].live);
+        return h;
+    }
+
+    inline T& at(uint64_t h) { return slots[h & mask].txn; }
+    inline uint64_t addr_of(uint64_t h) const { return slots[h & mask].addr; }
+
+    // oldest inflight txn to addr, NONE if there is none
+    inline uint64_t find(uint64_t addr) {
+        bucket* bkt = lookup(addr);
+        return bkt ? bkt->first : NONE;
+    }
+    inline uint64_t next_same(uint64_t h) const { return slots[h & mask].next_same; }
+
+    uint64_t push(uint64_t addr, const T& txn) {
+        if (tail - head == slots.size())
+            grow();
+        uint64_t h = tail++;
+        slot& s = slots[h & mask];
+        s.txn = txn;
+        s.addr = addr;
+        s.next_same = NONE;
+        s.live = 1;
+        live_count++;
+        index_append(addr, h);
+        return h;
+    }
+
+    void retire(uint64_t h) {
+        slot& s = slots[h & mask];
+        assert(s.live);
+
+        bucket* bkt = lookup(s.addr);
+        assert(bkt);
+        if (bkt->first == h) {
+            if (s.next_same == NONE) index_erase(bkt);
+            else bkt->first = s.next_same;
+        } else {
+            // only arrived prefetches retire behind an older txn to the same addr, chains are short
+            uint64_t prev = bkt->first;
+            while (slots[prev & mask].next_same != h) prev = slots[prev & mask].next_same;
+            slots[prev & mask].next_same = s.next_same;
+            if (bkt->last == h) bkt->last = prev;
+        }
+
+        s.live = 0;
+        live_count--;
+        while (head != tail && !slots[head & mask].live) head++;
+    }
+
+    // the live txns with their handles, so that handles kept elsewhere (e.g. DMA deps) stay valid
+    void save(std::ostream& os) const {
+        ckpt_save(os, head);
+        ckpt_save(os, tail);
+        for (uint64_t h = head; h != tail; h++) {
+            const slot& s = slots[h & mask];
+            ckpt_save(os, s.live);
+            if (!s.live) continue;
+            ckpt_save(os, s.addr);
+            ckpt_save(os, s.txn);
+        }
+    }
+
+    void restore(std::istream& is) {
+        uint64_t new_head = 0, new_tail = 0;
+        ckpt_restore(is, new_head);
+        ckpt_restore(is, new_tail);
+        uint64_t size = slots.size();
+        while (size < new_tail - new_head) size <<= 1;
+        alloc(size);
+
+        head = new_head;
+        tail = new_tail;
+        live_count = 0;
+        for (uint64_t h = head; h != tail && is; h++) {
+            slot& s = slots[h & mask];
+            ckpt_restore(is, s.live);
+            s.next_same = NONE;
+            if (!s.live) continue;
+            ckpt_restore(is, s.addr);
+            ckpt_restore(is, s.txn);
+            live_count++;
+            index_append(s.addr, h);
+        }
+    }
+};
+
+#endif //GEM5_NVDLA_INFLIGHTRING_HH
@@ -0,0 +1,205 @@
+#ifndef GEM5_NVDLA_MODELCHECKPOINT_HH
+#define GEM5_NVDLA_MODELCHECKPOINT_HH
+
+#include <stdint.h>
+#include <istream>
+#include <list>
+#include <map>
+#include <ostream>
+#include <queue>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Binary save / restore of the model state for checkpoints, see Wrapper_nvdla::save.
+// Plain structs are written byte by byte in host byte order, containers as their size followed by
+// their elements. Restoring a container replaces its content. Stream errors are left to the caller.
+
+template <typename T> void ckpt_save(std::ostream& os, const T& v);
+template <typename T> void ckpt_restore(std::istream& is, T& v);
+template <typename A, typename B> void ckpt_save(std::ostream& os, const std::pair<A, B>& v);
+template <typename A, typename B> void ckpt_restore(std::istream& is, std::pair<A, B>& v);
+template <typename A, typename B, typename C> void ckpt_save(std::ostream& os, const std::tuple<A, B, C>& v);
+template <typename A, typename B, typename C> void ckpt_restore(std::istream& is, std::tuple<A, B, C>& v);
+template <typename T> void ckpt_save(std::ostream& os, const std::vector<T>& v);
+template <typename T> void ckpt_restore(std::istream& is, std::vector<T>& v);
+template <typename T> void ckpt_save(std::ostream& os, const std::list<T>& v);
+template <typename T> void ckpt_restore(std::istream& is, std::list<T>& v);
+template <typename T> void ckpt_save(std::ostream& os, const std::queue<T>& v);
+template <typename T> void ckpt_restore(std::istream& is, std::queue<T>& v);
+template <typename K, typename V> void ckpt_save(std::ostream& os, const std::map<K, V>& v);
+template <typename K, typename V> void ckpt_restore(std::istream& is, std::map<K, V>& v);
+template <typename K, typename V> void ckpt_save(std::ostream& os, const std::unordered_map<K, V>& v);
+template <typename K, typename V> void ckpt_restore(std::istream& is, std::unordered_map<K, V>& v);
+void ckpt_save(std::ostream& os, const std::string& v);
+void ckpt_restore(std::istream& is, std::string& v);
+
+template <typename T>
+inline void ckpt_save(std::ostream& os, const T& v) {
+    static_assert(std::is_trivially_copyable<T>::value, "only plain data is saved as it is");
+    os.write(reinterpret_cast<const char*>(&v), sizeof(T));
+}
+
+template <typename T>
+inline void ckpt_restore(std::istream& is, T& v) {
+    static_assert(std::is_trivially_copyable<T>::value, "only plain data is restored as it is");
+    is.read(reinterpret_cast<char*>(&v), sizeof(T));
+}
+
+template <typename A, typename B>
+inline void ckpt_save(std::ostream& os, const std::pair<A, B>& v) {
+    ckpt_save(os, v.first);
+    ckpt_save(os, v.second);
+}
+
+template <typename A, typename B>
+inline void ckpt_restore(std::istream& is, std::pair<A, B>& v) {
+    ckpt_restore(is, v.first);
+    ckpt_restore(is, v.second);
+}
+
+template <typename A, typename B, typename C>
+inline void ckpt_save(std::ostream& os, const std::tuple<A, B, C>& v) {
+    ckpt_save(os, std::get<0>(v));
+    ckpt_save(os, std::get<1>(v));
+    ckpt_save(os, std::get<2>(v));
+}
+
+template <typename A, typename B, typename C>
+inline void ckpt_restore(std::istream& is, std::tuple<A, B, C>& v) {
+    ckpt_restore(is, std::get<0>(v));
+    ckpt_restore(is, std::get<1>(v));
+    ckpt_restore(is, std::get<2>(v));
+}
+
+// vectors of plain data (e.g. spm lines) in one go
+template <typename T>
+inline void ckpt_save_elems(std::ostream& os, const std::vector<T>& v, std::true_type) {
+    os.write(reinterpret_cast<const char*>(v.data()), v.size() * sizeof(T));
+}
+
+template <typename T>
+inline void ckpt_save_elems(std::ostream& os, const std::vector<T>& v, std::false_type) {
+    for (const T& e : v) ckpt_save(os, e);
+}
+
+template <typename T>
+inline void ckpt_restore_elems(std::istream& is, std::vector<T>& v, std::true_type) {
+    is.read(reinterpret_cast<char*>(v.data()), v.size() * sizeof(T));
+}
+
+template <typename T>
+inline void ckpt_restore_elems(std::istream& is, std::vector<T>& v, std::false_type) {
+    for (T& e : v) ckpt_restore(is, e);
+}
+
+template <typename T>
+inline void ckpt_save(std::ostream& os, const std::vector<T>& v) {
+    ckpt_save(os, (uint64_t)v.size());
+    ckpt_save_elems(os, v, std::is_trivially_copyable<T>());
+}
+
+template <typename T>
+inline void ckpt_restore(std::istream& is, std::vector<T>& v) {
+    uint64_t n = 0;
+    ckpt_restore(is, n);
+    if (!is) return;
+    v.resize(n);
+    ckpt_restore_elems(is, v, std::is_trivially_copyable<T>());
+}
+
+template <typename T>
+inline void ckpt_save(std::ostream& os, const std::list<T>& v) {
+    ckpt_save(os, (uint64_t)v.size());
+    for (const T& e : v) ckpt_save(os, e);
+}
+
+template <typename T>
+inline void ckpt_restore(std::istream& is, std::list<T>& v) {
+    uint64_t n = 0;
+    ckpt_restore(is, n);
+    v.clear();
+    for (uint64_t i = 0; i < n && is; i++) {
+        v.emplace_back();
+        ckpt_restore(is, v.back());
+    }
+}
+
+template <typename T>
+inline void ckpt_save(std::ostream& os, const std::queue<T>& v) {
+    std::queue<T> q(v);
+    ckpt_save(os, (uint64_t)q.size());
+    for (; !q.empty(); q.pop()) ckpt_save(os, q.front());
+}
+
+template <typename T>
+inline void ckpt_restore(std::istream& is, std::queue<T>& v) {
+    uint64_t n = 0;
+    ckpt_restore(is, n);
+    v = std::queue<T>();
+    for (uint64_t i = 0; i < n && is; i++) {
+        T e;
+        ckpt_restore(is, e);
+        v.push(e);
+    }
+}
+
+template <typename K, typename V>
+inline void ckpt_save(std::ostream& os, const std::map<K, V>& v) {
+    ckpt_save(os, (uint64_t)v.size());
+    for (const auto& e : v) {
+        ckpt_save(os, e.first);
+        ckpt_save(os, e.second);
+    }
+}
+
+template <typename K, typename V>
+inline void ckpt_restore(std::istream& is, std::map<K, V>& v) {
+    uint64_t n = 0;
+    ckpt_restore(is, n);
+    v.clear();
+    for (uint64_t i = 0; i < n && is; i++) {
+        K key;
+        ckpt_restore(is, key);
+        ckpt_restore(is, v[key]);
+    }
+}
+
+template <typename K, typename V>
+inline void ckpt_save(std::ostream& os, const std::unordered_map<K, V>& v) {
+    ckpt_save(os, (uint64_t)v.size());
+    for (const auto& e : v) {
+        ckpt_save(os, e.first);
+        ckpt_save(os, e.second);
+    }
+}
+
+template <typename K, typename V>
+inline void ckpt_restore(std::istream& is, std::unordered_map<K, V>& v) {
+    uint64_t n = 0;
+    ckpt_restore(is, n);
+    v.clear();
+    for (uint64_t i = 0; i < n && is; i++) {
+        K key;
+        ckpt_restore(is, key);
+        ckpt_restore(is, v[key]);
+    }
+}
+
+inline void ckpt_save(std::ostream& os, const std::string& v) {
+    ckpt_save(os, (uint64_t)v.size());
+    os.write(v.data(), v.size());
+}
+
+inline void ckpt_restore(std::istream& is, std::string& v) {
+    uint64_t n = 0;
+    ckpt_restore(is, n);
+    if (!is) return;
+    v.resize(n);
+    is.read(&v[0], n);
+}
+
+#endif //GEM5_NVDLA_MODELCHECKPOINT_HH
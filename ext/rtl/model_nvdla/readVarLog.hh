@@ -0,0 +1,166 @@
+#ifndef GEM5_NVDLA_READVARLOG_HH
+#define GEM5_NVDLA_READVARLOG_HH
+
+#include <assert.h>
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+
+#include "modelCheckpoint.hh"
+
+// a read-only variable of the trace, the RTL reads them in log order
+struct read_var {
+    uint64_t addr;
+    uint32_t length;
+    uint32_t issued_len;    // prefix requested from memory so far, by prefetches or by the RTL
+    uint32_t used_len;      // prefix the RTL has read so far
+};
+
+// The read-only variables of an AXIResponder, in log order, with an address index.
+// Entries are addressed by their position in the log (the handle). Retired entries (fully issued) are
+// skipped through path-compressed links to the next live one, so walking the live entries in log order
+// does not revisit them. The address index is a flat vector of the entries sorted by start address plus
+// a prefix maximum of their end addresses, which bounds the backward scan when variables overlap.
+// Lookups first try the entry of the previous hit and the one after it (the RTL streams through a
+// variable and then into the next one), and fall back to a binary search.
+// The index is rebuilt, dropping the retired entries, on the first lookup after entries are appended,
+// i.e., once per loaded trace.
+class readVarLog {
+public:
+    static const uint32_t NONE = ~(uint32_t)0;
+
+private:
+    std::vector<read_var> vars;
+    std::vector<uint32_t> next_live;    // next_live[h] == h iff h is live, next_live[vars.size()] is the end
+    uint32_t head;                      // handle of the first live entry (== end() when empty)
+    uint32_t live_count;
+
+    std::vector<uint32_t> by_addr;      // handles of the live entries when indexed, sorted by (addr, handle)
+    std::vector<uint64_t> max_end;      // max_end[i] = max end address of by_addr[0..i]
+    uint32_t cursor;                    // position in by_addr of the last hit
+    bool dirty;                         // entries were appended since the index was built
+
+    uint32_t live_from(uint32_t h) {
+        uint32_t r = h;
+        while (next_live[r] != r) r = next_live[r];
+        while (next_live[h] != r) {
+            uint32_t n = next_live[h];
+            next_live[h] = r;
+            h = n;
+        }
+        return r;
+    }
+
+    inline uint64_t start_at(uint32_t pos) const { return vars[by_addr[pos]].addr; }
+
+    // whether pos is the last position of by_addr whose variable starts at or below addr
+    inline bool is_floor(uint32_t pos, uint64_t addr) const {
+        return pos < by_addr.size() && start_at(pos) <= addr && (pos + 1 == by_addr.size() || start_at(pos + 1) > addr);
+    }
+
+    void rebuild() {
+        // drop the retired entries, handles are not kept across cycles
+        uint32_t n = 0;
+        for (uint32_t h = head; h != end(); h = next(h))
+            vars[n++] = vars[h];
+        vars.resize(n);
+        next_live.resize(n + 1);
+        for (uint32_t h = 0; h <= n; h++) next_live[h] = h;
+        head = 0;
+
+        by_addr.resize(n);
+        for (uint32_t h = 0; h < n; h++) by_addr[h] = h;
+        std::sort(by_addr.begin(), by_addr.end(), [this](uint32_t a, uint32_t b) {
+            return vars[a].addr < vars[b].addr || (vars[a].addr == vars[b].addr && a < b);
+        });
+        max_end.resize(n);
+        for (uint32_t i = 0; i < n; i++) {
+            uint64_t e = vars[by_addr[i]].addr + vars[by_addr[i]].length;
+            max_end[i] = (i && max_end[i - 1] > e) ? max_end[i - 1] : e;
+        }
+        cursor = 0;
+        dirty = false;
+    }
+
+public:
+    readVarLog() : next_live(1, 0), head(0), live_count(0), cursor(0), dirty(false) {}
+
+    inline uint32_t size() const { return live_count; }
+    inline bool empty() const { return live_count == 0; }
+
+    // iteration over the live entries in log order: for (h = front(); h != end(); h = next(h))
+    inline uint32_t front() const { return head; }
+    inline uint32_t end() const { return vars.size(); }
+    inline uint32_t next(uint32_t h) { return live_from(h + 1); }
+
+    inline read_var& at(uint32_t h) { return vars[h]; }
+
+    void push_back(uint64_t addr, uint32_t length) {
+        // the old end becomes the new entry, so links that reached the end now reach it
+        vars.push_back({addr, length, 0, 0});
+        next_live.push_back(vars.size());
+        live_count++;
+        dirty = true;
+    }
+
+    // first live entry in log order that covers addr, NONE if there is none
+    uint32_t find(uint64_t addr) {
+        if (dirty) rebuild();
+        if (by_addr.empty()) return NONE;
+
+        uint32_t pos;
+        if (is_floor(cursor, addr)) {
+            pos = cursor;
+        } else if (is_floor(cursor + 1, addr)) {
+            pos = cursor + 1;
+        } else {
+            uint32_t ub = std::upper_bound(by_addr.begin(), by_addr.end(), addr, [this](uint64_t a, uint32_t h) {
+                return a < vars[h].addr;
+            }) - by_addr.begin();
+            if (ub == 0) return NONE;
+            pos = ub - 1;
+        }
+        cursor = pos;
+
+        // variables starting further below can only cover addr while the prefix maximum of the ends is above it,
+        // without overlaps this checks pos alone
+        uint32_t found = NONE;
+        for (uint32_t i = pos + 1; i-- > 0 && max_end[i] > addr; ) {
+            uint32_t h = by_addr[i];
+            if (next_live[h] == h && addr < vars[h].addr + vars[h].length && h < found)
+                found = h;
+        }
+        return found;
+    }
+
+    void retire(uint32_t h) {
+        assert(next_live[h] == h);
+        next_live[h] = h + 1;
+        live_count--;
+        if (h == head) head = live_from(h);
+    }
+
+    // the live entries in log order, in the same layout as the std::list it replaced
+    void save(std::ostream& os) const {
+        ckpt_save(os, (uint64_t)live_count);
+        for (uint32_t h = head; h < vars.size(); h++)
+            if (next_live[h] == h) ckpt_save(os, vars[h]);
+    }
+
+    void restore(std::istream& is) {
+        uint64_t n = 0;
+        ckpt_restore(is, n);
+        vars.clear();
+        next_live.assign(1, 0);
+        head = 0;
+        live_count = 0;
+        for (uint64_t i = 0; i < n && is; i++) {
+            read_var var;
+            ckpt_restore(is, var);
+            push_back(var.addr, var.length);
+            vars.back() = var;
+        }
+    }
+};
+
+#endif //GEM5_NVDLA_READVARLOG_HH
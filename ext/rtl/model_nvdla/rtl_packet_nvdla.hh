@@ -40,9 +40,63 @@
 #ifndef __RTL_PACKET_NVDLA_HH__
 #define __RTL_PACKET_NVDLA_HH__
 
+#include <assert.h>
 #include <cstdlib>
 #include <iostream>
 #include <queue>
+#include <utility>
+#include <vector>
+
+// the longest write a long_write_req_entry_t carries (one AXI beat)
+#define LONG_WRITE_MAX_BYTES 64
+
+// FIFO of requests from Wrapper_nvdla (single producer) to rtlNVDLA::processOutput (single consumer).
+// Both sides run on the thread that ticks the RTL, so no synchronization is needed.
+// Slots are reused in place: push() hands back the stale slot for the producer to overwrite,
+// so entries holding a std::vector keep their storage from one cycle to the next.
+// The ring only grows (by doubling) when a burst exceeds its capacity, e.g. when the whole spm is flushed.
+template <typename T>
+class spscRing {
+private:
+    std::vector<T> slots;
+    uint32_t mask;
+    uint32_t head;
+    uint32_t tail;
+
+    void grow() {
+        std::vector<T> bigger(slots.size() * 2);
+        uint32_t n = size();
+        for (uint32_t i = 0; i < n; i++)
+            std::swap(bigger[i], slots[(head + i) & mask]);
+        slots.swap(bigger);
+        mask = slots.size() - 1;
+        head = 0;
+        tail = n;
+    }
+
+public:
+    explicit spscRing(uint32_t capacity) : head(0), tail(0) {
+        uint32_t size = 1;
+        while (size < capacity) size <<= 1;
+        slots.resize(size);
+        mask = size - 1;
+    }
+
+    inline bool empty() const { return head == tail; }
+    inline uint32_t size() const { return tail - head; }
+    inline T& front() { assert(!empty()); return slots[head & mask]; }
+    inline T& back() { assert(!empty()); return slots[(tail - 1) & mask]; }
+    inline T& operator[](uint32_t i) { assert(i < size()); return slots[(head + i) & mask]; }
+
+    inline T& push() {
+        if (size() == slots.size())
+            grow();
+        return slots[(tail++) & mask];
+    }
+    inline void push(const T& entry) { push() = entry; }
+    inline void pop() { assert(!empty()); head++; }
+    inline void clear() { head = tail; }
+};
 
 struct read_resp_entry_t {
     bool        read_valid;
@@ -62,10 +116,9 @@ struct write_req_entry_t {
 };
 
 struct long_write_req_entry_t {
-    uint8_t*    write_data;
-    // we will malloc space to it when used,
-    // and will pass it directly to gem5 pkt
-    // to avoid extra data movement overhead
+    uint8_t     write_data[LONG_WRITE_MAX_BYTES];
+    // kept in the ring slot and copied once into a pooled gem5 pkt,
+    // so that no buffer is allocated per write
 
     uint32_t    write_addr;
     uint32_t    length;
@@ -85,12 +138,16 @@ struct read_req_entry_t {
 
 struct outputNVDLA {
     bool                             read_valid;
-    std::queue<read_req_entry_t>     read_buffer;
+    spscRing<read_req_entry_t>       read_buffer;
     bool                             write_valid;
-    std::queue<write_req_entry_t>    write_buffer;
-    std::queue<long_write_req_entry_t>    long_write_buffer;
-    std::queue<std::pair<uint64_t, uint32_t>> dma_read_buffer;
-    std::deque<std::pair<uint64_t, std::vector<uint8_t>>> dma_write_buffer;
+    spscRing<write_req_entry_t>      write_buffer;
+    spscRing<long_write_req_entry_t> long_write_buffer;
+    spscRing<std::pair<uint64_t, uint32_t>> dma_read_buffer;
+    spscRing<std::pair<uint64_t, std::vector<uint8_t>>> dma_write_buffer;
+
+    // sized for a cycle with a full 256-beat read burst plus prefetches
+    outputNVDLA() : read_valid(false), read_buffer(512), write_valid(false), write_buffer(64),
+                    long_write_buffer(64), dma_read_buffer(64), dma_write_buffer(64) {}
 };
 
 
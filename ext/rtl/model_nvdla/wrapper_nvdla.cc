@@ -47,24 +47,62 @@
 
 #include "wrapper_nvdla.hh"
 #include <iostream>
+#include <mutex>
+#include <unistd.h>
+#if NVDLA_VL_THREADS > 0
+#include <pthread.h>
+#include <sched.h>
+#endif
 
 double sc_time_stamp() {
   return double_t(0);
 }
 
 embeddedBuffer* Wrapper_nvdla::shared_spm = nullptr;
-uint64_t* Wrapper_nvdla::print_buffer = nullptr;
-uint32_t Wrapper_nvdla::buf_ptr = 0;
+
+// RTL state after the first full reset of the process, see ResetMode. It is a Verilator save in a temporary file,
+// removed when the process exits.
+static struct ResetSnapshot {
+    std::mutex mutex;
+    std::string path;       // empty until taken
+    bool failed = false;    // could not be taken, resets stay full
+    ~ResetSnapshot() { if (!path.empty()) unlink(path.c_str()); }
+} reset_snapshot;
+
+static std::string temp_file(const char* prefix) {
+    const char* dir = getenv("TMPDIR");
+    std::string path = std::string(dir ? dir : "/tmp") + "/" + prefix + "XXXXXX";
+    int fd = mkstemp(&path[0]);
+    if (fd < 0) return std::string();
+    close(fd);
+    return path;
+}
+
+static std::vector<char> read_file(const std::string& path) {
+    std::ifstream f(path, std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+}
 
 Wrapper_nvdla::Wrapper_nvdla(int id_nvdla, const unsigned int maxReq,
                              bool _dma_enable, int _spm_latency, int _spm_line_size, int _spm_line_num,
-                             bool pft_enable, bool use_shared_spm, BufferMode mode, uint32_t _assoc) :
+                             bool pft_enable, bool use_shared_spm, BufferMode mode, uint32_t _assoc, bool _flat_spm,
+                             spmReplacementPolicy* _spm_rp, int vl_first_cpu) :
+        vl_pinned(false),
         id_nvdla(id_nvdla),
         tickcount(0),
         prefetch_enable(pft_enable),
+        pft_threshold(16),
+        dma_pft_threshold(8),
+        pft_lookahead(1),
+        pft_depth(0),
+        pft_max_bw(0),
         use_shared_spm(use_shared_spm),
         buf_mode(mode),
-        assoc(_assoc) {
+        assoc(_assoc),
+        flat_spm(_flat_spm),
+        spm_rp(_spm_rp),
+        stats_recorder(nullptr) {
+    reset_mode = RESET_FULL;
     if (use_shared_spm && shared_spm) {
         spm = shared_spm;
     } else {
@@ -83,16 +121,32 @@ Wrapper_nvdla::Wrapper_nvdla(int id_nvdla, const unsigned int maxReq,
         if (use_shared_spm) shared_spm = spm;
     }
 
-    if (!print_buffer) {
-        print_buffer = new uint64_t[PB_SIZE * 2];
-    }
+#ifdef AXI_RESP_FAST_IO
+    print_buffer = new uint64_t[PB_SIZE * 2];
+    buf_ptr = 0;
+#endif
 
 
     int argcc = 1;
     char* buf[] = {(char*)"aaa",(char*)"bbb"};
     Verilated::commandArgs(argcc, buf);
 
+#if NVDLA_VL_THREADS > 0
+    // the threaded model spawns its worker pool in the constructor and new threads inherit the affinity of
+    // their creator, so the pool is pinned by constructing it from this thread restricted to the cpus
+    cpu_set_t own_cpus;
+    bool pin = vl_first_cpu >= 0 && pthread_getaffinity_np(pthread_self(), sizeof(own_cpus), &own_cpus) == 0;
+    if (pin) {
+        cpu_set_t vl_cpus;
+        CPU_ZERO(&vl_cpus);
+        for (int i = 0; i < vl_threads; i++) CPU_SET(vl_first_cpu + i, &vl_cpus);
+        vl_pinned = pthread_setaffinity_np(pthread_self(), sizeof(vl_cpus), &vl_cpus) == 0;
+    }
     dla = new VNV_nvdla();
+    if (pin) pthread_setaffinity_np(pthread_self(), sizeof(own_cpus), &own_cpus);
+#else
+    dla = new VNV_nvdla();
+#endif
 
     // we always enable the trace
     // but we will use it depending on traceOn
@@ -173,7 +227,7 @@ Wrapper_nvdla::Wrapper_nvdla(int id_nvdla, const unsigned int maxReq,
 Wrapper_nvdla::~Wrapper_nvdla() {
     delete dla;
 #ifdef AXI_RESP_FAST_IO
-    delete print_buffer;
+    delete[] print_buffer;
 #endif
     if (use_shared_spm) {
         if (shared_spm) {
@@ -198,6 +252,73 @@ void Wrapper_nvdla::reset() {
 }
 
 void Wrapper_nvdla::init() {
+    if (reset_mode != RESET_FULL && vl_savable && snapshotReset()) return;
+    fullReset();
+}
+
+bool Wrapper_nvdla::snapshotReset() {
+    std::string snapshot;
+    {
+        std::lock_guard<std::mutex> lock(reset_snapshot.mutex);
+        if (reset_snapshot.failed) return false;
+        if (reset_snapshot.path.empty()) {
+            // the first reset of the process is a full one, the others restore its result
+            fullReset();
+            std::string path = temp_file("nvdla_reset_");
+            if (!path.empty() && saveRTL(path.c_str())) {
+                reset_snapshot.path = path;
+            } else {
+                printf("nvdla#%d could not save the reset snapshot, resets stay full\n", id_nvdla);
+                if (!path.empty()) unlink(path.c_str());
+                reset_snapshot.failed = true;
+            }
+            return true;
+        }
+        snapshot = reset_snapshot.path;
+    }
+
+    if (reset_mode != RESET_SNAPSHOT_CHECK) {
+        printf("reset from snapshot...\n");
+        return restoreRTL(snapshot.c_str());
+    }
+
+    // save the state of a full reset and of the restored snapshot, both have to be the same
+    std::string full_path = temp_file("nvdla_reset_full_");
+    std::string restored_path = temp_file("nvdla_reset_restored_");
+    if (full_path.empty() || restored_path.empty()) {
+        if (!full_path.empty()) unlink(full_path.c_str());
+        if (!restored_path.empty()) unlink(restored_path.c_str());
+        return false;
+    }
+    fullReset();
+    saveRTL(full_path.c_str());
+    restoreRTL(snapshot.c_str());
+    saveRTL(restored_path.c_str());
+
+    std::vector<char> full = read_file(full_path);
+    std::vector<char> restored = read_file(restored_path);
+    size_t common = std::min(full.size(), restored.size());
+    size_t diff = std::max(full.size(), restored.size()) - common;     // a longer save differs in its tail
+    size_t first = diff ? common : 0;
+    for (size_t i = common; i-- > 0;) {
+        if (full[i] != restored[i]) {
+            first = i;
+            diff++;
+        }
+    }
+    if (diff) {
+        printf("(%lu) nvdla#%d reset snapshot does not match a full reset: %lu of %lu bytes differ from byte %lu on, "
+               "keeping the full reset\n", tickcount, id_nvdla, diff, full.size(), first);
+        restoreRTL(full_path.c_str());
+    } else {
+        printf("(%lu) nvdla#%d reset snapshot matches a full reset\n", tickcount, id_nvdla);
+    }
+    unlink(full_path.c_str());
+    unlink(restored_path.c_str());
+    return true;
+}
+
+void Wrapper_nvdla::fullReset() {
     dla->global_clk_ovr_on = 0;
     dla->tmc2slcg_disable_clock_gating = 0;
     dla->test_mode = 0;
@@ -255,58 +376,58 @@ void Wrapper_nvdla::addReadReq(bool read_sram, bool read_timing, bool cacheable,
                 uint64_t read_addr, uint32_t read_bytes) {
 
     output.read_valid = true;
-    read_req_entry_t rd;
+    read_req_entry_t& rd = output.read_buffer.push();
     rd.read_sram      = read_sram;
     rd.read_timing    = read_timing;
     rd.cacheable      = cacheable;
     rd.read_addr      = read_addr;
     rd.read_bytes     = read_bytes;
-    output.read_buffer.push(rd);
 }
 
 void Wrapper_nvdla::addWriteReq(bool write_sram, bool write_timing,
                  uint64_t write_addr, uint8_t write_data) {
     output.write_valid = true;
-    write_req_entry_t wr;
+    write_req_entry_t& wr = output.write_buffer.push();
     wr.write_sram   = write_sram;
     wr.write_timing = write_timing;
     wr.write_data   = write_data;
     wr.write_addr   = write_addr;
-    output.write_buffer.push(wr);
 }
 
 void Wrapper_nvdla::addLongWriteReq(bool write_sram, bool write_timing, bool cacheable,
                 uint64_t write_addr, uint32_t length, const uint8_t* const write_data, uint64_t mask) {
+    assert(length <= LONG_WRITE_MAX_BYTES);
     output.write_valid = true;
-    long_write_req_entry_t wr;
+    long_write_req_entry_t& wr = output.long_write_buffer.push();
     wr.write_sram = write_sram;
     wr.write_timing = write_timing;
     wr.cacheable = cacheable;
     wr.write_addr = write_addr;
     wr.length = length;
     wr.write_mask = mask;
-    wr.write_data = new uint8_t[length];
 #ifndef NO_DATA
-    for (int i = 0; i < length; i++) {
-        wr.write_data[i] = write_data[i];
-    }
+    memcpy(wr.write_data, write_data, length);
 #endif
-    output.long_write_buffer.push(std::move(wr));
 }
 
 void Wrapper_nvdla::clearOutput() {
     output.read_valid  = false;
     output.write_valid = false;
-    while (!output.read_buffer.empty()) {
-        output.read_buffer.pop();
-    }
-    while (!output.write_buffer.empty()) {
-        output.write_buffer.pop();
-    }
+    output.read_buffer.clear();
+    output.write_buffer.clear();
     // dma rd and wr buffer should be kept because
     // dma_engine cannot be issued with multiple tasks at once
 }
 
+bool Wrapper_nvdla::stalledOnMemory(int csb_noop) {
+    if (!output.read_buffer.empty() || !output.write_buffer.empty() || !output.long_write_buffer.empty() ||
+        !output.dma_read_buffer.empty() || !output.dma_write_buffer.empty())
+        return false;
+    if (!csb->idle(csb_noop) || !axi_dbb->is_quiet() || !axi_cvsram->is_quiet())
+        return false;
+    return axi_dbb->waits_for_memory() || axi_cvsram->waits_for_memory();
+}
+
 outputNVDLA& Wrapper_nvdla::tick() {
     dla->dla_core_clk = 1;
     dla->dla_csb_clk = 1;
@@ -322,7 +443,15 @@ outputNVDLA& Wrapper_nvdla::tick() {
 }
 
 void Wrapper_nvdla::addDMAWriteReq(uint64_t addr, const std::vector<uint8_t>& write_data) {
-    output.dma_write_buffer.emplace_back(addr, write_data);
+    auto& entry = output.dma_write_buffer.push();
+    entry.first = addr;
+    entry.second.assign(write_data.begin(), write_data.end());
+}
+
+void Wrapper_nvdla::addDMAWriteReq(uint64_t addr, const uint8_t* write_data, uint32_t len) {
+    auto& entry = output.dma_write_buffer.push();
+    entry.first = addr;
+    entry.second.assign(write_data, write_data + len);
 }
 
 void Wrapper_nvdla::tryMergeDMAWriteReq(uint64_t addr, uint8_t* write_data, uint32_t len) {
@@ -333,9 +462,114 @@ void Wrapper_nvdla::tryMergeDMAWriteReq(uint64_t addr, uint8_t* write_data, uint
             return;
         }
     }
-    output.dma_write_buffer.emplace_back(addr, std::move(std::vector<uint8_t>(write_data, write_data + len)));
+    // the slot keeps the storage of the line it carried last time
+    auto& entry = output.dma_write_buffer.push();
+    entry.first = addr;
+    entry.second.assign(write_data, write_data + len);
 }
 
 void Wrapper_nvdla::addDMAReadReq(uint64_t read_addr, uint32_t read_bytes) {
-    output.dma_read_buffer.emplace(read_addr, read_bytes);
+    output.dma_read_buffer.push(std::make_pair(read_addr, read_bytes));
+}
+
+// rings are saved front to back
+template <typename T>
+static void save_ring(std::ostream& os, spscRing<T>& ring) {
+    ckpt_save(os, ring.size());
+    for (uint32_t i = 0; i < ring.size(); i++)
+        ckpt_save(os, ring[i]);
+}
+
+template <typename T>
+static void restore_ring(std::istream& is, spscRing<T>& ring) {
+    uint32_t n = 0;
+    ckpt_restore(is, n);
+    ring.clear();
+    for (uint32_t i = 0; i < n && is; i++)
+        ckpt_restore(is, ring.push());
+}
+
+static const uint64_t CKPT_MAGIC = 0x4e56444c41434b32ULL;   // "NVDLACK2"
+
+bool Wrapper_nvdla::save(std::ostream& os) {
+    ckpt_save(os, CKPT_MAGIC);
+    ckpt_save(os, (uint32_t)buf_mode);
+    ckpt_save(os, flat_spm);
+    ckpt_save(os, spm->spm_line_size);
+    ckpt_save(os, spm->assoc);
+    ckpt_save(os, spm->num_sets);
+
+    ckpt_save(os, tickcount);
+    csb->save(os);
+    axi_dbb->save(os);
+    axi_cvsram->save(os);
+    // a shared spm is saved by every NVDLA, they all restore the same content
+    spm->save(os);
+
+    ckpt_save(os, output.read_valid);
+    ckpt_save(os, output.write_valid);
+    save_ring(os, output.read_buffer);
+    save_ring(os, output.write_buffer);
+    save_ring(os, output.long_write_buffer);
+    save_ring(os, output.dma_read_buffer);
+    save_ring(os, output.dma_write_buffer);
+    return !os.fail();
+}
+
+bool Wrapper_nvdla::restore(std::istream& is) {
+    uint64_t magic = 0;
+    uint32_t mode = 0, line_size = 0, ways = 0, sets = 0;
+    bool flat = false;
+    ckpt_restore(is, magic);
+    ckpt_restore(is, mode);
+    ckpt_restore(is, flat);
+    ckpt_restore(is, line_size);
+    ckpt_restore(is, ways);
+    ckpt_restore(is, sets);
+    if (!is || magic != CKPT_MAGIC || mode != (uint32_t)buf_mode || flat != flat_spm ||
+        line_size != spm->spm_line_size || ways != spm->assoc || sets != spm->num_sets) {
+        printf("(%lu) checkpoint of nvdla %d does not match the model configuration\n", tickcount, id_nvdla);
+        return false;
+    }
+
+    ckpt_restore(is, tickcount);
+    csb->restore(is);
+    axi_dbb->restore(is);
+    axi_cvsram->restore(is);
+    spm->restore(is);
+
+    ckpt_restore(is, output.read_valid);
+    ckpt_restore(is, output.write_valid);
+    restore_ring(is, output.read_buffer);
+    restore_ring(is, output.write_buffer);
+    restore_ring(is, output.long_write_buffer);
+    restore_ring(is, output.dma_read_buffer);
+    restore_ring(is, output.dma_write_buffer);
+    return !is.fail();
+}
+
+bool Wrapper_nvdla::saveRTL(const char* filename) {
+#if NVDLA_VL_SAVABLE
+    VerilatedSave os;
+    os.open(filename);
+    if (!os.isOpen()) return false;
+    os << *dla;
+    os.close();
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool Wrapper_nvdla::restoreRTL(const char* filename) {
+#if NVDLA_VL_SAVABLE
+    VerilatedRestore is;
+    is.open(filename);
+    if (!is.isOpen()) return false;
+    is >> *dla;
+    is.close();
+    return true;
+#else
+    return false;
+#endif
 }
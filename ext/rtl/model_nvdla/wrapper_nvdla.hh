@@ -84,10 +84,23 @@
 
 // #define NO_DATA
 
+// number of verilator worker threads the model was verilated with (--threads),
+// 0 for the single-threaded flavor. Set by the library_vcd_mt build.
+#ifndef NVDLA_VL_THREADS
+#define NVDLA_VL_THREADS 0
+#endif
+
+// whether the model was verilated with --savable, so that the RTL state can go into checkpoints.
+// Set by the model Makefile (VL_SAVABLE=1).
+#ifndef NVDLA_VL_SAVABLE
+#define NVDLA_VL_SAVABLE 0
+#endif
+
 
 #include <assert.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <fcntl.h>
 #include <iostream>
 #include <iterator>
@@ -103,6 +116,10 @@
 #include "VNV_nvdla.h"
 #include "verilated.h"
 #include "verilated_vcd_c.h"
+#if NVDLA_VL_SAVABLE
+#include "verilated_save.h"
+#endif
+#include "modelCheckpoint.hh"
 #include "csbMaster.hh"
 #include "axiResponder.hh"
 #include "embeddedBuffer.hh"
@@ -113,6 +130,19 @@ class CSBMaster;
 class AXIResponder;
 class Wrapper_nvdla;
 class embeddedBuffer;
+class spmReplacementPolicy;
+
+// Statistics hook of the model, implemented outside of it (e.g. with gem5 stats). Latencies are in NVDLA cycles.
+class nvdlaStatsRecorder {
+public:
+    virtual ~nvdlaStatsRecorder() = default;
+    virtual void spm_read(bool hit) = 0;                                        // demand beat looked up in the SPM
+    virtual void spm_evict() = 0;                                               // valid line replaced
+    virtual void spm_write_back() = 0;                                          // dirty line written back by DMA
+    virtual void dma_read_done(bool prefetch, uint64_t cycles) = 0;             // line fill, issue to return
+    virtual void axi_read_done(bool sram, uint8_t arid, uint64_t cycles) = 0;   // ar to the last beat handed over
+    virtual void axi_write_done(bool sram, uint8_t awid, uint64_t cycles) = 0;  // aw to the last beat written
+};
 
 enum BufferMode {
     BUF_MODE_ALL = 0,
@@ -120,15 +150,30 @@ enum BufferMode {
     BUF_MODE_PFT_CUTOFF = 2,
 };
 
+// How Wrapper_nvdla::init() resets the RTL. The snapshot modes save the RTL state after the first full reset of
+// the process and restore it on every later reset of any NVDLA instead of clocking the reset sequence again.
+// They need vl_savable, init() falls back to RESET_FULL otherwise.
+enum ResetMode {
+    RESET_FULL = 0,
+    RESET_SNAPSHOT = 1,
+    RESET_SNAPSHOT_CHECK = 2,   // also run the full reset and check that the snapshot matches it bit for bit
+};
+
 
 class Wrapper_nvdla {
 private:
     static embeddedBuffer* shared_spm;
 
+    // the reset sequence of the RTL, clocked
+    void fullReset();
+    // reset by restoring the reset snapshot of the process (taking it on the first call), false if it cannot be taken
+    bool snapshotReset();
+
 public:
     Wrapper_nvdla(int id_nvdla, const unsigned int maxReq,
                   bool _dma_enable, int _spm_latency, int _spm_line_size, int _spm_line_num, bool pft_enable,
-                  bool use_shared_spm, BufferMode mode, uint32_t _assoc);
+                  bool use_shared_spm, BufferMode mode, uint32_t _assoc, bool _flat_spm = false,
+                  spmReplacementPolicy* _spm_rp = nullptr, int vl_first_cpu = -1);
     ~Wrapper_nvdla();
 
     outputNVDLA& tick();
@@ -143,10 +188,26 @@ public:
         uint64_t write_addr, uint32_t length, const uint8_t* const write_data, uint64_t mask);
     void addDMAReadReq(uint64_t read_addr, uint32_t read_bytes);
     void addDMAWriteReq(uint64_t addr, const std::vector<uint8_t>& write_data);
+    void addDMAWriteReq(uint64_t addr, const uint8_t* write_data, uint32_t len);
     void tryMergeDMAWriteReq(uint64_t addr, uint8_t* write_data, uint32_t len);
     void clearOutput();
 
+    // the RTL is only waiting for memory: nothing to do on CSB / AXI and no output to hand over to gem5
+    bool stalledOnMemory(int csb_noop);
+
+    // checkpoint of everything around the RTL: CSB ops, AXI FIFOs and inflight txns, embedded buffer and
+    // pending DMA requests. restore returns false if the checkpoint is from a model with another geometry.
+    bool save(std::ostream& os);
+    bool restore(std::istream& is);
+    // the RTL itself, only if vl_savable. Otherwise both return false.
+    bool saveRTL(const char* filename);
+    bool restoreRTL(const char* filename);
+
     VNV_nvdla* dla;
+    ResetMode reset_mode;
+    static constexpr int vl_threads = NVDLA_VL_THREADS;
+    static constexpr bool vl_savable = NVDLA_VL_SAVABLE;
+    bool vl_pinned;     // the worker threads of dla run on host cpus [vl_first_cpu, vl_first_cpu + vl_threads)
     uint64_t tickcount;
     int id_nvdla;
 
@@ -159,8 +220,9 @@ public:
     outputNVDLA output;
 
 #ifdef AXI_RESP_FAST_IO
-    static uint64_t* print_buffer;
-    static uint32_t buf_ptr;
+    // one buffer per NVDLA so that NVDLAs can run on different host threads
+    uint64_t* print_buffer;
+    uint32_t buf_ptr;
 #define PB_SIZE (1024 * 1024 * 2)
 #endif
 
@@ -170,8 +232,17 @@ public:
 
     // software prefetching
     int prefetch_enable;
+    // prefetch engine of axi_dbb, see AXIResponder::generate_prefetch_request
+    uint32_t pft_threshold;         // prefetch while fewer reads are in flight
+    uint32_t dma_pft_threshold;     // and fewer DMA line fills
+    uint32_t pft_lookahead;         // upcoming read-only variables prefetched at once
+    uint32_t pft_depth;             // bytes a variable is prefetched ahead of the RTL, 0 for no limit
+    uint32_t pft_max_bw;            // read bytes per cycle from memory above which prefetching stops, 0 for no limit
     BufferMode buf_mode;
     uint32_t assoc;
+    bool flat_spm;      // use flatBufferSet instead of allBufferSet
+    spmReplacementPolicy* spm_rp;   // replacement policy of allBufferSet, LRU if nullptr. Not owned.
+    nvdlaStatsRecorder* stats_recorder;    // nullptr if nobody collects statistics. Not owned.
 };
 
 #endif 
\ No newline at end of file
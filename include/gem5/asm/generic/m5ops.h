@@ -71,7 +71,7 @@
 #define M5OP_WAIT_ACCEL         0x56 // Reserved for user
 #define M5OP_START_ACCEL_ID     0x57 // Reserved for user
 #define M5OP_WAIT_ACCEL_ID      0x58 // Reserved for user
-#define M5OP_RESERVED5          0x59 // Reserved for user
+#define M5OP_SLEEP_ACCEL        0x59 // Suspend until an accelerator of a mask finishes
 
 #define M5OP_WORK_BEGIN         0x5a
 #define M5OP_WORK_END           0x5b
@@ -111,7 +111,8 @@
     M5OP(m5_start_accel, M5OP_START_ACCEL)                      \
     M5OP(m5_wait_accel, M5OP_WAIT_ACCEL)                        \
     M5OP(m5_start_accel_id, M5OP_START_ACCEL_ID)                \
-    M5OP(m5_wait_accel_id, M5OP_WAIT_ACCEL_ID)
+    M5OP(m5_wait_accel_id, M5OP_WAIT_ACCEL_ID)                  \
+    M5OP(m5_sleep_accel, M5OP_SLEEP_ACCEL)
 
 #define M5OP_MERGE_TOKENS_I(a, b) a##b
 #define M5OP_MERGE_TOKENS(a, b) M5OP_MERGE_TOKENS_I(a, b)
@@ -70,6 +70,14 @@ void m5_start_accel(uint64_t addr, uint64_t elements, uint64_t region_mem);
 void m5_start_accel_id(uint64_t addr, uint64_t elements, uint64_t region_mem, int accel_id);
 uint64_t m5_wait_accel(uint64_t addr, uint64_t elements);
 uint64_t m5_wait_accel_id(int accel_id);
+/*
+ * Blocking m5_wait_accel_id for the accelerators in accel_mask (bit i for
+ * accelerator i). Unless one of them has already finished all the traces
+ * submitted to it, the calling thread is suspended until one does.
+ * Returns whether it had to wait, so wait with
+ * while (m5_sleep_accel(mask)); in case something else wakes it up.
+ */
+uint64_t m5_sleep_accel(uint64_t accel_mask);
 /*
  * Send a very generic poke to the workload so it can do something. It's up to
  * the workload to know what information to look for to interpret an event,
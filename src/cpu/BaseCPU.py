@@ -125,10 +125,8 @@ class BaseCPU(ClockedObject):
 
 
     # ACCELERATORS
-    accel_0 = Param.rtlNVDLA(NULL, "RTL NVDLA Accelerator Object")
-    accel_1 = Param.rtlNVDLA(NULL, "RTL NVDLA Accelerator Object")
-    accel_2 = Param.rtlNVDLA(NULL, "RTL NVDLA Accelerator Object")
-    accel_3 = Param.rtlNVDLA(NULL, "RTL NVDLA Accelerator Object")
+    accel = VectorParam.rtlNVDLA([], "RTL NVDLA Accelerator Objects, "
+                                 "accel[i] is served by accel_port[i]")
 
     num_accels = Param.Int(0, "Number of rtl Objects")
 
@@ -182,10 +180,7 @@ class BaseCPU(ClockedObject):
     icache_port = RequestPort("Instruction Port")
     dcache_port = RequestPort("Data Port")
 
-    accel_port_0 = RequestPort("Accelerator Port")
-    accel_port_1 = RequestPort("Accelerator Port")
-    accel_port_2 = RequestPort("Accelerator Port")
-    accel_port_3 = RequestPort("Accelerator Port")
+    accel_port = VectorRequestPort("Accelerator Ports")
 
     _cached_ports = ['icache_port', 'dcache_port']
 
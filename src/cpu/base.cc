@@ -48,6 +48,7 @@
 #include <string>
 
 #include "arch/generic/tlb.hh"
+#include "base/bitfield.hh"
 #include "base/cprintf.hh"
 #include "base/loader/symtab.hh"
 #include "base/logging.hh"
@@ -55,6 +56,7 @@
 #include "base/trace.hh"
 #include "cpu/checker/cpu.hh"
 #include "cpu/thread_context.hh"
+#include "debug/Accel.hh"
 #include "debug/Mwait.hh"
 #include "debug/SyscallVerbose.hh"
 #include "debug/Thread.hh"
@@ -131,10 +133,7 @@ BaseCPU::BaseCPU(const Params &p, bool is_checker)
       _dataRequestorId(p.system->getRequestorId(this, "data")),
       _taskId(context_switch_task_id::Unknown), _pid(invldPid),
       _switchedOut(p.switched_out), _cacheLineSize(p.system->cacheLineSize()),
-      nvdla_port_0(this,"0"),
-      nvdla_port_1(this,"1"),
-      nvdla_port_2(this,"2"),
-      nvdla_port_3(this,"3"),
+      nvdla(p.accel),
       num_accels(p.num_accels),
       interrupts(p.interrupts), numThreads(p.numThreads), system(p.system),
       previousCycle(0), previousState(CPU_STATE_SLEEP),
@@ -147,10 +146,12 @@ BaseCPU::BaseCPU(const Params &p, bool is_checker)
       powerGatingOnIdle(p.power_gating_on_idle),
       enterPwrGatingEvent([this]{ enterPwrGating(); }, name())
 {
-    nvdla_0 = p.accel_0;
-    nvdla_1 = p.accel_1;
-    nvdla_2 = p.accel_2;
-    nvdla_3 = p.accel_3;
+    for (int i = 0; i < p.port_accel_port_connection_count; i++)
+        nvdla_ports.emplace_back(new AccelPort(this, csprintf("[%d]", i)));
+
+    fatal_if(num_accels > nvdla_ports.size(),
+             "%s: num_accels (%d) is larger than the number of connected "
+             "accel_port (%d)\n", name(), num_accels, nvdla_ports.size());
 
     // if Python did not provide a valid ID, do it here
     if (_cpuId == -1 ) {
@@ -190,10 +191,9 @@ BaseCPU::BaseCPU(const Params &p, bool is_checker)
               "of threads (%i).\n", params().isa.size(), numThreads);
     }
 
-    finishedAccelerator0=true;
-    finishedAccelerator1=true;
-    finishedAccelerator2=true;
-    finishedAccelerator3=true;
+    finishedAccelerator.assign(nvdla_ports.size(), true);
+    accelPending.assign(nvdla_ports.size(), 0);
+    accelSleeping.assign(numThreads, 0);
 }
 
 void
@@ -204,10 +204,8 @@ BaseCPU::enableFunctionTrace()
 
 BaseCPU::~BaseCPU()
 {
-    delete nvdla_0;
-    delete nvdla_1;
-    delete nvdla_2;
-    delete nvdla_3;
+    for (auto accel : nvdla)
+        delete accel;
 }
 
 void
@@ -437,14 +435,8 @@ BaseCPU::getPort(const std::string &if_name, PortID idx)
     else if (if_name == "icache_port")
         return getInstPort();
     // (guillemlp) Add accelerator port when requested
-    else if (if_name == "accel_port_0")
-        return getAccelPort(0);
-    else if (if_name == "accel_port_1")
-        return getAccelPort(1);
-    else if (if_name == "accel_port_2")
-        return getAccelPort(2);
-    else if (if_name == "accel_port_3")
-        return getAccelPort(3);
+    else if (if_name == "accel_port" && idx != InvalidPortID)
+        return getAccelPort(idx);
     else
         return ClockedObject::getPort(if_name, idx);
 }
@@ -457,16 +449,96 @@ BaseCPU::getAccelPort(int n)
     // subclasses of the base CPU and relies on their implementation
     // of getDataPort and getInstPort. In all cases there methods
     // return a MasterPort pointer.
-    if (n==0) {
-        return nvdla_port_0;
-    } else if (n==1) {
-        return nvdla_port_1;
-    } else if (n==2) {
-        return nvdla_port_2;
-    } else {
-        return nvdla_port_3;
+    panic_if(n < 0 || n >= nvdla_ports.size(),
+             "%s: no accelerator port %d\n", name(), n);
+    return *nvdla_ports[n];
+}
+
+void
+BaseCPU::startAccel(ThreadContext *tc, Addr vaddr, int elements,
+                    Addr region_nvdla)
+{
+    for (int i = num_accels - 1; i >= 0; i--)
+        submitAccel(tc, i, vaddr, elements);
+}
+
+void
+BaseCPU::startAccelID(ThreadContext *tc, Addr vaddr, int elements,
+                      Addr region_nvdla, int accel_id)
+{
+    // unknown ids are ignored
+    if (accel_id < 0 || accel_id >= nvdla_ports.size())
+        return;
+
+    // queued by the accelerator if it is still busy
+    submitAccel(tc, accel_id, vaddr, elements);
+}
+
+uint64_t
+BaseCPU::waitAccel(Addr vaddr, int elements)
+{
+    uint64_t running = 0;
+    for (int i = 0; i < num_accels; i++)
+        running |= !finishedAccelerator[i];
+    return running;
+}
+
+uint64_t
+BaseCPU::waitAccelID(int accel_id)
+{
+    if (accel_id < 0 || accel_id >= finishedAccelerator.size())
+        fatal("waitAccelID: Unknown accel id.\n");
+    return !finishedAccelerator[accel_id];
+}
+
+void
+BaseCPU::submitAccel(ThreadContext *tc, int accel_id, Addr addr, int elements)
+{
+    RequestPtr req = std::make_shared<Request>(addr, elements,
+                              0, Request::funcRequestorId, 0,
+                              tc->contextId());
+    PacketPtr pkt = new Packet(req, MemCmd::ReadReq, elements);
+    nvdla_ports[accel_id]->sendTimingReq(pkt);
+
+    accelPending[accel_id]++;
+    finishedAccelerator[accel_id] = false;
+}
+
+void
+BaseCPU::accelDone(int accel_id)
+{
+    if (accelPending[accel_id] > 0)
+        accelPending[accel_id]--;
+    if (accelPending[accel_id] > 0)
+        return;
+
+    finishedAccelerator[accel_id] = true;
+    for (ThreadID tid = 0; tid < accelSleeping.size(); tid++) {
+        if (!bits(accelSleeping[tid], accel_id))
+            continue;
+        accelSleeping[tid] = 0;
+        ThreadContext *tc = threadContexts[tid];
+        if (tc->status() == ThreadContext::Suspended)
+            tc->activate();
+    }
+}
+
+uint64_t
+BaseCPU::sleepAccel(ThreadContext *tc, uint64_t accel_mask)
+{
+    // accelerators we do not have never finish, do not wait for them
+    if (finishedAccelerator.size() < 64)
+        accel_mask &= mask(finishedAccelerator.size());
+    if (!accel_mask)
+        return 0;
+    for (int i = 0; i < finishedAccelerator.size(); i++) {
+        if (bits(accel_mask, i) && finishedAccelerator[i])
+            return 0;
     }
 
+    accelSleeping[tc->threadId()] = accel_mask;
+    tc->quiesce();
+    return 1;
 }
 
 void
@@ -660,7 +732,23 @@ BaseCPU::takeOverFrom(BaseCPU *oldCPU)
     getInstPort().takeOverFrom(&oldCPU->getInstPort());
     getDataPort().takeOverFrom(&oldCPU->getDataPort());
 
-    getAccelPort(0).takeOverFrom(&oldCPU->getAccelPort(0));
+    // Switched out CPUs usually have their accel_port unconnected, give
+    // them one port per accelerator of the old CPU before taking over.
+    while (nvdla_ports.size() < oldCPU->nvdla_ports.size()) {
+        nvdla_ports.emplace_back(
+            new AccelPort(this, csprintf("[%d]", nvdla_ports.size())));
+    }
+    for (int i = 0; i < oldCPU->nvdla_ports.size(); i++)
+        getAccelPort(i).takeOverFrom(&oldCPU->getAccelPort(i));
+
+    // The accelerators keep running across the switch, their responses
+    // and the threads sleeping on them now belong to this CPU.
+    num_accels = oldCPU->num_accels;
+    finishedAccelerator = oldCPU->finishedAccelerator;
+    accelPending = oldCPU->accelPending;
+    accelSleeping = oldCPU->accelSleeping;
+    finishedAccelerator.resize(nvdla_ports.size(), true);
+    accelPending.resize(nvdla_ports.size(), 0);
 }
 
 void
@@ -681,6 +769,14 @@ void
 BaseCPU::serialize(CheckpointOut &cp) const
 {
     SERIALIZE_SCALAR(instCnt);
+    // a checkpoint may be taken while the accelerators are running
+    for (int i = 0; i < finishedAccelerator.size(); i++) {
+        bool finished = finishedAccelerator[i];
+        paramOut(cp, csprintf("finishedAccelerator%d", i), finished);
+        paramOut(cp, csprintf("accelPending%d", i), accelPending[i]);
+    }
+    for (ThreadID i = 0; i < accelSleeping.size(); i++)
+        paramOut(cp, csprintf("accelSleeping%d", i), accelSleeping[i]);
 
     if (!_switchedOut) {
         /* Unlike _pid, _taskId is not serialized, as they are dynamically
@@ -702,6 +798,16 @@ void
 BaseCPU::unserialize(CheckpointIn &cp)
 {
     UNSERIALIZE_SCALAR(instCnt);
+    for (int i = 0; i < finishedAccelerator.size(); i++) {
+        bool finished;
+        if (optParamIn(cp, csprintf("finishedAccelerator%d", i), finished))
+            finishedAccelerator[i] = finished;
+        // older checkpoints had at most one trace per accelerator
+        accelPending[i] = !finishedAccelerator[i];
+        optParamIn(cp, csprintf("accelPending%d", i), accelPending[i]);
+    }
+    for (ThreadID i = 0; i < accelSleeping.size(); i++)
+        optParamIn(cp, csprintf("accelSleeping%d", i), accelSleeping[i]);
 
     if (!_switchedOut) {
         UNSERIALIZE_SCALAR(_pid);
@@ -828,24 +934,18 @@ BaseCPU::AccelPort::ITickEvent::process()
 bool
 BaseCPU::AccelPort::recvTimingResp(PacketPtr pkt)
 {
-    //DPRINTF(SimpleCPU, "Received fetch response %#x\n", pkt->getAddr());
-    std::cout << "Received finished addr: " << pkt->getAddr() << std::endl;
+    DPRINTF(Accel, "Accelerator %d finished\n", pkt->getAddr());
 
-    if (pkt->getAddr() == 0) {
-        cpu->finishedAccelerator0=true;
-    }
+    // the accelerator may be simulated on another event queue, and waking
+    // up threads touches the event queue of this CPU
+    EventQueue::ScopedMigration migrate(cpu->eventQueue(), inParallelMode);
 
-    else if (pkt->getAddr() == 1) {
-        cpu->finishedAccelerator1=true;
-    }
-
-    else if (pkt->getAddr() == 2) {
-        cpu->finishedAccelerator2=true;
-    }
-
-    else {
-        cpu->finishedAccelerator3=true;
-    }
+    // the accelerator answers with its id as the address
+    panic_if(pkt->getAddr() >= cpu->finishedAccelerator.size(),
+             "%s: response from unknown accelerator %d\n",
+             name(), pkt->getAddr());
+    cpu->accelDone(pkt->getAddr());
+    delete pkt;
 
     return true;
 }
@@ -224,42 +224,63 @@ class BaseCPU : public ClockedObject
         ITickEvent tickEvent;
 
     };
-    AccelPort nvdla_port_0;
-    AccelPort nvdla_port_1;
-    AccelPort nvdla_port_2;
-    AccelPort nvdla_port_3;
+    // accelerator i is nvdla[i], started through nvdla_ports[i]
+    std::vector<std::unique_ptr<AccelPort>> nvdla_ports;
 
-    rtlNVDLA* nvdla_0;
-    rtlNVDLA* nvdla_1;
-    rtlNVDLA* nvdla_2;
-    rtlNVDLA* nvdla_3;
+    std::vector<rtlNVDLA*> nvdla;
 
     int num_accels;
 
 
 
-    // Method to use when instruction start accel is used
-    virtual void startAccel(Addr addr, int elements, Addr region_nvdla)  {};
+    // Method to use when instruction start accel is used, starts the
+    // trace on every accelerator
+    virtual void startAccel(ThreadContext *tc, Addr addr, int elements,
+                            Addr region_nvdla);
 
     // Method to use when instruction start_accel_id is used
-    virtual void startAccelID(Addr addr, int elements, Addr region_nvdla, int accel_id)  {};
+    virtual void startAccelID(ThreadContext *tc, Addr addr, int elements,
+                              Addr region_nvdla, int accel_id);
 
-    virtual uint64_t waitAccel(Addr addr, int elements)  {
-        std::cout << "THIS SHOULD NOT BE PRINTED, " <<
-        " HENCE WAIT ACCEL NOT IMPLMENTED" << std::endl;
-        return !finishedAccelerator0;
-    };
+    // whether any accelerator is still running
+    virtual uint64_t waitAccel(Addr addr, int elements);
 
-    virtual uint64_t waitAccelID(int accel_id)  {
-        std::cout << "THIS SHOULD NOT BE PRINTED, " <<
-        " HENCE WAIT ACCEL ID NOT IMPLMENTED" << std::endl;
-        return !finishedAccelerator0;
-    };
+    // whether accelerator accel_id is still running
+    virtual uint64_t waitAccelID(int accel_id);
+
+    // one flag per accelerator, cleared on start and set once it has
+    // answered all the traces submitted to it
+    std::vector<bool> finishedAccelerator;
+
+    // traces submitted to each accelerator and not finished yet, the
+    // accelerator queues them and runs them back to back
+    std::vector<uint32_t> accelPending;
+
+    // accelerators (bit i for accelerator i) each thread sleeps on in
+    // sleepAccel, 0 for none
+    std::vector<uint64_t> accelSleeping;
+
+    /**
+     * Submit a trace to an accelerator, see startAccelID. The request
+     * carries the context of tc, whose address space the trace is in.
+     */
+    void submitAccel(ThreadContext *tc, int accel_id, Addr addr,
+                     int elements);
+
+    /**
+     * The accelerator finished the oldest trace submitted to it. Once it
+     * has finished all of them, the threads sleeping on it are woken up.
+     */
+    void accelDone(int accel_id);
 
-    bool finishedAccelerator0;
-    bool finishedAccelerator1;
-    bool finishedAccelerator2;
-    bool finishedAccelerator3;
+    /**
+     * Method to use when instruction sleep_accel is used. If all the
+     * accelerators in accel_mask are still running, suspend the thread
+     * until one of them is done.
+     *
+     * @return whether the thread was suspended
+     */
+    uint64_t sleepAccel(ThreadContext *tc, uint64_t accel_mask);
 
     /**
      * method that returns a reference to the accelerator
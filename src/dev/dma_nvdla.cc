@@ -58,11 +58,14 @@ namespace gem5
 DmaNvdla::DmaNvdla(DmaPort &_port, bool _is_write, size_t size,
                          unsigned max_req_size,
                          unsigned max_pending,
-                         Request::Flags flags)
+                         Request::Flags flags,
+                         bool out_of_order)
     : maxReqSize(max_req_size), fifoSize(size),
       reqFlags(flags), port(_port), cacheLineSize(port.sys->cacheLineSize()),
-      buffer(size), is_write(_is_write)
+      buffer(size), is_write(_is_write), outOfOrder(out_of_order)
 {
+    panic_if(is_write && outOfOrder, "Out-of-order DMA engines only read");
+
     freeRequests.resize(max_pending);
     for (auto &e : freeRequests)
         e.reset(new DmaDoneEvent(this, max_req_size));
@@ -89,10 +92,12 @@ void
 DmaNvdla::serialize(CheckpointOut &cp) const
 {
     assert(pendingRequests.empty());
+    assert(completedRequests.empty());
 
     SERIALIZE_CONTAINER(buffer);
     SERIALIZE_SCALAR(endAddr);
     SERIALIZE_SCALAR(nextAddr);
+    SERIALIZE_SCALAR(tagOffset);
 }
 
 void
@@ -101,6 +106,7 @@ DmaNvdla::unserialize(CheckpointIn &cp)
     UNSERIALIZE_CONTAINER(buffer);
     UNSERIALIZE_SCALAR(endAddr);
     UNSERIALIZE_SCALAR(nextAddr);
+    UNSERIALIZE_SCALAR(tagOffset);
 }
 
 bool
@@ -115,6 +121,26 @@ DmaNvdla::tryGet(uint8_t *dst, size_t len)
     }
 }
 
+size_t
+DmaNvdla::tryGetCompleted(Addr &tag, uint8_t *dst, size_t len)
+{
+    assert(outOfOrder);
+    if (completedRequests.empty())
+        return 0;
+
+    DmaDoneEventUPtr event(std::move(completedRequests.front()));
+    completedRequests.pop_front();
+    const size_t size(event->requestSize());
+    panic_if(size > len, "DMA request of %d bytes does not fit in %d",
+             size, len);
+    tag = event->tag();
+    std::memcpy(dst, event->data(), size);
+
+    freeRequests.emplace_back(std::move(event));
+    resumeFill();
+    return size;
+}
+
 void
 DmaNvdla::get(uint8_t *dst, size_t len)
 {
@@ -122,12 +148,13 @@ DmaNvdla::get(uint8_t *dst, size_t len)
 }
 
 void
-DmaNvdla::startFill(Addr start, size_t size, uint8_t* d)
+DmaNvdla::startFill(Addr start, size_t size, uint8_t* d, Addr tag)
 {
     assert(atEndOfBlock());
 
     nextAddr = start;
     endAddr = start + size;
+    tagOffset = tag - start;
     if (is_write) {
         buffer.write(d, size);
     }
@@ -169,6 +196,22 @@ DmaNvdla::resumeFill()
 void
 DmaNvdla::resumeFillBypass()
 {
+    if (outOfOrder) {
+        // atomic accesses complete right away
+        while (!freeRequests.empty() && !atEndOfBlock()) {
+            const size_t req_size(std::min(maxReqSize, endAddr - nextAddr));
+            DmaDoneEventUPtr event(std::move(freeRequests.front()));
+            freeRequests.pop_front();
+            event->reset(req_size, nextAddr + tagOffset);
+
+            port.dmaAction(MemCmd::ReadReq, nextAddr, req_size, nullptr,
+                           event->data(), 0, reqFlags);
+            nextAddr += req_size;
+            completedRequests.emplace_back(std::move(event));
+        }
+        return;
+    }
+
     const size_t fifo_space = buffer.capacity() - buffer.size();
     if (fifo_space >= cacheLineSize || buffer.capacity() < cacheLineSize) {
         const size_t block_remaining = endAddr - nextAddr;
@@ -194,6 +237,9 @@ DmaNvdla::resumeFillTiming()
     size_t size_pending(0);
     for (auto &e : pendingRequests)
         size_pending += e->requestSize();
+    // completed out-of-order data waits outside of the FIFO, but counts
+    for (auto &e : completedRequests)
+        size_pending += e->requestSize();
 
     while (!freeRequests.empty() && !atEndOfBlock()) {
         const size_t req_size(std::min(maxReqSize, endAddr - nextAddr));
@@ -204,7 +250,7 @@ DmaNvdla::resumeFillTiming()
         freeRequests.pop_front();
         assert(event);
 
-        event->reset(req_size);
+        event->reset(req_size, nextAddr + tagOffset);
 
         if (is_write)
             buffer.read(event->data(), req_size);
@@ -222,10 +268,13 @@ void
 DmaNvdla::dmaDone()
 {
     const bool old_active(isActive());
+    const size_t old_completed(completedRequests.size());
 
     handlePending();
     resumeFill();
 
+    if (completedRequests.size() > old_completed)
+        onCompletion();
     if (old_active && !isActive())
         onIdle();
 }
@@ -233,6 +282,27 @@ DmaNvdla::dmaDone()
 void
 DmaNvdla::handlePending()
 {
+    if (outOfOrder) {
+        for (auto it = pendingRequests.begin();
+             it != pendingRequests.end();) {
+            if (!(*it)->done()) {
+                ++it;
+                continue;
+            }
+            DmaDoneEventUPtr event(std::move(*it));
+            it = pendingRequests.erase(it);
+
+            if (event->canceled())
+                freeRequests.emplace_back(std::move(event));
+            else
+                completedRequests.emplace_back(std::move(event));
+        }
+
+        if (pendingRequests.empty())
+            signalDrainDone();
+        return;
+    }
+
     while (!pendingRequests.empty() && pendingRequests.front()->done()) {
         // Get the first finished pending request
         DmaDoneEventUPtr event(std::move(pendingRequests.front()));
@@ -256,6 +326,12 @@ DmaNvdla::drain()
         DrainState::Drained : DrainState::Draining;
 }
 
+void
+DmaNvdla::drainResume()
+{
+    resumeFill();
+}
+
 
 DmaNvdla::DmaDoneEvent::DmaDoneEvent(DmaNvdla *_parent, size_t max_size)
     : parent(_parent), _data(max_size, 0)
@@ -276,12 +352,13 @@ DmaNvdla::DmaDoneEvent::cancel()
 }
 
 void
-DmaNvdla::DmaDoneEvent::reset(size_t size)
+DmaNvdla::DmaDoneEvent::reset(size_t size, Addr tag)
 {
     assert(size <= _data.size());
     _done = false;
     _canceled = false;
     _requestSize = size;
+    _tag = tag;
 }
 
 void
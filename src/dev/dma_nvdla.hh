@@ -105,10 +105,16 @@ class ClockedObject;
 class DmaNvdla : public Drainable, public Serializable
 {
   public:
+    /**
+     * @param out_of_order Hand read data over per request as soon as it
+     * arrives (see tryGetCompleted()) instead of in order through the
+     * FIFO. max_pending is then the number of requests in flight.
+     */
     DmaNvdla(DmaPort &port, bool _is_write, size_t size,
                 unsigned max_req_size,
                 unsigned max_pending,
-                Request::Flags flags=0);
+                Request::Flags flags=0,
+                bool out_of_order=false);
 
     ~DmaNvdla();
 
@@ -118,6 +124,8 @@ class DmaNvdla : public Drainable, public Serializable
 
   public: // Drainable
     DrainState drain() override;
+    /** Send the rest of a block that was interrupted by draining. */
+    void drainResume() override;
 
   public: // FIFO access
     /**
@@ -167,6 +175,18 @@ class DmaNvdla : public Drainable, public Serializable
     /** Get the amount of data stored in the FIFO */
     size_t size() const { return buffer.size(); }
 
+    /**
+     * Take the data of the oldest completed request of an out-of-order
+     * engine, whatever the order the requests were issued in.
+     *
+     * @param tag Set to the tag of the request, i.e., the tag given to
+     * startFill() plus the offset of the request within its block.
+     * @param dst Pointer to a destination buffer of at least len bytes.
+     * @param len Size of dst, has to fit the request.
+     * @return The size of the request, 0 if none has completed.
+     */
+    size_t tryGetCompleted(Addr &tag, uint8_t *dst, size_t len);
+
     /** @} */
   public: // FIFO fill control
     /**
@@ -182,8 +202,12 @@ class DmaNvdla : public Drainable, public Serializable
      *
      * @param start Physical address to copy from.
      * @param size Size of the block to copy.
+     * @param d Data to write for a write engine.
+     * @param tag Address the caller knows the block by, handed back by
+     * tryGetCompleted().
      */
-    void startFill(Addr start, size_t size, uint8_t* d = nullptr);
+    void startFill(Addr start, size_t size, uint8_t* d = nullptr,
+                   Addr tag = 0);
 
     /**
      * Stop the DMA engine.
@@ -201,6 +225,16 @@ class DmaNvdla : public Drainable, public Serializable
      */
     bool atEndOfBlock() const { return nextAddr == endAddr; }
 
+    /**
+     * Can a new block be started and its first request be sent right
+     * away?
+     */
+    bool
+    canStartFill() const
+    {
+        return atEndOfBlock() && !freeRequests.empty();
+    }
+
     /**
      * Is the DMA engine active (i.e., are there still in-flight
      * accesses)?
@@ -211,6 +245,15 @@ class DmaNvdla : public Drainable, public Serializable
         return !(pendingRequests.empty() && atEndOfBlock());
     }
 
+    /** Are there requests waiting for memory? */
+    bool hasPending() const { return !pendingRequests.empty(); }
+
+    /**
+     * Are there completed requests of an out-of-order engine that have
+     * not been taken with tryGetCompleted() yet?
+     */
+    bool hasCompleted() const { return !completedRequests.empty(); }
+
     /** @} */
   protected: // Callbacks
     /**
@@ -239,6 +282,14 @@ class DmaNvdla : public Drainable, public Serializable
      */
     virtual void onIdle() {};
 
+    /**
+     * Request completed callback
+     *
+     * This callback is called whenever requests of an out-of-order
+     * engine complete and can be taken with tryGetCompleted().
+     */
+    virtual void onCompletion() {};
+
     /** @} */
   private: // Configuration
     /** Maximum request size in bytes */
@@ -261,11 +312,12 @@ class DmaNvdla : public Drainable, public Serializable
         void kill();
         void cancel();
         bool canceled() const { return _canceled; }
-        void reset(size_t size);
+        void reset(size_t size, Addr tag=0);
         void process();
 
         bool done() const { return _done; }
         size_t requestSize() const { return _requestSize; }
+        Addr tag() const { return _tag; }
         const uint8_t *data() const { return _data.data(); }
         uint8_t *data() { return _data.data(); }
 
@@ -274,6 +326,7 @@ class DmaNvdla : public Drainable, public Serializable
         bool _done = false;
         bool _canceled = false;
         size_t _requestSize;
+        Addr _tag = 0;
         std::vector<uint8_t> _data;
     };
 
@@ -302,10 +355,15 @@ class DmaNvdla : public Drainable, public Serializable
 
     Addr nextAddr = 0;
     Addr endAddr = 0;
+    /** tag of the request at nextAddr minus nextAddr */
+    Addr tagOffset = 0;
 
     std::deque<DmaDoneEventUPtr> pendingRequests;
     std::deque<DmaDoneEventUPtr> freeRequests;
+    /** Completed requests of an out-of-order engine, oldest first */
+    std::deque<DmaDoneEventUPtr> completedRequests;
     bool is_write;
+    const bool outOfOrder;
 };
 
 } // namespace gem5
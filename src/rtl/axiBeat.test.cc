@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) 2022 Barcelona Supercomputing Center
+ * All rights reserved.
+ *
+ * The license below extends only to copyright in the software and shall
+ * not be construed as granting a license to any other intellectual
+ * property including but not limited to intellectual property relating
+ * to a hardware implementation of the functionality of the software
+ * licensed hereunder.  You may use the software subject to the license
+ * terms below provided that you ensure that this notice is replicated
+ * unmodified and in its entirety in all distributions of the software,
+ * modified or unmodified, in source code or in binary form.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "axiBeat.hh"
+
+/*
+ * Byte-at-a-time references, i.e., the loops AXIResponder and the embedded
+ * buffer used before the kernels in axiBeat.hh.
+ */
+static void
+refPack(uint32_t *words, const uint8_t *bytes)
+{
+    for (int i = 0; i < AXI_BEAT_BYTES / 4; i++) {
+        words[i] = (bytes[4 * i]) +
+            (((uint32_t)bytes[4 * i + 1]) << 8) +
+            (((uint32_t)bytes[4 * i + 2]) << 16) +
+            (((uint32_t)bytes[4 * i + 3]) << 24);
+    }
+}
+
+static void
+refUnpack(uint8_t *bytes, const uint32_t *words)
+{
+    for (int i = 0; i < AXI_BEAT_BYTES / 4; i++) {
+        bytes[4 * i    ] = (words[i]      ) & 0xFF;
+        bytes[4 * i + 1] = (words[i] >>  8) & 0xFF;
+        bytes[4 * i + 2] = (words[i] >> 16) & 0xFF;
+        bytes[4 * i + 3] = (words[i] >> 24) & 0xFF;
+    }
+}
+
+static void
+refMerge(uint8_t *dst, const uint8_t *src, uint64_t strb)
+{
+    for (int i = 0; i < AXI_BEAT_BYTES; i++) {
+        if ((strb >> i) & 1)
+            dst[i] = src[i];
+    }
+}
+
+static void
+fillRandom(std::mt19937_64 &rng, uint8_t *buf, int len)
+{
+    for (int i = 0; i < len; i++)
+        buf[i] = rng();
+}
+
+TEST(AxiBeatTest, StrbToLanes)
+{
+    for (int strb = 0; strb < 256; strb++) {
+        uint64_t lanes = axi_strb_to_lanes(strb);
+        for (int i = 0; i < 8; i++) {
+            uint8_t lane;
+            memcpy(&lane, (uint8_t *)&lanes + i, 1);
+            EXPECT_EQ((strb >> i) & 1 ? 0xFF : 0x00, lane);
+        }
+    }
+}
+
+TEST(AxiBeatTest, CopyPackUnpack)
+{
+    std::mt19937_64 rng(1);
+    // offset the buffers so that unaligned accesses are covered as well
+    alignas(64) uint8_t bytes[AXI_BEAT_BYTES + 1];
+    alignas(64) uint8_t out[AXI_BEAT_BYTES + 1];
+    alignas(64) uint8_t ref_out[AXI_BEAT_BYTES];
+    alignas(64) uint32_t words[AXI_BEAT_BYTES / 4];
+    alignas(64) uint32_t ref_words[AXI_BEAT_BYTES / 4];
+
+    for (int iter = 0; iter < 1000; iter++) {
+        fillRandom(rng, bytes, sizeof(bytes));
+        axi_beat_copy(out + 1, bytes + 1);
+        EXPECT_EQ(0, memcmp(out + 1, bytes + 1, AXI_BEAT_BYTES));
+
+        axi_beat_pack(words, bytes + 1);
+        refPack(ref_words, bytes + 1);
+        EXPECT_EQ(0, memcmp(words, ref_words, sizeof(words)));
+
+        axi_beat_unpack(out + 1, words);
+        refUnpack(ref_out, words);
+        EXPECT_EQ(0, memcmp(out + 1, ref_out, AXI_BEAT_BYTES));
+    }
+}
+
+TEST(AxiBeatTest, Merge)
+{
+    std::mt19937_64 rng(2);
+    alignas(64) uint8_t src[AXI_BEAT_BYTES + 1];
+    alignas(64) uint8_t dst[AXI_BEAT_BYTES + 1];
+    alignas(64) uint8_t ref_dst[AXI_BEAT_BYTES];
+
+    std::vector<uint64_t> strbs = {0, ~0ULL, 1, 1ULL << 63, 0xFFFFFFFFULL,
+                                   0xFFFFFFFF00000000ULL, 0x5555555555555555ULL};
+    for (int i = 0; i < 1000; i++)
+        strbs.push_back(rng());
+
+    for (uint64_t strb : strbs) {
+        fillRandom(rng, src, sizeof(src));
+        fillRandom(rng, dst, sizeof(dst));
+        memcpy(ref_dst, dst + 1, AXI_BEAT_BYTES);
+
+        axi_beat_merge(dst + 1, src + 1, strb);
+        refMerge(ref_dst, src + 1, strb);
+        EXPECT_EQ(0, memcmp(dst + 1, ref_dst, AXI_BEAT_BYTES)) <<
+            "strb " << std::hex << strb;
+    }
+}
+
+/*
+ * Micro-benchmark of the kernels against the byte loops. It reports ns per
+ * beat and only checks that both produce the same result, since timing
+ * depends on the host and on the flags the test is compiled with.
+ */
+template <typename F>
+static double
+nsPerBeat(int beats, F f)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < beats; i++)
+        f(i);
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() /
+        beats;
+}
+
+TEST(AxiBeatTest, MicroBenchmark)
+{
+    const int num_bufs = 256;
+    const int beats = 1 << 20;
+    std::mt19937_64 rng(3);
+    std::vector<uint8_t> src(num_bufs * AXI_BEAT_BYTES);
+    std::vector<uint8_t> dst(num_bufs * AXI_BEAT_BYTES);
+    std::vector<uint8_t> ref_dst(num_bufs * AXI_BEAT_BYTES);
+    std::vector<uint32_t> words(num_bufs * AXI_BEAT_BYTES / 4);
+    std::vector<uint64_t> strbs(num_bufs);
+    fillRandom(rng, src.data(), src.size());
+    for (auto &strb : strbs)
+        strb = rng();
+
+    auto beat = [](int i) { return (i * 7) % num_bufs; };
+
+    double ref_unpack = nsPerBeat(beats, [&](int i) {
+        refUnpack(&ref_dst[beat(i) * AXI_BEAT_BYTES], &words[beat(i + 1) * 16]);
+    });
+    double simd_unpack = nsPerBeat(beats, [&](int i) {
+        axi_beat_unpack(&dst[beat(i) * AXI_BEAT_BYTES], &words[beat(i + 1) * 16]);
+    });
+    EXPECT_EQ(ref_dst, dst);
+
+    double ref_pack = nsPerBeat(beats, [&](int i) {
+        refPack(&words[beat(i) * 16], &src[beat(i + 1) * AXI_BEAT_BYTES]);
+    });
+    double simd_pack = nsPerBeat(beats, [&](int i) {
+        axi_beat_pack(&words[beat(i) * 16], &src[beat(i + 1) * AXI_BEAT_BYTES]);
+    });
+
+    double ref_merge = nsPerBeat(beats, [&](int i) {
+        refMerge(&ref_dst[beat(i) * AXI_BEAT_BYTES],
+                 &src[beat(i + 1) * AXI_BEAT_BYTES], strbs[beat(i)]);
+    });
+    double simd_merge = nsPerBeat(beats, [&](int i) {
+        axi_beat_merge(&dst[beat(i) * AXI_BEAT_BYTES],
+                       &src[beat(i + 1) * AXI_BEAT_BYTES], strbs[beat(i)]);
+    });
+    EXPECT_EQ(ref_dst, dst);
+
+    printf("axiBeat ns/beat (byte loop -> kernel): unpack %.2f -> %.2f, "
+           "pack %.2f -> %.2f, merge %.2f -> %.2f\n",
+           ref_unpack, simd_unpack, ref_pack, simd_pack,
+           ref_merge, simd_merge);
+}
@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2022 Barcelona Supercomputing Center
+ * All rights reserved.
+ *
+ * The license below extends only to copyright in the software and shall
+ * not be construed as granting a license to any other intellectual
+ * property including but not limited to intellectual property relating
+ * to a hardware implementation of the functionality of the software
+ * licensed hereunder.  You may use the software subject to the license
+ * terms below provided that you ensure that this notice is replicated
+ * unmodified and in its entirety in all distributions of the software,
+ * modified or unmodified, in source code or in binary form.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "rtl/axiLogWriter.hh"
+
+#include <zlib.h>
+
+#include <algorithm>
+
+#include "base/logging.hh"
+
+namespace gem5
+{
+
+const uint32_t AxiLogWriter::blockRecords;
+
+AxiLogWriter::AxiLogWriter(const std::string &_path, uint32_t id_nvdla,
+                           int _level, size_t _capacity)
+    : path(_path), level(_level), capacity(_capacity), offset(0),
+      spare(new uint64_t[_capacity]), pending(nullptr), pendingWords(0),
+      stop(false), failed(false)
+{
+    fatal_if(level < 0 || level > 9, "axilog compression level %d is not "
+             "a zlib level (0-9)\n", level);
+
+    log = std::fopen(path.c_str(), "wb");
+    fatal_if(!log, "Could not open axilog %s\n", path);
+    index = std::fopen((path + ".idx").c_str(), "wb");
+    fatal_if(!index, "Could not open axilog index %s.idx\n", path);
+
+    uint32_t header[2] = {id_nvdla, 0};
+    std::fwrite("AXILOGZ1", 1, 8, log);
+    std::fwrite(header, sizeof(header), 1, log);
+    std::fwrite("AXILOGI1", 1, 8, index);
+    offset = 8 + sizeof(header);
+
+    compressed.resize(compressBound(blockRecords * 16));
+    thread = std::thread([this]{ run(); });
+}
+
+AxiLogWriter::~AxiLogWriter()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        stop = true;
+    }
+    cv.notify_all();
+    thread.join();
+
+    delete [] spare;
+    std::fclose(log);
+    std::fclose(index);
+}
+
+uint64_t *
+AxiLogWriter::submit(uint64_t *buf, size_t words)
+{
+    panic_if(words > capacity, "axilog buffer overflow\n");
+    panic_if(words % 2, "axilog records are two words\n");
+
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [this]{ return spare != nullptr; });
+    fatal_if(failed, "Could not write axilog %s\n", path);
+
+    uint64_t *empty = spare;
+    spare = nullptr;
+    pending = buf;
+    pendingWords = words;
+    lock.unlock();
+    cv.notify_all();
+    return empty;
+}
+
+void
+AxiLogWriter::flush()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [this]{ return spare != nullptr; });
+    fatal_if(failed, "Could not write axilog %s\n", path);
+}
+
+void
+AxiLogWriter::run()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        cv.wait(lock, [this]{ return pending || stop; });
+        if (!pending)
+            return;
+
+        uint64_t *buf = pending;
+        size_t words = pendingWords;
+        pending = nullptr;
+        lock.unlock();
+
+        bool ok = writeBlocks(buf, words);
+
+        lock.lock();
+        failed = failed || !ok;
+        spare = buf;
+        cv.notify_all();
+    }
+}
+
+bool
+AxiLogWriter::writeBlocks(const uint64_t *buf, size_t words)
+{
+    for (size_t first = 0; first < words; first += 2 * blockRecords) {
+        size_t block_words = std::min(words - first, 2 * (size_t)blockRecords);
+        const uint64_t *block = buf + first;
+
+        uLongf comp_bytes = compressed.size();
+        uint32_t raw_bytes = block_words * sizeof(uint64_t);
+        if (compress2(compressed.data(), &comp_bytes,
+                      (const Bytef *)block, raw_bytes, level) != Z_OK)
+            return false;
+
+        uint32_t block_header[2] = {raw_bytes, (uint32_t)comp_bytes};
+        uint64_t entry[3] = {block[1] & 0xffffffff,
+                             block[block_words - 1] & 0xffffffff, offset};
+        uint32_t entry_sizes[2] = {(uint32_t)(block_words / 2),
+                                   (uint32_t)comp_bytes};
+
+        if (std::fwrite(block_header, sizeof(block_header), 1, log) != 1 ||
+            std::fwrite(compressed.data(), 1, comp_bytes, log) != comp_bytes ||
+            std::fwrite(entry, sizeof(entry), 1, index) != 1 ||
+            std::fwrite(entry_sizes, sizeof(entry_sizes), 1, index) != 1)
+            return false;
+        offset += sizeof(block_header) + comp_bytes;
+    }
+    return std::fflush(log) == 0 && std::fflush(index) == 0;
+}
+
+} // namespace gem5
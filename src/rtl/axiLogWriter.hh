@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2022 Barcelona Supercomputing Center
+ * All rights reserved.
+ *
+ * The license below extends only to copyright in the software and shall
+ * not be construed as granting a license to any other intellectual
+ * property including but not limited to intellectual property relating
+ * to a hardware implementation of the functionality of the software
+ * licensed hereunder.  You may use the software subject to the license
+ * terms below provided that you ensure that this notice is replicated
+ * unmodified and in its entirety in all distributions of the software,
+ * modified or unmodified, in source code or in binary form.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __RTL_AXI_LOG_WRITER_HH__
+#define __RTL_AXI_LOG_WRITER_HH__
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace gem5
+{
+
+/**
+ * Background writer of the AXI_RESP_FAST_IO log of one NVDLA. The model
+ * fills a print buffer of 16-byte records (see PRINT_16B in
+ * axiResponder.hh) and hands it over with submit(), getting an empty one
+ * back, while a host thread compresses and writes the previous one.
+ *
+ * The log is a header followed by blocks of at most blockRecords records,
+ * each one a zlib stream:
+ *
+ *   header: "AXILOGZ1", uint32 id of the NVDLA, uint32 0
+ *   block:  uint32 raw bytes, uint32 compressed bytes, compressed data
+ *
+ * Next to it, <path>.idx has the header "AXILOGI1" and one entry per
+ * block with the tick (low 32 bits of the second word of a record) of
+ * its first and last record, so that time windows can be read without
+ * decompressing the whole log:
+ *
+ *   entry:  uint64 first tick, uint64 last tick, uint64 offset of the
+ *           block in the log, uint32 records, uint32 compressed bytes
+ *
+ * All integers are little-endian.
+ */
+class AxiLogWriter
+{
+  public:
+    static const uint32_t blockRecords = 64 * 1024;
+
+    /**
+     * @param path log file, the index goes to path + ".idx"
+     * @param id_nvdla written to the header of the log
+     * @param level zlib level of the blocks, 0 stores them uncompressed
+     * @param capacity size in uint64_t of the print buffers exchanged
+     */
+    AxiLogWriter(const std::string &path, uint32_t id_nvdla, int level,
+                 size_t capacity);
+    ~AxiLogWriter();
+
+    /**
+     * Queue the first words of buf to be written and return an empty
+     * buffer of the same capacity. Only waits if the previous buffer is
+     * still being written. buf is owned by the writer afterwards.
+     */
+    uint64_t *submit(uint64_t *buf, size_t words);
+
+    /** Wait until everything submitted is in the files. */
+    void flush();
+
+  private:
+    const std::string path;
+    const int level;
+    const size_t capacity;
+
+    std::FILE *log;
+    std::FILE *index;
+    uint64_t offset;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    // buffer to hand out on the next submit, null while it is written
+    uint64_t *spare;
+    uint64_t *pending;
+    size_t pendingWords;
+    bool stop;
+    bool failed;
+
+    std::vector<uint8_t> compressed;
+    std::thread thread;
+
+    void run();
+    bool writeBlocks(const uint64_t *buf, size_t words);
+};
+
+} // namespace gem5
+
+#endif // __RTL_AXI_LOG_WRITER_HH__
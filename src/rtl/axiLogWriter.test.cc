@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2022 Barcelona Supercomputing Center
+ * All rights reserved.
+ *
+ * The license below extends only to copyright in the software and shall
+ * not be construed as granting a license to any other intellectual
+ * property including but not limited to intellectual property relating
+ * to a hardware implementation of the functionality of the software
+ * licensed hereunder.  You may use the software subject to the license
+ * terms below provided that you ensure that this notice is replicated
+ * unmodified and in its entirety in all distributions of the software,
+ * modified or unmodified, in source code or in binary form.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <gtest/gtest.h>
+#include <zlib.h>
+
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "rtl/axiLogWriter.hh"
+
+using namespace gem5;
+
+namespace
+{
+
+struct IndexEntry
+{
+    uint64_t firstTick;
+    uint64_t lastTick;
+    uint64_t offset;
+    uint32_t records;
+    uint32_t compBytes;
+};
+
+std::vector<uint8_t>
+readFile(const std::string &path)
+{
+    std::vector<uint8_t> data;
+    std::FILE *f = std::fopen(path.c_str(), "rb");
+    if (!f)
+        return data;
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = std::fread(buf, 1, sizeof(buf), f)) > 0)
+        data.insert(data.end(), buf, buf + n);
+    std::fclose(f);
+    return data;
+}
+
+/** Two words per record, the tick in the low 32 bits of the second one. */
+void
+makeRecords(std::vector<uint64_t> &words, size_t records, uint32_t &tick,
+            std::mt19937_64 &rng)
+{
+    for (size_t i = 0; i < records; i++) {
+        tick += rng() % 3;
+        words.push_back(rng() & 0xffffffffff);
+        words.push_back(((rng() % 10) << 56) | tick);
+    }
+}
+
+} // anonymous namespace
+
+/*
+ * Write the records in buffers of different sizes, including ones larger
+ * than a block, and read them back through the index.
+ */
+TEST(AxiLogWriterTest, RoundTrip)
+{
+    const std::string path = testing::TempDir() + "axilog_writer_test";
+    const size_t capacity = 3 * 2 * AxiLogWriter::blockRecords;
+    std::mt19937_64 rng(1);
+    uint32_t tick = 0;
+    std::vector<uint64_t> expected;
+
+    {
+        AxiLogWriter writer(path, 3, 1, capacity);
+        uint64_t *buf = new uint64_t[capacity];
+        for (size_t records : {10UL, (size_t)AxiLogWriter::blockRecords,
+                               2 * AxiLogWriter::blockRecords + 7UL, 0UL, 1UL}) {
+            std::vector<uint64_t> words;
+            makeRecords(words, records, tick, rng);
+            memcpy(buf, words.data(), words.size() * sizeof(uint64_t));
+            expected.insert(expected.end(), words.begin(), words.end());
+            buf = writer.submit(buf, words.size());
+        }
+        writer.flush();
+        delete [] buf;
+    }
+
+    std::vector<uint8_t> log = readFile(path);
+    std::vector<uint8_t> index = readFile(path + ".idx");
+    ASSERT_GE(log.size(), 16);
+    ASSERT_GE(index.size(), 8);
+    EXPECT_EQ(0, memcmp(log.data(), "AXILOGZ1", 8));
+    EXPECT_EQ(0, memcmp(index.data(), "AXILOGI1", 8));
+    uint32_t id;
+    memcpy(&id, log.data() + 8, 4);
+    EXPECT_EQ(3, id);
+
+    ASSERT_EQ(0, (index.size() - 8) % sizeof(IndexEntry));
+    std::vector<uint64_t> got;
+    for (size_t pos = 8; pos < index.size(); pos += sizeof(IndexEntry)) {
+        IndexEntry entry;
+        memcpy(&entry, index.data() + pos, sizeof(entry));
+        ASSERT_LE(entry.records, AxiLogWriter::blockRecords);
+
+        uint32_t sizes[2];
+        memcpy(sizes, log.data() + entry.offset, sizeof(sizes));
+        EXPECT_EQ(entry.records * 16, sizes[0]);
+        EXPECT_EQ(entry.compBytes, sizes[1]);
+
+        std::vector<uint64_t> block(entry.records * 2);
+        uLongf raw_bytes = sizes[0];
+        ASSERT_EQ(Z_OK, uncompress((Bytef *)block.data(), &raw_bytes,
+                                   log.data() + entry.offset + 8, sizes[1]));
+        ASSERT_EQ(sizes[0], raw_bytes);
+        EXPECT_EQ(entry.firstTick, block[1] & 0xffffffff);
+        EXPECT_EQ(entry.lastTick, block.back() & 0xffffffff);
+        got.insert(got.end(), block.begin(), block.end());
+    }
+    EXPECT_EQ(expected, got);
+
+    std::remove(path.c_str());
+    std::remove((path + ".idx").c_str());
+}
@@ -0,0 +1,252 @@
+/*
+ * Copyright (c) 2022 Barcelona Supercomputing Center
+ * All rights reserved.
+ *
+ * The license below extends only to copyright in the software and shall
+ * not be construed as granting a license to any other intellectual
+ * property including but not limited to intellectual property relating
+ * to a hardware implementation of the functionality of the software
+ * licensed hereunder.  You may use the software subject to the license
+ * terms below provided that you ensure that this notice is replicated
+ * unmodified and in its entirety in all distributions of the software,
+ * modified or unmodified, in source code or in binary form.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "embeddedBuffer.hh"
+#include "wrapper_nvdla.hh"
+
+/*
+ * Side-by-side replays of the set implementations of the embedded buffer.
+ * The sets report write-backs through the DMA write queue of their wrapper,
+ * which is drained after every operation so that each set gets its own
+ * sequence.
+ */
+
+namespace
+{
+
+const uint32_t LINE = 256;
+const uint32_t BEAT = AXI_WIDTH / 8;
+
+typedef std::vector<std::pair<uint64_t, std::vector<uint8_t>>> WriteBacks;
+
+class EmbeddedBufferTest : public testing::Test
+{
+  protected:
+    static Wrapper_nvdla *wr;
+
+    static void
+    SetUpTestSuite()
+    {
+        wr = new Wrapper_nvdla(0, 240, true, 1, LINE, 64, false, false,
+                               BUF_MODE_ALL, 8);
+    }
+
+    static void
+    TearDownTestSuite()
+    {
+        delete wr;
+        wr = nullptr;
+    }
+
+    // apply op to both sets, each one followed by taking its write-backs
+    template <typename Op>
+    void
+    both(abstractSet *sets[2], WriteBacks wb[2], Op op)
+    {
+        for (int k = 0; k < 2; k++) {
+            wb[k].clear();
+            op(sets[k], k);
+            auto &queue = wr->output.dma_write_buffer;
+            while (!queue.empty()) {
+                wb[k].push_back(queue.front());
+                queue.pop();
+            }
+        }
+    }
+
+    void replay(abstractSet *sets[2], uint32_t assoc, uint32_t ops,
+                uint64_t seed, bool dirty_fills);
+};
+
+Wrapper_nvdla *EmbeddedBufferTest::wr = nullptr;
+
+} // anonymous namespace
+
+/*
+ * The same stream of demand reads (filling the line on a miss), masked
+ * writes, line reads and flushes, applied to two sets. Every read has to
+ * hit or miss the same way and return the same data, and every op has to
+ * write back the same (dirty victim) lines. Line reads only target clean
+ * lines, as in a prefetchBuffer. With dirty_fills, every filled line is
+ * written right away, so that every victim shows up as a write-back.
+ */
+void
+EmbeddedBufferTest::replay(abstractSet *sets[2], uint32_t assoc,
+                           uint32_t ops, uint64_t seed, bool dirty_fills)
+{
+    std::mt19937_64 rng(seed);
+    const uint64_t base = 0x80000000;
+    const uint32_t num_lines = 3 * assoc + 1;
+    std::vector<bool> dirty(num_lines, false);
+    std::vector<uint8_t> line(LINE), data(BEAT);
+    std::vector<uint8_t> beat[2] = {std::vector<uint8_t>(BEAT),
+                                    std::vector<uint8_t>(BEAT)};
+    std::vector<uint8_t> read_line[2];
+    bool hit[2];
+    WriteBacks wb[2];
+
+    for (uint32_t i = 0; i < ops; i++) {
+        uint32_t l = rng() % num_lines;
+        uint64_t addr = base + (uint64_t)l * LINE;
+        uint64_t beat_addr = addr + BEAT * (rng() % (LINE / BEAT));
+        uint32_t op = rng() % 16;
+
+        if (op < 8) {
+            both(sets, wb, [&](abstractSet *set, int k) {
+                hit[k] = set->read_spm_axi_line(beat_addr, beat[k].data());
+            });
+            ASSERT_EQ(hit[0], hit[1]) << "op " << i;
+            if (hit[0]) {
+                ASSERT_EQ(beat[0], beat[1]) << "op " << i;
+            } else {
+                for (auto &byte : line)
+                    byte = rng();
+                both(sets, wb, [&](abstractSet *set, int k) {
+                    set->fill_spm_line(addr, line.data());
+                    if (dirty_fills)
+                        set->write_spm_axi_line_with_mask(beat_addr,
+                                                          line.data(), 1);
+                });
+                dirty[l] = dirty_fills;
+            }
+        } else if (op < 13) {
+            for (auto &byte : data)
+                byte = rng();
+            uint64_t mask = rng();
+            both(sets, wb, [&](abstractSet *set, int k) {
+                set->write_spm_axi_line_with_mask(beat_addr, data.data(),
+                                                  mask);
+            });
+            dirty[l] = true;
+        } else if (op < 15) {
+            if (dirty[l])
+                continue;
+            both(sets, wb, [&](abstractSet *set, int k) {
+                hit[k] = set->read_spm_line(addr, read_line[k]);
+            });
+            ASSERT_EQ(hit[0], hit[1]) << "op " << i;
+            if (hit[0])
+                ASSERT_EQ(read_line[0], read_line[1]) << "op " << i;
+        } else if (rng() % 8 == 0) {
+            both(sets, wb, [&](abstractSet *set, int k) {
+                set->clear_and_write_back_dirty();
+            });
+            std::fill(dirty.begin(), dirty.end(), false);
+        }
+
+        ASSERT_EQ(wb[0], wb[1]) << "op " << i;
+        ASSERT_EQ(sets[0]->size(), sets[1]->size()) << "op " << i;
+    }
+}
+
+// the ways are scanned with SIMD up to 32 and found through an index above
+TEST_F(EmbeddedBufferTest, FlatMatchesAllBufferSet)
+{
+    for (uint32_t assoc : {1u, 2u, 3u, 4u, 8u, 16u, 31u, 32u, 33u, 64u, 256u}) {
+        SCOPED_TRACE(testing::Message() << "assoc " << assoc);
+        allBufferSet all(wr, 1, LINE, assoc);
+        flatBufferSet flat(wr, 1, LINE, assoc);
+        abstractSet *sets[2] = {&all, &flat};
+        replay(sets, assoc, 20000, assoc, false);
+    }
+}
+
+namespace
+{
+
+// LRU through the replacement policy hook, by last touch or insert
+class HookLRU : public spmReplacementPolicy
+{
+  private:
+    std::vector<uint64_t> last_use;
+    const uint32_t assoc;
+    uint64_t clock = 0;
+
+  public:
+    HookLRU(uint32_t num_sets, uint32_t _assoc)
+        : last_use((uint64_t)num_sets * _assoc, 0), assoc(_assoc)
+    {}
+
+    void
+    touch(uint32_t set_id, uint32_t way, uint64_t addr) override
+    {
+        last_use[(uint64_t)set_id * assoc + way] = ++clock;
+    }
+
+    void
+    reset(uint32_t set_id, uint32_t way, uint64_t addr) override
+    {
+        last_use[(uint64_t)set_id * assoc + way] = ++clock;
+    }
+
+    void
+    invalidate(uint32_t set_id, uint32_t way) override
+    {
+        last_use[(uint64_t)set_id * assoc + way] = 0;
+    }
+
+    uint32_t
+    get_victim(uint32_t set_id) override
+    {
+        auto first = last_use.begin() + (uint64_t)set_id * assoc;
+        return std::min_element(first, first + assoc) - first;
+    }
+};
+
+} // anonymous namespace
+
+// an LRU driven through the hook evicts the same lines as lru_order
+TEST_F(EmbeddedBufferTest, LRUHookMatchesLRUOrder)
+{
+    for (uint32_t assoc : {1u, 2u, 4u, 8u, 16u, 64u}) {
+        SCOPED_TRACE(testing::Message() << "assoc " << assoc);
+        HookLRU lru(1, assoc);
+        allBufferSet builtin(wr, 1, LINE, assoc);
+        allBufferSet hooked(wr, 1, LINE, assoc, &lru, 0);
+        abstractSet *sets[2] = {&builtin, &hooked};
+        replay(sets, assoc, 20000, assoc, true);
+    }
+}
@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2022 Barcelona Supercomputing Center
+ * All rights reserved.
+ *
+ * The license below extends only to copyright in the software and shall
+ * not be construed as granting a license to any other intellectual
+ * property including but not limited to intellectual property relating
+ * to a hardware implementation of the functionality of the software
+ * licensed hereunder.  You may use the software subject to the license
+ * terms below provided that you ensure that this notice is replicated
+ * unmodified and in its entirety in all distributions of the software,
+ * modified or unmodified, in source code or in binary form.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "inflightRing.hh"
+
+namespace
+{
+
+struct Txn
+{
+    uint32_t beat;
+};
+
+// handles of the live txns in issue order
+std::vector<uint64_t>
+liveHandles(inflightRing<Txn> &ring)
+{
+    std::vector<uint64_t> handles;
+    for (uint64_t h = ring.front(); h != ring.end(); h = ring.next(h))
+        handles.push_back(h);
+    return handles;
+}
+
+} // anonymous namespace
+
+TEST(InflightRingTest, IssueOrder)
+{
+    inflightRing<Txn> ring(8);
+    std::vector<uint64_t> h;
+    for (uint32_t i = 0; i < 5; i++)
+        h.push_back(ring.push(0x1000 + i * 64, Txn{i}));
+    EXPECT_EQ(ring.size(), 5u);
+    EXPECT_EQ(liveHandles(ring), h);
+
+    // retiring out of order leaves holes that iteration skips
+    ring.retire(h[1]);
+    ring.retire(h[3]);
+    EXPECT_EQ(liveHandles(ring), (std::vector<uint64_t>{h[0], h[2], h[4]}));
+    EXPECT_EQ(ring.front(), h[0]);
+
+    // the head passes the holes once the oldest txn retires
+    ring.retire(h[0]);
+    EXPECT_EQ(ring.front(), h[2]);
+    EXPECT_EQ(ring.at(h[2]).beat, 2u);
+    EXPECT_EQ(ring.addr_of(h[4]), 0x1100u);
+
+    ring.retire(h[2]);
+    ring.retire(h[4]);
+    EXPECT_TRUE(ring.empty());
+    EXPECT_EQ(ring.front(), ring.end());
+}
+
+TEST(InflightRingTest, SameAddressChain)
+{
+    inflightRing<Txn> ring(8);
+    const uint64_t none = inflightRing<Txn>::NONE;
+    uint64_t a = ring.push(0x40, Txn{0});
+    uint64_t b = ring.push(0x80, Txn{1});
+    uint64_t c = ring.push(0x40, Txn{2});
+    uint64_t d = ring.push(0x40, Txn{3});
+
+    // txns to the same address are found oldest first
+    EXPECT_EQ(ring.find(0x40), a);
+    EXPECT_EQ(ring.next_same(a), c);
+    EXPECT_EQ(ring.next_same(c), d);
+    EXPECT_EQ(ring.next_same(d), none);
+    EXPECT_EQ(ring.find(0x80), b);
+    EXPECT_EQ(ring.find(0xc0), none);
+
+    // retiring from the middle of a chain keeps the rest linked
+    ring.retire(c);
+    EXPECT_EQ(ring.next_same(a), d);
+    ring.retire(a);
+    EXPECT_EQ(ring.find(0x40), d);
+    ring.retire(d);
+    EXPECT_EQ(ring.find(0x40), none);
+
+    // and appending after the chain became empty starts a new one
+    uint64_t e = ring.push(0x40, Txn{4});
+    EXPECT_EQ(ring.find(0x40), e);
+    EXPECT_EQ(ring.find(0x80), b);
+}
+
+// removing addresses from the open-addressing index must not lose the
+// others, whatever buckets they collided into
+TEST(InflightRingTest, IndexErase)
+{
+    inflightRing<Txn> ring(64);
+    std::vector<uint64_t> h;
+    for (uint32_t i = 0; i < 48; i++)
+        h.push_back(ring.push(0x80000000 + i * 4096, Txn{i}));
+    for (uint32_t i = 0; i < 48; i += 3)
+        ring.retire(h[i]);
+    for (uint32_t i = 0; i < 48; i++) {
+        uint64_t expected = (i % 3) ? h[i] : inflightRing<Txn>::NONE;
+        EXPECT_EQ(ring.find(0x80000000 + i * 4096), expected);
+    }
+}
+
+// the ring only allocates when the span from the oldest live txn exceeds
+// its capacity, which holes left behind an old txn count in
+TEST(InflightRingTest, Grows)
+{
+    inflightRing<Txn> ring(8);
+    EXPECT_EQ(ring.capacity(), 8u);
+
+    // steady traffic reuses the slots
+    for (uint32_t i = 0; i < 100; i++)
+        ring.retire(ring.push(0x40 * i, Txn{i}));
+    EXPECT_EQ(ring.grows(), 0u);
+
+    // prefetches retired behind an outstanding demand read
+    uint64_t demand = ring.push(0x10000, Txn{0});
+    for (uint32_t i = 0; i < 7; i++)
+        ring.retire(ring.push(0x20000 + 0x40 * i, Txn{i}));
+    EXPECT_EQ(ring.size(), 1u);
+    EXPECT_EQ(ring.grows(), 0u);
+
+    uint64_t pft = ring.push(0x30000, Txn{7});
+    EXPECT_EQ(ring.grows(), 1u);
+    EXPECT_EQ(ring.capacity(), 16u);
+
+    // the live txns and the index survive the growth
+    EXPECT_EQ(liveHandles(ring), (std::vector<uint64_t>{demand, pft}));
+    EXPECT_EQ(ring.find(0x10000), demand);
+    EXPECT_EQ(ring.find(0x30000), pft);
+    EXPECT_EQ(ring.at(pft).beat, 7u);
+}
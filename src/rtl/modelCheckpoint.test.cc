@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2022 Barcelona Supercomputing Center
+ * All rights reserved.
+ *
+ * The license below extends only to copyright in the software and shall
+ * not be construed as granting a license to any other intellectual
+ * property including but not limited to intellectual property relating
+ * to a hardware implementation of the functionality of the software
+ * licensed hereunder.  You may use the software subject to the license
+ * terms below provided that you ensure that this notice is replicated
+ * unmodified and in its entirety in all distributions of the software,
+ * modified or unmodified, in source code or in binary form.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <list>
+#include <map>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "inflightRing.hh"
+#include "modelCheckpoint.hh"
+
+namespace
+{
+
+struct Txn
+{
+    uint32_t beat;
+    uint8_t id;
+};
+
+} // anonymous namespace
+
+// live txns keep their handles and per-address order, holes left by
+// out-of-order retirement are skipped as before
+TEST(ModelCheckpointTest, InflightRingSaveRestore)
+{
+    inflightRing<Txn> ring(4);
+    std::vector<uint64_t> handles;
+    for (uint32_t i = 0; i < 10; i++)
+        handles.push_back(ring.push(0x1000 + (i % 3) * 64, Txn{i, (uint8_t)i}));
+    ring.retire(handles[0]);
+    ring.retire(handles[4]);
+
+    std::stringstream ss;
+    ring.save(ss);
+
+    inflightRing<Txn> restored(2);
+    restored.restore(ss);
+    ASSERT_TRUE(ss);
+
+    EXPECT_EQ(ring.size(), restored.size());
+    EXPECT_EQ(ring.front(), restored.front());
+    EXPECT_EQ(ring.end(), restored.end());
+    for (uint64_t h = ring.front(), r = restored.front(); h != ring.end();
+         h = ring.next(h), r = restored.next(r)) {
+        ASSERT_EQ(h, r);
+        EXPECT_EQ(ring.addr_of(h), restored.addr_of(r));
+        EXPECT_EQ(ring.at(h).beat, restored.at(r).beat);
+    }
+
+    // the chain of 0x1040 skips the retired handles[4]
+    uint64_t h = restored.find(0x1040);
+    EXPECT_EQ(h, handles[1]);
+    EXPECT_EQ(restored.next_same(h), handles[7]);
+
+    // and it keeps working like the original
+    restored.retire(handles[1]);
+    EXPECT_EQ(restored.find(0x1040), handles[7]);
+    EXPECT_EQ(restored.push(0x2000, Txn{10, 10}), ring.end());
+    EXPECT_EQ(restored.find(0x2000), ring.end());
+}
+
+TEST(ModelCheckpointTest, InflightRingRestoreEmpty)
+{
+    inflightRing<Txn> ring(8);
+    ring.retire(ring.push(0x40, Txn{0, 0}));
+
+    std::stringstream ss;
+    ring.save(ss);
+    inflightRing<Txn> restored(8);
+    restored.push(0x80, Txn{1, 1});
+    restored.restore(ss);
+
+    EXPECT_TRUE(restored.empty());
+    const uint64_t none = inflightRing<Txn>::NONE;
+    EXPECT_EQ(restored.find(0x80), none);
+    EXPECT_EQ(restored.push(0x40, Txn{2, 2}), 1u);
+}
+
+TEST(ModelCheckpointTest, Containers)
+{
+    std::map<uint64_t, std::vector<uint8_t>> ram = {{0x40, {1, 2, 3}},
+                                                    {0x80, {}}};
+    std::list<std::tuple<uint64_t, uint32_t, uint32_t>> log = {
+        std::make_tuple(0x100, 64, 0), std::make_tuple(0x200, 128, 64)};
+    std::string name = "dump.bin";
+
+    std::stringstream ss;
+    ckpt_save(ss, ram);
+    ckpt_save(ss, log);
+    ckpt_save(ss, name);
+
+    std::map<uint64_t, std::vector<uint8_t>> ram_r = {{0xc0, {4}}};
+    std::list<std::tuple<uint64_t, uint32_t, uint32_t>> log_r;
+    std::string name_r;
+    ckpt_restore(ss, ram_r);
+    ckpt_restore(ss, log_r);
+    ckpt_restore(ss, name_r);
+
+    ASSERT_TRUE(ss);
+    EXPECT_EQ(ram, ram_r);
+    EXPECT_EQ(log, log_r);
+    EXPECT_EQ(name, name_r);
+}
@@ -0,0 +1,355 @@
+/*
+ * Copyright (c) 2022 Barcelona Supercomputing Center
+ * All rights reserved.
+ *
+ * The license below extends only to copyright in the software and shall
+ * not be construed as granting a license to any other intellectual
+ * property including but not limited to intellectual property relating
+ * to a hardware implementation of the functionality of the software
+ * licensed hereunder.  You may use the software subject to the license
+ * terms below provided that you ensure that this notice is replicated
+ * unmodified and in its entirety in all distributions of the software,
+ * modified or unmodified, in source code or in binary form.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "rtl/replayNVDLA.hh"
+
+#include <algorithm>
+#include <cstring>
+
+#include "base/cast.hh"
+#include "base/intmath.hh"
+#include "base/logging.hh"
+#include "base/trace.hh"
+#include "debug/replayNVDLA.hh"
+#include "sim/sim_exit.hh"
+
+namespace gem5
+{
+
+replayNVDLA::replayNVDLA(const replayNVDLAParams &params) :
+    ClockedObject(params),
+    dramPort(params.name + ".dram_port", this),
+    sramPort(params.name + ".sram_port", this),
+    system(params.system),
+    requestorId(params.system->getRequestorId(this)),
+    exitWhenDone(params.exit_when_done),
+    traceFile(params.trace_file),
+    next(0),
+    nextSeq(0),
+    outstanding(0),
+    segment(0),
+    segmentStart(0),
+    lastIssue(0),
+    waitDep(ReplayRecord::noDep),
+    waitBarrier(false),
+    done(false),
+    readLatencySum(0),
+    readResponses(0),
+    recordedLatencySum(0),
+    recordedResponses(0),
+    replayEvent([this]{ replay(); }, params.name + ".replay"),
+    stats(this)
+{
+    uint32_t recorded_ratio;
+    fatal_if(!readReplayTrace(traceFile, idNVDLA, recorded_ratio, records),
+             "%s: %s is not a replay trace\n", name(), traceFile);
+    freqRatio = params.freq_ratio ? params.freq_ratio : recorded_ratio;
+    fatal_if(freqRatio == 0, "%s: freq_ratio has to be at least 1\n", name());
+
+    size_t reqs = std::count_if(records.begin(), records.end(),
+                                [](const ReplayRecord &rec)
+                                { return rec.isRequest(); });
+    requests.resize(reqs, ReplayRequest{0, MaxTick, 0});
+    for (const ReplayRecord &rec : records) {
+        fatal_if(rec.isRequest() && rec.dep != ReplayRecord::noDep &&
+                 rec.dep >= reqs, "%s: %s depends on request %lu of %lu\n",
+                 name(), traceFile, rec.dep, reqs);
+    }
+}
+
+Port &
+replayNVDLA::getPort(const std::string &if_name, PortID idx)
+{
+    if (if_name == "dram_port")
+        return dramPort;
+    else if (if_name == "sram_port")
+        return sramPort;
+    return ClockedObject::getPort(if_name, idx);
+}
+
+void
+replayNVDLA::init()
+{
+    ClockedObject::init();
+    fatal_if(!dramPort.isConnected(), "%s: dram_port is not connected\n",
+             name());
+}
+
+void
+replayNVDLA::startup()
+{
+    DPRINTF(replayNVDLA, "Replaying %lu records of NVDLA %d from %s\n",
+            records.size(), idNVDLA, traceFile);
+    segmentStart = clockEdge();
+    lastIssue = segmentStart;
+    schedule(replayEvent, segmentStart);
+}
+
+void
+replayNVDLA::replay()
+{
+    while (next < records.size()) {
+        const ReplayRecord &rec = records[next];
+
+        if (rec.flags & ReplayRecord::Response) {
+            stats.recordedReadLatency.sample(rec.gap);
+            recordedLatencySum += rec.gap;
+            recordedResponses++;
+            next++;
+            continue;
+        }
+
+        if (rec.flags & ReplayRecord::End) {
+            if (outstanding) {
+                waitBarrier = true;
+                return;
+            }
+            endSegment(rec.addr);
+            next++;
+            continue;
+        }
+
+        Tick ready;
+        if (rec.dep != ReplayRecord::noDep) {
+            const ReplayRequest &dep = requests[rec.dep];
+            if (dep.answered == MaxTick) {
+                waitDep = rec.dep;
+                return;
+            }
+            ready = std::max(lastIssue, dep.answered + rec.gap * period());
+        } else {
+            ready = lastIssue + rec.gap * period();
+        }
+
+        if (ready > curTick()) {
+            // skip the cycles the NVDLA would only be waiting
+            Cycles wait(divCeil(ready - curTick(), clockPeriod()));
+            schedule(replayEvent, clockEdge(wait));
+            return;
+        }
+
+        issue(rec);
+        next++;
+    }
+
+    if (outstanding) {
+        waitBarrier = true;
+        return;
+    }
+    finish();
+}
+
+void
+replayNVDLA::issue(const ReplayRecord &rec)
+{
+    uint64_t seq = nextSeq++;
+    ReplayRequest &req = requests[seq];
+    req.issued = curTick();
+    lastIssue = curTick();
+
+    bool write = rec.flags & ReplayRecord::Write;
+    bool sram = rec.flags & ReplayRecord::Sram;
+    fatal_if(sram && !sramPort.isConnected(), "%s: request to SRAM %#x but "
+             "sram_port is not connected\n", name(), rec.addr);
+    ReplayPort &port = sram ? sramPort : dramPort;
+
+    Request::Flags flags = 0;
+    if (rec.flags & ReplayRecord::Uncacheable)
+        flags.set(Request::UNCACHEABLE);
+
+    // the DMA engines go to memory one line at a time
+    unsigned chunk = (rec.flags & ReplayRecord::Dma) ?
+                     system->cacheLineSize() : rec.size;
+
+    DPRINTF(replayNVDLA, "Issue %s %lu: %#x size %d\n",
+            write ? "write" : "read", seq, rec.addr, rec.size);
+
+    for (unsigned offset = 0; offset < rec.size; offset += chunk) {
+        unsigned size = std::min(chunk, rec.size - offset);
+        RequestPtr mem_req = std::make_shared<Request>(rec.addr + offset,
+                                                       size, flags,
+                                                       requestorId);
+        PacketPtr pkt = write ? Packet::createWrite(mem_req) :
+                                Packet::createRead(mem_req);
+        pkt->allocate();
+        // the data is not recorded, writes store zeros
+        if (write)
+            std::memset(pkt->getPtr<uint8_t>(), 0, size);
+        pkt->pushSenderState(new ReplayState(seq));
+        req.packets++;
+        outstanding++;
+        port.send(pkt);
+    }
+
+    if (write) {
+        stats.writes++;
+        stats.writeBytes += rec.size;
+        if (rec.flags & ReplayRecord::Dma)
+            stats.dmaWrites++;
+    } else {
+        stats.reads++;
+        stats.readBytes += rec.size;
+        if (rec.flags & ReplayRecord::Dma)
+            stats.dmaReads++;
+    }
+}
+
+bool
+replayNVDLA::handleResponse(PacketPtr pkt)
+{
+    ReplayState *state = safe_cast<ReplayState *>(pkt->popSenderState());
+    uint64_t seq = state->seq;
+    bool read = pkt->isRead();
+    delete state;
+    delete pkt;
+
+    outstanding--;
+    ReplayRequest &req = requests[seq];
+    if (--req.packets == 0) {
+        req.answered = curTick();
+        if (read) {
+            uint64_t cycles = (curTick() - req.issued) / period();
+            stats.readLatency.sample(cycles);
+            readLatencySum += cycles;
+            readResponses++;
+        }
+        DPRINTF(replayNVDLA, "Response %lu after %lu ticks\n", seq,
+                curTick() - req.issued);
+        if (waitDep == seq) {
+            waitDep = ReplayRecord::noDep;
+            wake();
+        }
+    }
+    if (waitBarrier && !outstanding) {
+        waitBarrier = false;
+        wake();
+    }
+    return true;
+}
+
+void
+replayNVDLA::wake()
+{
+    if (!replayEvent.scheduled())
+        schedule(replayEvent, clockEdge());
+}
+
+void
+replayNVDLA::endSegment(uint64_t recorded)
+{
+    uint64_t cycles = (curTick() - segmentStart) / period();
+    stats.cycles += cycles;
+    stats.recordedCycles += recorded;
+    inform("%s: trace %d of NVDLA %d replayed in %lu NVDLA cycles, "
+           "%lu in the RTL run (%+.2f%%)\n", name(), segment, idNVDLA,
+           cycles, recorded,
+           recorded ? 100.0 * ((double)cycles - recorded) / recorded : 0.0);
+    segment++;
+    segmentStart = curTick();
+    lastIssue = curTick();
+}
+
+void
+replayNVDLA::finish()
+{
+    if (done)
+        return;
+    done = true;
+
+    double latency = readResponses ?
+        (double)readLatencySum / readResponses : 0.0;
+    double recorded = recordedResponses ?
+        (double)recordedLatencySum / recordedResponses : 0.0;
+    inform("%s: replay of %s done, %lu requests, mean read latency %.1f "
+           "NVDLA cycles, %.1f in the RTL run\n", name(), traceFile,
+           nextSeq, latency, recorded);
+
+    if (exitWhenDone)
+        exitSimLoop("replay done");
+}
+
+void
+replayNVDLA::ReplayPort::send(PacketPtr pkt)
+{
+    if (!blocked.empty() || !sendTimingReq(pkt))
+        blocked.push_back(pkt);
+}
+
+bool
+replayNVDLA::ReplayPort::recvTimingResp(PacketPtr pkt)
+{
+    return owner->handleResponse(pkt);
+}
+
+void
+replayNVDLA::ReplayPort::recvReqRetry()
+{
+    while (!blocked.empty() && sendTimingReq(blocked.front()))
+        blocked.pop_front();
+}
+
+replayNVDLA::ReplayStats::ReplayStats(replayNVDLA *parent)
+    : statistics::Group(parent),
+      ADD_STAT(reads, statistics::units::Count::get(),
+               "Read requests replayed, DMA line fills included"),
+      ADD_STAT(writes, statistics::units::Count::get(),
+               "Write requests replayed, DMA writes included"),
+      ADD_STAT(dmaReads, statistics::units::Count::get(),
+               "DMA line fills replayed"),
+      ADD_STAT(dmaWrites, statistics::units::Count::get(),
+               "DMA writes replayed"),
+      ADD_STAT(readBytes, statistics::units::Byte::get(),
+               "Bytes read"),
+      ADD_STAT(writeBytes, statistics::units::Byte::get(),
+               "Bytes written"),
+      ADD_STAT(readLatency, statistics::units::Cycle::get(),
+               "NVDLA cycles from a read to its data"),
+      ADD_STAT(recordedReadLatency, statistics::units::Cycle::get(),
+               "NVDLA cycles from a read to its data in the RTL run"),
+      ADD_STAT(cycles, statistics::units::Cycle::get(),
+               "NVDLA cycles the replayed traces took"),
+      ADD_STAT(recordedCycles, statistics::units::Cycle::get(),
+               "NVDLA cycles the traces took in the RTL run"),
+      ADD_STAT(cycleError, statistics::units::Ratio::get(),
+               "Relative error of cycles against recordedCycles",
+               (cycles - recordedCycles) / recordedCycles)
+{
+    readLatency.init(32).flags(statistics::pdf);
+    recordedReadLatency.init(32).flags(statistics::pdf);
+}
+
+} // namespace gem5
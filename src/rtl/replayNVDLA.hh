@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) 2022 Barcelona Supercomputing Center
+ * All rights reserved.
+ *
+ * The license below extends only to copyright in the software and shall
+ * not be construed as granting a license to any other intellectual
+ * property including but not limited to intellectual property relating
+ * to a hardware implementation of the functionality of the software
+ * licensed hereunder.  You may use the software subject to the license
+ * terms below provided that you ensure that this notice is replicated
+ * unmodified and in its entirety in all distributions of the software,
+ * modified or unmodified, in source code or in binary form.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __RTL_REPLAY_NVDLA_HH__
+#define __RTL_REPLAY_NVDLA_HH__
+
+#include <deque>
+#include <vector>
+
+#include "base/statistics.hh"
+#include "mem/packet.hh"
+#include "mem/port.hh"
+#include "params/replayNVDLA.hh"
+#include "rtl/replayTrace.hh"
+#include "sim/clocked_object.hh"
+#include "sim/system.hh"
+
+namespace gem5
+{
+
+/**
+ * Replays the memory traffic of an NVDLA recorded by rtlNVDLA with
+ * replay_trace, without the RTL. A request is issued its gap of NVDLA
+ * cycles after the response of the read it depends on arrives, or after
+ * the previous request if it depends on none, so the traffic follows
+ * the latencies of the memory system it is replayed on. Idle cycles are
+ * not simulated: the next request is scheduled on the cycle it is ready.
+ *
+ * The end of each recorded trace is a barrier: everything outstanding is
+ * waited for, and the NVDLA cycles of the replay are reported next to the
+ * ones recorded as a validation of the replay against the RTL run. DMA
+ * fills are split into cache lines and go through dram_port.
+ */
+class replayNVDLA : public ClockedObject
+{
+  private:
+    class ReplayPort : public RequestPort
+    {
+      private:
+        replayNVDLA *owner;
+        // packets waiting for a retry, in order
+        std::deque<PacketPtr> blocked;
+
+      public:
+        ReplayPort(const std::string &name, replayNVDLA *owner) :
+            RequestPort(name, owner), owner(owner)
+        { }
+
+        /** Send a timing request, or queue it while the port is blocked. */
+        void send(PacketPtr pkt);
+
+      protected:
+        bool recvTimingResp(PacketPtr pkt) override;
+        void recvReqRetry() override;
+    };
+
+    struct ReplayState : public Packet::SenderState
+    {
+        // number of the request in the trace
+        uint64_t seq;
+        ReplayState(uint64_t _seq) : seq(_seq) { }
+    };
+
+    struct ReplayRequest
+    {
+        Tick issued;
+        Tick answered;          // MaxTick until all its packets are back
+        uint32_t packets;       // packets without response
+    };
+
+    ReplayPort dramPort;
+    ReplayPort sramPort;
+    System *system;
+    const RequestorID requestorId;
+    const bool exitWhenDone;
+    const std::string traceFile;
+
+    uint32_t idNVDLA;
+    uint32_t freqRatio;
+    std::vector<ReplayRecord> records;
+    std::vector<ReplayRequest> requests;
+
+    size_t next;                // next record to replay
+    uint64_t nextSeq;           // number of the next request
+    uint32_t outstanding;       // packets without response
+    uint32_t segment;           // traces replayed
+    Tick segmentStart;
+    Tick lastIssue;
+    // request the next one waits for, noDep if none
+    uint64_t waitDep;
+    bool waitBarrier;
+    bool done;
+
+    // for the mean read latencies of the validation report
+    uint64_t readLatencySum;
+    uint64_t readResponses;
+    uint64_t recordedLatencySum;
+    uint64_t recordedResponses;
+
+    EventFunctionWrapper replayEvent;
+
+    // ticks of one NVDLA cycle
+    Tick period() const { return freqRatio * clockPeriod(); }
+
+    void replay();
+    void issue(const ReplayRecord &rec);
+    void endSegment(uint64_t recorded);
+    void finish();
+    void wake();
+    bool handleResponse(PacketPtr pkt);
+
+    struct ReplayStats : public statistics::Group
+    {
+        ReplayStats(replayNVDLA *parent);
+
+        statistics::Scalar reads;
+        statistics::Scalar writes;
+        statistics::Scalar dmaReads;
+        statistics::Scalar dmaWrites;
+        statistics::Scalar readBytes;
+        statistics::Scalar writeBytes;
+        statistics::Histogram readLatency;
+        statistics::Histogram recordedReadLatency;
+        statistics::Scalar cycles;
+        statistics::Scalar recordedCycles;
+        statistics::Formula cycleError;
+    } stats;
+
+  public:
+    replayNVDLA(const replayNVDLAParams &params);
+
+    Port &getPort(const std::string &if_name,
+                  PortID idx=InvalidPortID) override;
+
+    void init() override;
+    void startup() override;
+};
+
+} // namespace gem5
+
+#endif // __RTL_REPLAY_NVDLA_HH__
@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2022 Barcelona Supercomputing Center
+ * All rights reserved.
+ *
+ * The license below extends only to copyright in the software and shall
+ * not be construed as granting a license to any other intellectual
+ * property including but not limited to intellectual property relating
+ * to a hardware implementation of the functionality of the software
+ * licensed hereunder.  You may use the software subject to the license
+ * terms below provided that you ensure that this notice is replicated
+ * unmodified and in its entirety in all distributions of the software,
+ * modified or unmodified, in source code or in binary form.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "rtl/replayTrace.hh"
+
+#include <algorithm>
+#include <cstring>
+
+#include "base/logging.hh"
+
+namespace gem5
+{
+
+const uint64_t ReplayRecord::noDep;
+
+namespace
+{
+
+uint32_t
+cycles32(uint64_t cycles)
+{
+    return std::min(cycles, (uint64_t)UINT32_MAX);
+}
+
+} // anonymous namespace
+
+ReplayTraceWriter::ReplayTraceWriter(const std::string &path,
+                                     uint32_t id_nvdla, uint32_t freq_ratio)
+    : requests(0), start(0), lastIssue(0),
+      lastResp(ReplayRecord::noDep), lastRespCycle(0)
+{
+    file = std::fopen(path.c_str(), "wb");
+    fatal_if(!file, "Could not open replay trace %s\n", path);
+
+    uint32_t header[2] = {id_nvdla, freq_ratio};
+    std::fwrite("NVDLARP1", 1, 8, file);
+    std::fwrite(header, sizeof(header), 1, file);
+}
+
+ReplayTraceWriter::~ReplayTraceWriter()
+{
+    std::fclose(file);
+}
+
+void
+ReplayTraceWriter::write(const ReplayRecord &rec)
+{
+    std::fwrite(&rec, sizeof(rec), 1, file);
+}
+
+void
+ReplayTraceWriter::begin(uint64_t cycle)
+{
+    start = cycle;
+    lastIssue = cycle;
+    lastResp = ReplayRecord::noDep;
+    outstanding.clear();
+}
+
+uint64_t
+ReplayTraceWriter::request(uint64_t cycle, uint64_t addr, uint32_t size,
+                           uint32_t flags)
+{
+    ReplayRecord rec = {addr, lastResp, size, 0, flags, 0};
+    if (lastResp != ReplayRecord::noDep)
+        rec.gap = cycles32(cycle - lastRespCycle);
+    else
+        rec.gap = cycles32(cycle - lastIssue);
+    write(rec);
+
+    if (!(flags & ReplayRecord::Write))
+        outstanding[addr].emplace_back(requests, cycle);
+    lastIssue = cycle;
+    lastResp = ReplayRecord::noDep;
+    return requests++;
+}
+
+void
+ReplayTraceWriter::response(uint64_t cycle, uint64_t addr)
+{
+    auto it = outstanding.find(addr);
+    if (it == outstanding.end())
+        return;
+    uint64_t seq = it->second.front().first;
+    uint64_t issued = it->second.front().second;
+    it->second.pop_front();
+    if (it->second.empty())
+        outstanding.erase(it);
+
+    ReplayRecord rec = {addr, seq, 0, cycles32(cycle - issued),
+                        ReplayRecord::Response, 0};
+    write(rec);
+    lastResp = seq;
+    lastRespCycle = cycle;
+}
+
+void
+ReplayTraceWriter::end(uint64_t cycle)
+{
+    ReplayRecord rec = {cycle - start, ReplayRecord::noDep, 0, 0,
+                        ReplayRecord::End, 0};
+    write(rec);
+    std::fflush(file);
+    begin(cycle);
+}
+
+bool
+readReplayTrace(const std::string &path, uint32_t &id_nvdla,
+                uint32_t &freq_ratio, std::vector<ReplayRecord> &records)
+{
+    std::FILE *f = std::fopen(path.c_str(), "rb");
+    if (!f)
+        return false;
+
+    char magic[8];
+    uint32_t header[2];
+    if (std::fread(magic, 1, 8, f) != 8 ||
+        std::memcmp(magic, "NVDLARP1", 8) != 0 ||
+        std::fread(header, sizeof(header), 1, f) != 1) {
+        std::fclose(f);
+        return false;
+    }
+    id_nvdla = header[0];
+    freq_ratio = header[1];
+
+    records.clear();
+    ReplayRecord rec;
+    while (std::fread(&rec, sizeof(rec), 1, f) == 1)
+        records.push_back(rec);
+    std::fclose(f);
+    return true;
+}
+
+} // namespace gem5
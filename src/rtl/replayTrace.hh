@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2022 Barcelona Supercomputing Center
+ * All rights reserved.
+ *
+ * The license below extends only to copyright in the software and shall
+ * not be construed as granting a license to any other intellectual
+ * property including but not limited to intellectual property relating
+ * to a hardware implementation of the functionality of the software
+ * licensed hereunder.  You may use the software subject to the license
+ * terms below provided that you ensure that this notice is replicated
+ * unmodified and in its entirety in all distributions of the software,
+ * modified or unmodified, in source code or in binary form.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __RTL_REPLAY_TRACE_HH__
+#define __RTL_REPLAY_TRACE_HH__
+
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace gem5
+{
+
+/**
+ * One record of an NVDLA replay trace. The trace is a header followed by
+ * 32-byte records in the order the events happened:
+ *
+ *   header: "NVDLARP1", uint32 id of the NVDLA, uint32 freq_ratio
+ *
+ * Requests are numbered from 0 in the order they appear. A request
+ * depends on the read response that came back last before it was issued
+ * (dep is the number of that read) and is issued gap NVDLA cycles after
+ * it, or gap cycles after the previous request if no read came back in
+ * between (dep is noDep). A response record has the number of its read
+ * in dep and its latency in gap, for comparison only. An end record
+ * closes the run of a trace, its addr holds the NVDLA cycles it took.
+ *
+ * All integers are little-endian.
+ */
+struct ReplayRecord
+{
+    enum : uint32_t
+    {
+        Write = 0x1,
+        Sram = 0x2,             // cvsram interface instead of dbbif
+        Dma = 0x4,              // line fill of the DMA read engine
+        Uncacheable = 0x8,
+        Response = 0x10,
+        End = 0x20,
+    };
+
+    static const uint64_t noDep = ~0ULL;
+
+    uint64_t addr;
+    uint64_t dep;
+    uint32_t size;
+    uint32_t gap;
+    uint32_t flags;
+    uint32_t pad;
+
+    bool isRequest() const { return !(flags & (Response | End)); }
+};
+
+static_assert(sizeof(ReplayRecord) == 32, "replay records are 32 bytes");
+
+/**
+ * Records the memory traffic of one NVDLA as a replay trace. Cycles are
+ * NVDLA cycles; read responses are matched to the oldest read of the
+ * same address.
+ */
+class ReplayTraceWriter
+{
+  public:
+    ReplayTraceWriter(const std::string &path, uint32_t id_nvdla,
+                      uint32_t freq_ratio);
+    ~ReplayTraceWriter();
+
+    /** A trace starts running, nothing of the previous one gates it. */
+    void begin(uint64_t cycle);
+
+    /** Record a request and return its number. */
+    uint64_t request(uint64_t cycle, uint64_t addr, uint32_t size,
+                     uint32_t flags);
+
+    /** The data of the oldest read of addr is back. */
+    void response(uint64_t cycle, uint64_t addr);
+
+    /** The trace is done. */
+    void end(uint64_t cycle);
+
+  private:
+    std::FILE *file;
+    uint64_t requests;
+    uint64_t start;
+    uint64_t lastIssue;
+    // last read response not seen by a request yet, noDep if none
+    uint64_t lastResp;
+    uint64_t lastRespCycle;
+    // reads without response by address: number and issue cycle
+    std::unordered_map<uint64_t,
+                       std::deque<std::pair<uint64_t, uint64_t>>> outstanding;
+
+    void write(const ReplayRecord &rec);
+};
+
+/**
+ * Read a whole replay trace, returns false if path cannot be read or is
+ * not a replay trace.
+ */
+bool readReplayTrace(const std::string &path, uint32_t &id_nvdla,
+                     uint32_t &freq_ratio, std::vector<ReplayRecord> &records);
+
+} // namespace gem5
+
+#endif // __RTL_REPLAY_TRACE_HH__
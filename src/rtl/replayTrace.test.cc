@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2022 Barcelona Supercomputing Center
+ * All rights reserved.
+ *
+ * The license below extends only to copyright in the software and shall
+ * not be construed as granting a license to any other intellectual
+ * property including but not limited to intellectual property relating
+ * to a hardware implementation of the functionality of the software
+ * licensed hereunder.  You may use the software subject to the license
+ * terms below provided that you ensure that this notice is replicated
+ * unmodified and in its entirety in all distributions of the software,
+ * modified or unmodified, in source code or in binary form.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "rtl/replayTrace.hh"
+
+using namespace gem5;
+
+TEST(ReplayTraceTest, Dependencies)
+{
+    const std::string path = testing::TempDir() + "replay_trace_test";
+    {
+        ReplayTraceWriter writer(path, 3, 2);
+        writer.begin(100);
+        EXPECT_EQ(writer.request(104, 0x1000, 64, 0), 0);
+        EXPECT_EQ(writer.request(104, 0x1040, 64, ReplayRecord::Sram), 1);
+        EXPECT_EQ(writer.request(110, 0x2000, 32, ReplayRecord::Write), 2);
+        // reads of the same address are answered in order
+        EXPECT_EQ(writer.request(111, 0x1000, 64, 0), 3);
+        writer.response(150, 0x1040);
+        writer.response(152, 0x1000);
+        EXPECT_EQ(writer.request(160, 0x3000, 1024, ReplayRecord::Dma), 4);
+        writer.response(170, 0x1000);
+        writer.response(180, 0x3000);
+        writer.end(200);
+    }
+
+    uint32_t id = 0, freq_ratio = 0;
+    std::vector<ReplayRecord> recs;
+    ASSERT_TRUE(readReplayTrace(path, id, freq_ratio, recs));
+    EXPECT_EQ(id, 3);
+    EXPECT_EQ(freq_ratio, 2);
+    ASSERT_EQ(recs.size(), 10);
+
+    const uint64_t none = ReplayRecord::noDep;
+
+    // gaps from the previous request while nothing came back
+    EXPECT_TRUE(recs[0].isRequest());
+    EXPECT_EQ(recs[0].dep, none);
+    EXPECT_EQ(recs[0].gap, 4);
+    EXPECT_EQ(recs[1].dep, none);
+    EXPECT_EQ(recs[1].gap, 0);
+    EXPECT_EQ(recs[1].flags, ReplayRecord::Sram);
+    EXPECT_EQ(recs[2].gap, 6);
+    EXPECT_EQ(recs[2].size, 32);
+    EXPECT_EQ(recs[3].gap, 1);
+
+    // responses carry their read and its latency
+    EXPECT_EQ(recs[4].flags, ReplayRecord::Response);
+    EXPECT_EQ(recs[4].dep, 1);
+    EXPECT_EQ(recs[4].gap, 46);
+    EXPECT_EQ(recs[5].dep, 0);
+    EXPECT_EQ(recs[5].gap, 48);
+
+    // the next request waits for the last response
+    EXPECT_EQ(recs[6].addr, 0x3000);
+    EXPECT_EQ(recs[6].dep, 0);
+    EXPECT_EQ(recs[6].gap, 8);
+
+    EXPECT_EQ(recs[7].dep, 3);
+    EXPECT_EQ(recs[7].gap, 59);
+    EXPECT_EQ(recs[8].dep, 4);
+    EXPECT_EQ(recs[8].gap, 20);
+
+    EXPECT_EQ(recs[9].flags, ReplayRecord::End);
+    EXPECT_EQ(recs[9].addr, 100);
+    std::remove(path.c_str());
+}
+
+TEST(ReplayTraceTest, NotATrace)
+{
+    const std::string path = testing::TempDir() + "replay_trace_bad";
+    std::FILE *f = std::fopen(path.c_str(), "wb");
+    ASSERT_NE(f, nullptr);
+    std::fputs("AXILOGZ1 is not a replay trace", f);
+    std::fclose(f);
+
+    uint32_t id, freq_ratio;
+    std::vector<ReplayRecord> recs;
+    EXPECT_FALSE(readReplayTrace(path, id, freq_ratio, recs));
+    EXPECT_FALSE(readReplayTrace(path + ".missing", id, freq_ratio, recs));
+    std::remove(path.c_str());
+}
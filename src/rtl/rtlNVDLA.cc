@@ -30,6 +30,15 @@
 
 #include "rtl/rtlNVDLA.hh"
 
+#include <fstream>
+
+#include "base/cast.hh"
+#include "base/intmath.hh"
+#include "mem/port_proxy.hh"
+#include "mem/translating_port_proxy.hh"
+#include "sim/sim_exit.hh"
+#include "sim/stats.hh"
+
 namespace gem5
 {
 
@@ -42,23 +51,79 @@ rtlNVDLA::rtlNVDLA(const rtlNVDLAParams &params) :
     dramPort(params.name + ".dram_port", this, false),
     dmaPort(this, params.system),
     bytesToRead(0),
-    bytesReaded(0),
     blocked(false),
+    traceActive(false),
     max_req_inflight(params.maxReq),
     freq_ratio(params.freq_ratio),
     id_nvdla(params.id_nvdla),
+    accel_index(params.accel_index < 0 ? params.id_nvdla : params.accel_index),
     baseAddrDRAM(params.base_addr_dram),
     baseAddrSRAM(params.base_addr_sram),
+    trace_fetch_depth(params.trace_fetch_depth),
+    trace_functional_load(params.trace_functional_load),
+    traceVaddr(0),
+    traceContext(0),
+    traceFetchBase(0),
+    traceFetchNext(0),
+    tracePageVaddr(0),
+    tracePagePaddr(0),
+    tracePageRequestor(0),
+    tracePageValid(false),
+    traceTranslating(false),
+    traceReadsInFlight(0),
+    traceLinesArrived(0),
+    traceCmdsLoaded(false),
+    nvdlaStarted(false),
+    functionalTraceEvent([this]{ loadTraceFunctional(); },
+                         params.name + ".functionalTrace"),
+    memStats(this, params),
+    tickEventQueue(params.tick_eventq_index ?
+                   getEventQueue(params.tick_eventq_index) : eventQueue()),
+    parallel_tick(tickEventQueue != eventQueue()),
+    idle_skip_threshold(params.idle_skip_threshold),
+    idle_cycles(0),
+    sleeping(false),
+    sleep_next_tick(0),
+    frozenTick(0),
+    drainEvent([this]{ drainPump(); }, params.name + ".drain"),
+    layersDone(0),
+    checkpoint_layer(params.checkpoint_layer),
+    packetPool(std::max(params.max_coalesce_bytes, (uint32_t)(AXI_WIDTH / 8))),
+    max_coalesce_bytes(params.max_coalesce_bytes),
+    coalesceData(params.max_coalesce_bytes),
+    coalesceMask((params.max_coalesce_bytes + 63) / 64),
     waiting_for_gem5_mem(0),
     flushing_spm(0),
     prefetch_enable(params.prefetch_enable),
     pft_threshold(params.pft_threshold),
+    dma_pft_threshold(params.dma_pft_threshold),
+    pft_lookahead(params.pft_lookahead),
+    pft_depth(params.pft_depth),
+    pft_max_bw(params.pft_max_bw),
     spm_latency(params.spm_latency),
     spm_line_size(params.spm_line_size),
     spm_line_num(params.spm_size / params.spm_line_size),
     dma_enable(params.dma_enable),
     use_fake_mem(params.use_fake_mem),
-    print_path(params.print_path) {
+    print_path(params.print_path),
+    bulk_load_mem(params.bulk_load_mem),
+    write_dump_files(params.write_dump_files),
+    verilator_threads(params.verilator_threads),
+    verilator_cpu_base(params.verilator_cpu_base),
+    fast_reset(params.fast_reset) {
+
+    fatal_if(verilator_threads != Wrapper_nvdla::vl_threads,
+             "%s asks for %d verilator threads but the linked NVDLA model "
+             "was verilated with %d (rebuild with NVDLA_VL_THREADS=%d and "
+             "make library_vcd_mt)\n", name(), verilator_threads,
+             Wrapper_nvdla::vl_threads, verilator_threads);
+
+    fatal_if(fast_reset > RESET_SNAPSHOT_CHECK, "%s: fast_reset %d is not a "
+             "reset mode (0-2)\n", name(), fast_reset);
+    fatal_if(fast_reset != RESET_FULL && !Wrapper_nvdla::vl_savable,
+             "%s: fast_reset restores the RTL state, the NVDLA model has to "
+             "be verilated with --savable (make VL_SAVABLE=1 and build with "
+             "NVDLA_VL_SAVABLE=1)\n", name());
 
     switch (params.buffer_mode) {
         case 0:
@@ -74,12 +139,48 @@ rtlNVDLA::rtlNVDLA(const rtlNVDLAParams &params) :
             assert(false);
     }
 
+    fatal_if(parallel_tick && params.use_shared_spm,
+             "%s: a shared SPM cannot be used when NVDLAs tick on their own "
+             "event queues\n", name());
+
+    // read data may still sit in the AXI_R_LATENCY pipe of the responders
+    fatal_if(idle_skip_threshold && dma_enable && idle_skip_threshold <= spm_latency,
+             "%s: idle_skip_threshold has to be larger than spm_latency\n", name());
+
+    fatal_if(trace_fetch_depth == 0, "%s: trace_fetch_depth has to be at least 1\n", name());
+
+    fatal_if(max_coalesce_bytes < AXI_WIDTH / 8 || !isPowerOf2(max_coalesce_bytes),
+             "%s: max_coalesce_bytes has to be a power of two of at least %d\n",
+             name(), AXI_WIDTH / 8);
+
     uint32_t temp_assoc;
     temp_assoc = (params.assoc == "full") ? 0xffffffff : std::stoi(params.assoc);
     assoc = (temp_assoc > spm_line_num) ? spm_line_num : temp_assoc;
     assert(assoc > 0);
+    flat_spm = params.flat_spm;
+
+    fatal_if(params.spm_replacement_policy && flat_spm,
+             "%s: flat_spm only implements LRU, it cannot be used with "
+             "spm_replacement_policy\n", name());
+    if (params.spm_replacement_policy && dma_enable) {
+        spmReplacement.reset(new SpmReplacement(params.spm_replacement_policy,
+                                                spm_line_num / assoc, assoc,
+                                                spm_line_size));
+    }
 
     initNVDLA(params.use_shared_spm);
+#ifdef AXI_RESP_FAST_IO
+    if (!print_path.empty()) {
+        axiLog.reset(new AxiLogWriter(print_path + "." + std::to_string(accel_index),
+                                      accel_index, params.axilog_compression,
+                                      PB_SIZE * 2));
+    }
+#endif
+    if (!params.replay_trace.empty()) {
+        replayLog.reset(new ReplayTraceWriter(
+            params.replay_trace + "." + std::to_string(accel_index),
+            accel_index, freq_ratio));
+    }
     startMemRegion = 0xC0000000;
     cyclesNVDLA = 0;
     std::cout << std::hex << "NVDLA " << id_nvdla
@@ -89,8 +190,10 @@ rtlNVDLA::rtlNVDLA(const rtlNVDLAParams &params) :
     memset(&input, 0, sizeof(inputNVDLA));
 
     if (dma_enable) {
-        dma_rd_engine = new DmaReadFifo(dmaPort, spm_line_size * spm_line_num,
-                                    spm_line_size, spm_line_num, Request::UNCACHEABLE);
+        unsigned channels = params.dma_read_channels ?
+                            params.dma_read_channels : spm_line_num;
+        dma_rd_engine = new DmaReadEngineNVDLA(this, dmaPort, spm_line_size,
+                                               channels, Request::UNCACHEABLE);
         dma_wr_engine = new DmaNvdla(dmaPort, true, spm_line_size * spm_line_num,
                                      spm_line_size, spm_line_num, Request::UNCACHEABLE);
     } else {
@@ -130,40 +233,171 @@ rtlNVDLA::getPort(const std::string &if_name, PortID idx) {
 bool
 rtlNVDLA::handleRequest(PacketPtr pkt) {
     // Here we have just received the start rtlNVDLA function
-    // we check if there is an outstanding call
-    // otherwise start getting the whole trace
-    if (blocked) {
-        // There is currently an outstanding request. Stall.
-        return false;
-    }
+    // queue the trace, it starts as soon as the previous ones are done
+    // (the CPU may be simulated on another event queue)
+    EventQueue::ScopedMigration migrate(eventQueue(), inParallelMode);
+    DPRINTF(rtlNVDLA, "Got request for size: %d, addr: %#x, %d queued\n",
+                        pkt->getSize(),
+                        pkt->req->getVaddr(),
+                        submitQueue.size());
 
-    blocked = true;
+    submitQueue.push_back({pkt->req->getVaddr(), pkt->getSize(),
+        pkt->req->hasContextId() ? pkt->req->contextId() : 0});
+    delete pkt;
 
-    DPRINTF(rtlNVDLA, "Got request for size: %d, addr: %#x\n",
-                        pkt->getSize(),
-                        pkt->req->getVaddr());
+    if (!traceActive)
+        startNextTrace();
+    return true;
+}
 
-    bytesToRead = pkt->getSize();   // it works as a counter
+void
+rtlNVDLA::startNextTrace() {
+    assert(!traceActive && !submitQueue.empty());
+    traceActive = true;
+    blocked = true;
+    stats.nvdla_traces++;
+
+    bytesToRead = submitQueue.front().size;
     trace->trace_and_rd_log_size = bytesToRead;
+    trace->reset_load();
+    traceData.resize(bytesToRead);
+    traceVaddr = submitQueue.front().vaddr;
+    traceContext = submitQueue.front().context;
+    submitQueue.pop_front();
+    traceCmdsLoaded = false;
+    nvdlaStarted = false;
+
+    if (trace_functional_load) {
+        // not from within the request, the CPU side may still look at blocked
+        schedule(functionalTraceEvent, clockEdge());
+        return;
+    }
 
-    ptrTrace = (char *) malloc(bytesToRead);
+    Addr line = system->cacheLineSize();
+    traceFetchBase = roundDown(traceVaddr, line);
+    traceFetchNext = traceFetchBase;
+    tracePageValid = false;
+    traceLineArrived.assign(divCeil(traceVaddr + bytesToRead - traceFetchBase, line), false);
+    traceLinesArrived = 0;
+    fetchTrace();
+}
 
-    startTranslate(pkt->req->getVaddr(), 0);
+void
+rtlNVDLA::fetchTrace() {
+    Addr line = system->cacheLineSize();
+    Addr end = traceFetchBase + traceLineArrived.size() * line;
+
+    // a blocked read counts as in flight, its response resumes fetching
+    while (traceFetchNext < end && traceReadsInFlight < trace_fetch_depth &&
+           !memPort.isBlocked()) {
+        Addr page_vaddr = roundDown(traceFetchNext, system->getPageBytes());
+        if (!tracePageValid || page_vaddr != tracePageVaddr) {
+            if (!traceTranslating) {
+                traceTranslating = true;
+                startTranslate(page_vaddr, traceContext);
+            }
+            return;
+        }
 
-    return true;
+        RequestPtr req = std::make_shared<Request>(
+            tracePagePaddr + (traceFetchNext - tracePageVaddr), line,
+            tracePageFlags, tracePageRequestor);
+        PacketPtr pkt = new Packet(req, MemCmd::ReadReq);
+        pkt->allocate();
+        pkt->pushSenderState(new TraceReadState(traceFetchNext - traceFetchBase));
+        traceFetchNext += line;
+        traceReadsInFlight++;
+        memPort.sendPacket(pkt);
+    }
+}
+
+void
+rtlNVDLA::loadTraceFunctional() {
+    TranslatingPortProxy proxy(system->threads[traceContext]);
+    proxy.readBlob(traceVaddr, traceData.data(), bytesToRead);
+    traceArrived(bytesToRead);
+}
+
+void
+rtlNVDLA::traceArrived(uint32_t avail) {
+    // once started, the model thread is consuming the commands loaded so far
+    EventQueue::ScopedMigration migrate(tickEventQueue,
+                                        inParallelMode && nvdlaStarted);
+    // hand the register commands that are complete to the trace loader
+    if (!traceCmdsLoaded) {
+        traceCmdsLoaded = trace->load(traceData.data(), avail);
+        if (traceCmdsLoaded) {
+            startBaseTrace = trace->getBaseAddr();
+            DPRINTF(rtlNVDLA, "Base Addr: %#x \n", startBaseTrace);
+        }
+    }
+
+    if (avail < bytesToRead) {
+        if (!nvdlaStarted && !prefetch_enable && !wr->csb->done())
+            startNVDLA();
+        return;
+    }
+
+    fatal_if(!traceCmdsLoaded, "%s: the trace has no end of commands (0xff)\n",
+             name());
+    // call load_read_var_log no matter prefetch enabled or not.
+    // If not, we will directly see 8 bytes of 0xff indicating the end of rd_var_log.
+    trace->load_read_var_log(traceData.data());
+    std::vector<char>().swap(traceData);
+    bytesToRead = 0;
+    if (!nvdlaStarted)
+        startNVDLA();
+
+    // the trace is now loaded, further requests of the CPU are queued
+    // until the NVDLA completes
+    blocked = false;
 }
 
 void
 rtlNVDLA::initNVDLA(bool use_shared_spm) {
-    // Wrapper
-    wr = new Wrapper_nvdla(id_nvdla, max_req_inflight,
+    // each accelerator of the system gets its own range of host cpus for
+    // the worker threads of its verilated model
+    int first_cpu = -1;
+    if (verilator_threads > 0 && verilator_cpu_base >= 0)
+        first_cpu = verilator_cpu_base + accel_index * verilator_threads;
+    // Wrapper, it tags the records of the axilog with the index
+    wr = new Wrapper_nvdla(accel_index, max_req_inflight,
         dma_enable, spm_latency, spm_line_size, spm_line_num,
-        prefetch_enable, use_shared_spm, buffer_mode, assoc);
+        prefetch_enable, use_shared_spm, buffer_mode, assoc, flat_spm,
+        spmReplacement.get(), first_cpu);
+    if (first_cpu >= 0 && !wr->vl_pinned)
+        warn("%s: could not pin the verilator threads to cpus %d-%d\n",
+             name(), first_cpu, first_cpu + verilator_threads - 1);
+    wr->stats_recorder = &memStats;
+    wr->pft_threshold = pft_threshold;
+    wr->dma_pft_threshold = dma_pft_threshold;
+    wr->pft_lookahead = pft_lookahead;
+    wr->pft_depth = pft_depth;
+    wr->pft_max_bw = pft_max_bw;
+    wr->reset_mode = (ResetMode)fast_reset;
     // wrapper trace from nvidia
     trace = new TraceLoaderGem5(wr->csb, wr->axi_dbb, wr->axi_cvsram);
+    trace->write_dump_files = write_dump_files;
+    if (bulk_load_mem) {
+        trace->bulk_load = [this](uint32_t addr, const uint8_t *buf,
+                                  uint32_t len, bool sram) {
+            loadMemBulk(addr, buf, len, sram);
+        };
+    }
     sim_time = time(nullptr);
 }
 
+void
+rtlNVDLA::loadMemBulk(uint32_t addr, const uint8_t *buf, uint32_t len, bool sram) {
+    // called by the trace loader, from the model thread
+    EventQueue::ScopedMigration migrate(eventQueue());
+    // caches on the way get their copies updated, but no lines allocated
+    RequestPort &port = sram ? static_cast<RequestPort &>(sramPort) : dramPort;
+    PortProxy proxy(port, system->cacheLineSize());
+    proxy.writeBlob(getRealAddr(addr, sram), buf, len);
+    DPRINTF(rtlNVDLA, "Loaded %d bytes to %#x\n", len, getRealAddr(addr, sram));
+}
+
 void
 rtlNVDLA::initRTLModel() {
 
@@ -174,41 +408,52 @@ rtlNVDLA::endRTLModel() {
 }
 
 void
-rtlNVDLA::loadTraceNVDLA(char *ptr) {
-    // load the trace into the queues
-    trace->load(ptr);
-    trace->load_read_var_log(ptr);  // call load_read_var_log no matter prefetch enabled or not.
-    // If not, we will directly see 8 bytes of 0xff indicating the end of rd_var_log.
-
-    startBaseTrace = trace->getBaseAddr();
-
-    DPRINTF(rtlNVDLA,
-            "Base Addr: %#x \n",
-            trace->getBaseAddr());
+rtlNVDLA::startNVDLA() {
+    nvdlaStarted = true;
     // reset NVDLA
     wr->init();
     // init some variable before exec of trace
     quiesc_timer = 200;
     waiting = 0;
+    layersDone = 0;
+    if (replayLog)
+        replayLog->begin(wr->tickcount);
 
-    schedule(tickEvent, nextCycle() + (freq_ratio - 1) * clockPeriod());
+    scheduleTick(nextCycle() + (freq_ratio - 1) * clockPeriod());
+}
+
+void
+rtlNVDLA::flushAxiLog() {
+    if (axiLog && wr->buf_ptr)
+        wr->print_buffer = axiLog->submit(wr->print_buffer, wr->buf_ptr);
+    wr->buf_ptr = 0;
+}
+
+void
+rtlNVDLA::scheduleTick(Tick when) {
+    // the model queue can only be read and scheduled on while holding it,
+    // and it may already be ahead within the current quantum
+    EventQueue::ScopedMigration migrate(tickEventQueue, inParallelMode);
+    tickEventQueue->schedule(&tickEvent,
+                             std::max(when, tickEventQueue->getCurTick()));
+}
+
+void
+rtlNVDLA::deliverResponses() {
+    while (!pending_resp.empty()) {
+        PacketPtr pkt = pending_resp.front().first;
+        bool sram = pending_resp.front().second;
+        pending_resp.pop();
+        if (pkt->isRead() && pkt->hasData())
+            deliverReadData(pkt, sram);
+        packetPool.recycle(pkt);
+    }
 }
 
 void
 rtlNVDLA::processOutput(outputNVDLA& out) {
     if (out.read_valid) {
-        while (!out.read_buffer.empty()) {
-            read_req_entry_t aux = out.read_buffer.front();
-            // printf("read req addr: %08x, size %d\n", aux.read_addr, aux.read_bytes);
-            // std::cout << std::hex << "read req: " \
-            // << aux.read_addr << std::endl;
-            readAXIVariable(aux.read_addr,
-                            aux.read_sram,
-                            aux.read_timing,
-                            aux.cacheable,
-                            aux.read_bytes);
-            out.read_buffer.pop();
-        }
+        issueReads(out);
     }
 
     if (out.write_valid) {
@@ -221,30 +466,30 @@ rtlNVDLA::processOutput(outputNVDLA& out) {
             out.write_buffer.pop();
         }
 
-        while (!out.long_write_buffer.empty()) { // this buffer outputs in 1-64 bytes granularity
-            auto& aux = out.long_write_buffer.front();
-            writeAXILong(aux.write_addr, aux.length, aux.write_data, aux.write_mask, aux.write_sram, aux.write_timing, aux.cacheable);
-            out.long_write_buffer.pop();
-        }
+        // this buffer outputs in 1-64 bytes granularity
+        issueLongWrites(out);
     }
 
     //! use dma_rd_engine to process reading requests
     // memory requests already in spm is dealt with in wrapper_nvdla
-    // only one DMA request can be tackled at once
-    if (!out.dma_read_buffer.empty()) {
+    // issue as many line fills as the engine has free channels, they are
+    // tagged with the spm address and may come back in any order
+    while (!out.dma_read_buffer.empty() && dma_rd_engine->canStartFill()) {
         auto& aux = out.dma_read_buffer.front();
 
         uint64_t real_addr = getRealAddr(aux.first, false);         // only DRAM has DMA fetch
-        if (dma_rd_engine->atEndOfBlock()) {
-            dma_rd_engine->startFill(real_addr, aux.second);
+        dma_rd_engine->startFill(real_addr, aux.second, nullptr, aux.first);
+        if (replayLog)
+            replayLog->request(wr->tickcount, real_addr, aux.second,
+                               ReplayRecord::Dma | ReplayRecord::Uncacheable);
 #ifndef AXI_RESP_FAST_IO
-            printf("(%lu) nvdla#%d DMA read req is issued: addr 0x%08lx, len %d\n", wr->tickcount, id_nvdla, aux.first, aux.second);
+        printf("(%lu) nvdla#%d DMA read req is issued: addr 0x%08lx, len %d\n", wr->tickcount, id_nvdla, aux.first, aux.second);
 #endif
-            // stats.num_dma_rd++;
-            // after successfully calling DMA, pop aux
-            out.dma_read_buffer.pop();
-        }   // if previous DMA request not sent, have to stop here
-    }
+        memStats.dma.reads++;
+        memStats.dma.readBytes += aux.second;
+        // after successfully calling DMA, pop aux
+        out.dma_read_buffer.pop();
+    }   // if no channel is free, the rest waits for the next cycle
 
 
     //! use dma_wr_engine to process writing requests
@@ -253,20 +498,93 @@ rtlNVDLA::processOutput(outputNVDLA& out) {
         if (dma_wr_engine->atEndOfBlock()) {                    // previous DMA write has been sent
             uint64_t real_addr = getRealAddr(aux.first, false);     // only DRAM has DMA write
             dma_wr_engine->startFill(real_addr, aux.second.size(), aux.second.data());
+            if (replayLog)
+                replayLog->request(wr->tickcount, real_addr, aux.second.size(),
+                                   ReplayRecord::Dma | ReplayRecord::Write |
+                                   ReplayRecord::Uncacheable);
 #ifndef AXI_RESP_FAST_IO
             printf("(%lu) nvdla#%d DMA write req is issued: addr 0x%08lx, len %ld\n", wr->tickcount, id_nvdla, aux.first, aux.second.size());
 #endif
-            // stats.num_dma_wr++;
-            out.dma_write_buffer.pop_front();
+            memStats.dma.writes++;
+            memStats.dma.writeBytes += aux.second.size();
+            memStats.write(aux.second.size());
+            out.dma_write_buffer.pop();
         }
     }
 }
 
+void
+rtlNVDLA::issueReads(outputNVDLA& out) {
+    while (!out.read_buffer.empty()) {
+        read_req_entry_t aux = out.read_buffer.front();
+        out.read_buffer.pop();
+        stats.nvdla_reads++;
+
+        // merge the following beats while they extend this one
+        uint32_t size = aux.read_bytes;
+        while (aux.read_timing && !out.read_buffer.empty()) {
+            read_req_entry_t& next = out.read_buffer.front();
+            if (next.read_addr != aux.read_addr + size || next.read_sram != aux.read_sram ||
+                !next.read_timing || next.cacheable != aux.cacheable ||
+                size + next.read_bytes > max_coalesce_bytes ||
+                aux.read_addr / max_coalesce_bytes != (next.read_addr + next.read_bytes - 1) / max_coalesce_bytes)
+                break;
+            size += next.read_bytes;
+            out.read_buffer.pop();
+            stats.nvdla_reads++;
+        }
+
+        readAXIVariable(aux.read_addr,
+                        aux.read_sram,
+                        aux.read_timing,
+                        aux.cacheable,
+                        size);
+    }
+}
+
+void
+rtlNVDLA::issueLongWrites(outputNVDLA& out) {
+    while (!out.long_write_buffer.empty()) {
+        long_write_req_entry_t& aux = out.long_write_buffer.front();
+        uint64_t addr = aux.write_addr;
+        bool sram = aux.write_sram;
+        bool timing = aux.write_timing;
+        bool cacheable = aux.cacheable;
+        uint32_t size = 0;
+        std::fill(coalesceMask.begin(), coalesceMask.end(), 0);
+
+        // stage contiguous beats in coalesceData, their byte enables in coalesceMask
+        do {
+            long_write_req_entry_t& beat = out.long_write_buffer.front();
+            memcpy(&coalesceData[size], beat.write_data, beat.length);
+            for (uint32_t i = 0; i < beat.length; i++) {
+                if ((beat.write_mask >> i) & 1)
+                    coalesceMask[(size + i) / 64] |= 1ULL << ((size + i) % 64);
+            }
+            size += beat.length;
+            out.long_write_buffer.pop();
+            stats.nvdla_writes++;
+
+            if (!timing || out.long_write_buffer.empty())
+                break;
+            long_write_req_entry_t& next = out.long_write_buffer.front();
+            if (next.write_addr != addr + size || next.write_sram != sram ||
+                !next.write_timing || next.cacheable != cacheable ||
+                size + next.length > max_coalesce_bytes ||
+                addr / max_coalesce_bytes != (next.write_addr + next.length - 1) / max_coalesce_bytes)
+                break;
+        } while (true);
+
+        writeAXILong(addr, size, coalesceData.data(), coalesceMask.data(), sram, timing, cacheable);
+    }
+}
+
 void
 rtlNVDLA::runIterationNVDLA() {
     wr->clearOutput();
 
     int extevent;
+    bool layer_done = false;
 
     if (!waiting_for_gem5_mem)
         extevent = wr->csb->eval(waiting);
@@ -292,6 +610,8 @@ rtlNVDLA::runIterationNVDLA() {
         printf("(%lu) nvdla#%d interrupt!\n", wr->tickcount, id_nvdla);
 #endif
         waiting = 0;
+        layersDone++;
+        layer_done = true;
     }
 
     if (!waiting_for_gem5_mem) {
@@ -306,9 +626,18 @@ rtlNVDLA::runIterationNVDLA() {
 
     outputNVDLA& output = wr->tick();
 
+    // from here on we talk to gem5, which lives on eventQueue()
+    EventQueue::ScopedMigration migrate(eventQueue());
+    deliverResponses();
+
+    if (layer_done && layersDone == checkpoint_layer) {
+        DPRINTF(rtlNVDLA, "Layer %d done, exiting to checkpoint\n", layersDone);
+        exitSimLoop("checkpoint");
+    }
+
     if (dma_enable) {
         try_get_dma_read_data(spm_line_size);
-        if (wr->csb->done()) {
+        if (csbDone()) {
             // write back dirty data in spm to main memory
             if (!flushing_spm) {
                 wr->spm->clear_and_write_back_dirty();
@@ -323,31 +652,42 @@ rtlNVDLA::runIterationNVDLA() {
     processOutput(output);
 
 #ifdef AXI_RESP_FAST_IO
-    if (Wrapper_nvdla::buf_ptr >= PB_SIZE) {
-        std::ofstream fout;
-        fout.open(print_path, std::ios::out | std::ios::app | std::ios::binary);
-        fout.write((char*)Wrapper_nvdla::print_buffer, Wrapper_nvdla::buf_ptr * sizeof(uint64_t));
-        fout.close();
-        Wrapper_nvdla::buf_ptr = 0;
-    }
+    if (wr->buf_ptr >= PB_SIZE)
+        flushAxiLog();
 #endif
 }
 
 void
 rtlNVDLA::tick() {
     DPRINTF(rtlNVDLADebug, "Tick NVDLA \n");
+    if (drainState() == DrainState::Draining) {
+        // freeze the RTL on this cycle until drainResume()
+        frozenTick = curTick();
+        EventQueue::ScopedMigration migrate(eventQueue());
+        if (!drainEvent.scheduled())
+            schedule(drainEvent, clockEdge());
+        return;
+    }
     // if we are still running trace
     // runIteration
     // schedule new iteration
-    if (!wr->csb->done() || (quiesc_timer-- > 0) || waiting_for_gem5_mem || flushing_spm) {
+    bool running = !csbDone() || (quiesc_timer-- > 0) || waiting_for_gem5_mem || flushing_spm;
+    if (running) {
         // Update stats
-        // stats.nvdla_avgReqCVSRAM.sample(wr->axi_cvsram->getRequestsOnFlight());
+        stats.nvdla_avgReqCVSRAM.sample(wr->axi_cvsram->getRequestsOnFlight());
         stats.nvdla_avgReqDBBIF.sample(wr->axi_dbb->getRequestsOnFlight());
         stats.nvdla_cycles++;
         cyclesNVDLA++;
         runIterationNVDLA();
-        schedule(tickEvent, nextCycle() + (freq_ratio - 1) * clockPeriod());
+        if (idle_skip_threshold && !csbDone() && !waiting_for_gem5_mem &&
+            !flushing_spm && wr->stalledOnMemory(waiting)) {
+            idle_cycles++;
+        } else {
+            idle_cycles = 0;
+        }
     } else {
+        EventQueue::ScopedMigration migrate(eventQueue());
+
         // we have finished running the trace
         printf("done at %lu ticks\n", wr->tickcount);
         printf("simulation time: %lu seconds\n", time(nullptr) - sim_time);
@@ -362,14 +702,13 @@ rtlNVDLA::tick() {
         }
 
 #ifdef AXI_RESP_FAST_IO
-        if (Wrapper_nvdla::buf_ptr != 0) {
-            std::ofstream fout;
-            fout.open(print_path, std::ios::out | std::ios::app | std::ios::binary);
-            fout.write((char*)Wrapper_nvdla::print_buffer, Wrapper_nvdla::buf_ptr * sizeof(uint64_t));
-            fout.close();
-            Wrapper_nvdla::buf_ptr = 0;
-        }
+        flushAxiLog();
+        // the log of this trace is complete once the NVDLA reports it is done
+        if (axiLog)
+            axiLog->flush();
 #endif
+        if (replayLog)
+            replayLog->end(wr->tickcount);
 
         // we send a null packet telling we have finished
         RequestPtr req = std::make_shared<Request>(id_nvdla, 1,
@@ -380,71 +719,305 @@ rtlNVDLA::tick() {
         packet->allocate();
         packet->makeResponse();
         cpuPort.sendPacket(packet);
+
+        traceActive = false;
+        if (!submitQueue.empty()) {
+            // no round trip through the CPU for the next trace
+            DPRINTF(rtlNVDLA, "Starting the next of %d queued traces\n",
+                    submitQueue.size());
+            stats.nvdla_queued_starts++;
+            startNextTrace();
+        }
     }
+    Tick next_tick = nextCycle() + (freq_ratio - 1) * clockPeriod();
     // check DRAM Ports
+    {
+        EventQueue::ScopedMigration migrate(eventQueue());
+        dramPort.tick();
+        sramPort.tick();
+
+        // decide while holding the device queue, so that a response
+        // arriving right now either is seen here or sees sleeping set
+        if (running && idle_cycles >= idle_skip_threshold && idle_skip_threshold &&
+            dramPort.pending_req.empty() && sramPort.pending_req.empty() &&
+            pending_resp.empty()) {
+            sleeping = true;
+            sleep_next_tick = next_tick;
+            running = false;
+        }
+    }
+    if (running)
+        scheduleTick(next_tick);
+}
+
+void
+rtlNVDLA::wakeUp() {
+    // the cycle accounting belongs to the model thread, responses of the
+    // device queue wait until it is done with its current cycle
+    EventQueue::ScopedMigration migrate(tickEventQueue, inParallelMode);
+    if (!sleeping)
+        return;
+    sleeping = false;
+    idle_cycles = 0;
+
+    // account the cycles we did not evaluate as if the RTL was ticking
+    Tick period = freq_ratio * clockPeriod();
+    Tick when = sleep_next_tick;
+    uint64_t skipped = 0;
+    if (curTick() > when) {
+        skipped = (curTick() - when + period - 1) / period;
+        when += skipped * period;
+    }
+    stats.nvdla_cycles += skipped;
+    stats.nvdla_skipped_cycles += skipped;
+    stats.nvdla_avgReqCVSRAM.sample(wr->axi_cvsram->getRequestsOnFlight(), skipped);
+    stats.nvdla_avgReqDBBIF.sample(wr->axi_dbb->getRequestsOnFlight(), skipped);
+    cyclesNVDLA += skipped;
+    wr->tickcount += skipped;
+
+    DPRINTF(rtlNVDLADebug, "Wake up after skipping %lu cycles\n", skipped);
+    scheduleTick(when);
+}
+
+bool
+rtlNVDLA::memoryIdle() const {
+    if (bytesToRead || traceReadsInFlight || traceTranslating ||
+        functionalTraceEvent.scheduled())
+        return false;
+    if (dramPort.inflight || sramPort.inflight || !pending_resp.empty())
+        return false;
+    // the DMA engine drains by itself, but its fills have to reach the model
+    return !dma_rd_engine ||
+           (!dma_rd_engine->hasPending() && !dma_rd_engine->hasCompleted());
+}
+
+DrainState
+rtlNVDLA::drain() {
+    // a sleeping NVDLA is woken up so that its tick freezes it like the others
+    if (sleeping)
+        wakeUp();
+    if (tickEvent.scheduled() || !memoryIdle()) {
+        if (!drainEvent.scheduled())
+            schedule(drainEvent, clockEdge());
+        return DrainState::Draining;
+    }
+#ifdef AXI_RESP_FAST_IO
+    flushAxiLog();
+#endif
+    return DrainState::Drained;
+}
+
+void
+rtlNVDLA::drainPump() {
+    // what the frozen RTL would do with memory each cycle, without evaluating it
+    deliverResponses();
+    if (dma_enable)
+        try_get_dma_read_data(spm_line_size);
     dramPort.tick();
     sramPort.tick();
+
+    if (tickEvent.scheduled() || !memoryIdle()) {
+        schedule(drainEvent, nextCycle());
+        return;
+    }
+#ifdef AXI_RESP_FAST_IO
+    // fills handed over while draining are logged too
+    flushAxiLog();
+#endif
+    DPRINTF(rtlNVDLA, "Drained, RTL frozen at %lu\n", frozenTick);
+    signalDrainDone();
 }
 
+void
+rtlNVDLA::drainResume() {
+    if (!frozenTick)
+        return;
+    // continue on the cycle grid the RTL was ticking on
+    Tick period = freq_ratio * clockPeriod();
+    Tick when = frozenTick;
+    if (curTick() > when)
+        when += divCeil(curTick() - when, period) * period;
+    frozenTick = 0;
+    scheduleTick(when);
+}
 
-bool
-rtlNVDLA::handleResponse(PacketPtr pkt) {
-    if (pkt->hasData()) {
-        char *data_ptr = pkt->getPtr<char>();
+void
+rtlNVDLA::serialize(CheckpointOut &cp) const {
+    SERIALIZE_SCALAR(nvdlaStarted);
+    SERIALIZE_SCALAR(traceCmdsLoaded);
+    SERIALIZE_SCALAR(blocked);
+    SERIALIZE_SCALAR(traceActive);
+    std::vector<Addr> submitAddrs;
+    std::vector<uint32_t> submitSizes;
+    std::vector<ContextID> submitContexts;
+    for (const auto &submit : submitQueue) {
+        submitAddrs.push_back(submit.vaddr);
+        submitSizes.push_back(submit.size);
+        submitContexts.push_back(submit.context);
+    }
+    SERIALIZE_CONTAINER(submitAddrs);
+    SERIALIZE_CONTAINER(submitSizes);
+    SERIALIZE_CONTAINER(submitContexts);
+    SERIALIZE_SCALAR(startBaseTrace);
+    SERIALIZE_SCALAR(quiesc_timer);
+    SERIALIZE_SCALAR(waiting);
+    SERIALIZE_SCALAR(waiting_for_gem5_mem);
+    SERIALIZE_SCALAR(flushing_spm);
+    SERIALIZE_SCALAR(cyclesNVDLA);
+    SERIALIZE_SCALAR(idle_cycles);
+    SERIALIZE_SCALAR(layersDone);
+    SERIALIZE_SCALAR(frozenTick);
+
+    // the model state (embedded buffer, load_mem payloads...) is binary
+    // and can be large, so it goes to a file of its own
+    std::string model_file = name() + ".nvdla";
+    std::ofstream os(CheckpointIn::dir() + "/" + model_file, std::ios::binary);
+    bool saved = os && wr->save(os);
+    trace->save(os);
+    os.close();
+    fatal_if(!saved || os.fail(), "%s: could not write the model checkpoint "
+             "file '%s'\n", name(), model_file);
+    SERIALIZE_SCALAR(model_file);
+
+    if (frozenTick) {
+        // in the middle of a trace, the RTL is needed as well
+        fatal_if(!Wrapper_nvdla::vl_savable, "%s: cannot checkpoint a running "
+                 "NVDLA, the model was not verilated with --savable (make "
+                 "VL_SAVABLE=1 and build with NVDLA_VL_SAVABLE=1)\n", name());
+        std::string rtl_file = model_file + ".vl";
+        fatal_if(!wr->saveRTL((CheckpointIn::dir() + "/" + rtl_file).c_str()),
+                 "%s: could not write the RTL checkpoint file '%s'\n",
+                 name(), rtl_file);
+        SERIALIZE_SCALAR(rtl_file);
+    }
 
-        int maxRead = ((bytesToRead - bytesReaded) > 64) ?
-                         64 : (bytesToRead - bytesReaded);
+    if (dma_enable) {
+        dma_rd_engine->serializeSection(cp, "dma_rd_engine");
+        dma_wr_engine->serializeSection(cp, "dma_wr_engine");
+    }
+}
 
-        for (int i = 0;i < maxRead; i++) {
-            ptrTrace[bytesReaded + i] = data_ptr[i];
+void
+rtlNVDLA::unserialize(CheckpointIn &cp) {
+    UNSERIALIZE_SCALAR(nvdlaStarted);
+    UNSERIALIZE_SCALAR(traceCmdsLoaded);
+    UNSERIALIZE_SCALAR(blocked);
+    UNSERIALIZE_SCALAR(startBaseTrace);
+    UNSERIALIZE_SCALAR(quiesc_timer);
+    UNSERIALIZE_SCALAR(waiting);
+    UNSERIALIZE_SCALAR(waiting_for_gem5_mem);
+    UNSERIALIZE_SCALAR(flushing_spm);
+    UNSERIALIZE_SCALAR(cyclesNVDLA);
+    UNSERIALIZE_SCALAR(idle_cycles);
+    UNSERIALIZE_SCALAR(layersDone);
+    UNSERIALIZE_SCALAR(frozenTick);
+    // checkpoints from before the submission queue have no queued traces
+    // and were running a trace only if it was loading or frozen
+    traceActive = blocked || frozenTick;
+    UNSERIALIZE_OPT_SCALAR(traceActive);
+    submitQueue.clear();
+    if (cp.entryExists(Serializable::currentSection(), "submitAddrs")) {
+        std::vector<Addr> submitAddrs;
+        std::vector<uint32_t> submitSizes;
+        UNSERIALIZE_CONTAINER(submitAddrs);
+        UNSERIALIZE_CONTAINER(submitSizes);
+        // checkpoints from before contexts were kept translated with the
+        // first thread
+        std::vector<ContextID> submitContexts(submitAddrs.size(), 0);
+        if (cp.entryExists(Serializable::currentSection(), "submitContexts"))
+            UNSERIALIZE_CONTAINER(submitContexts);
+        for (size_t i = 0; i < submitAddrs.size(); i++) {
+            submitQueue.push_back({submitAddrs[i], submitSizes.at(i),
+                                   submitContexts.at(i)});
         }
+    }
 
-        bytesReaded += 64;
+    std::string model_file;
+    UNSERIALIZE_SCALAR(model_file);
+    std::ifstream is(cp.getCptDir() + "/" + model_file, std::ios::binary);
+    fatal_if(!is || !wr->restore(is), "%s: could not restore the model from "
+             "'%s'\n", name(), model_file);
+    trace->restore(is);
+    fatal_if(is.fail(), "%s: model checkpoint file '%s' is truncated\n",
+             name(), model_file);
+
+    if (frozenTick) {
+        std::string rtl_file;
+        UNSERIALIZE_SCALAR(rtl_file);
+        fatal_if(!wr->restoreRTL((cp.getCptDir() + "/" + rtl_file).c_str()),
+                 "%s: could not restore the RTL from '%s', the model has to "
+                 "be verilated with --savable\n", name(), rtl_file);
+    }
 
-        if (bytesReaded < bytesToRead) {
-            startTranslate(pkt->req->getVaddr() + 64, 0);
-        } else {
-            bytesReaded = 0;
-            bytesToRead = 0;
+    if (dma_enable) {
+        dma_rd_engine->unserializeSection(cp, "dma_rd_engine");
+        dma_wr_engine->unserializeSection(cp, "dma_wr_engine");
+    }
+}
 
-            // Load the trace and reset NVDLA
-            loadTraceNVDLA(ptrTrace);
-        }
+
+bool
+rtlNVDLA::handleResponse(PacketPtr pkt) {
+    TraceReadState *state = safe_cast<TraceReadState *>(pkt->popSenderState());
+    Addr offset = state->offset;
+    delete state;
+    traceReadsInFlight--;
+
+    if (pkt->hasData()) {
+        // copy the part of the line that belongs to the trace
+        Addr line_vaddr = traceFetchBase + offset;
+        Addr start = std::max(line_vaddr, traceVaddr);
+        Addr end = std::min(line_vaddr + pkt->getSize(), traceVaddr + bytesToRead);
+        memcpy(&traceData[start - traceVaddr],
+               pkt->getConstPtr<char>() + (start - line_vaddr), end - start);
     }
     else {
         // Strange situation, report!
         DPRINTF(rtlNVDLA, "Got response for addr %#x no data\n",
                             pkt->getAddr());
     }
-
-
-    // The packet is now done. We're about to put it in the port, no need for
-    // this object to continue to stall.
-    // We need to free the resource before sending the packet in case the CPU
-    // tries to send another request immediately (e.g., in the same callchain).
-    blocked = false;
+    delete pkt;
+
+    Addr line = system->cacheLineSize();
+    traceLineArrived[offset / line] = true;
+    uint32_t lines = traceLinesArrived;
+    while (traceLinesArrived < traceLineArrived.size() &&
+           traceLineArrived[traceLinesArrived])
+        traceLinesArrived++;
+
+    if (traceLinesArrived != lines) {
+        Addr arrived = traceFetchBase + traceLinesArrived * line - traceVaddr;
+        traceArrived(std::min(arrived, (Addr)bytesToRead));
+    }
+    if (bytesToRead)
+        fetchTrace();
 
     return true;
 }
 
 bool
 rtlNVDLA::handleResponseNVDLA(PacketPtr pkt, bool sram) {
+    if (parallel_tick) {
+        // the model is running on another thread, it will pick this up at
+        // the end of its current cycle. The packet pool is only touched by
+        // that thread, so write responses go the same way
+        bool read = pkt->isRead() && pkt->hasData();
+        pending_resp.push(std::make_pair(pkt, sram));
+        if (read)
+            wakeUp();
+        return true;
+    }
+
     if (pkt->hasData()) {
         if (pkt->isRead()) {
             // Get data from gem5 memory system
             // and set it to AXI
             DPRINTF(rtlNVDLADebug,
                     "Handling response for data read Timing\n");
-            // Get the data ptr and sent it
-            const uint8_t* dataPtr = pkt->getConstPtr<uint8_t>();
-            uint64_t addr_nvdla = getAddrNVDLA(pkt->getAddr(), sram);
-            if (sram) {
-                // SRAM
-                wr->axi_cvsram->inflight_resp(addr_nvdla, dataPtr);
-            } else {
-                // DBBIF
-                wr->axi_dbb->inflight_resp(addr_nvdla, dataPtr);
-            }
+            // Get the data ptr and sent it, after accounting the
+            // skipped cycles so that the response is on the right cycle
+            wakeUp();
+            deliverReadData(pkt, sram);
         } else {
             // this is somehow odd, report!
             DPRINTF(rtlNVDLA, "Got response for addr %#x no read\n",
@@ -455,9 +1028,24 @@ rtlNVDLA::handleResponseNVDLA(PacketPtr pkt, bool sram) {
          pkt->getAddr());
     }
 
+    packetPool.recycle(pkt);
     return true;
 }
 
+void
+rtlNVDLA::deliverReadData(PacketPtr pkt, bool sram) {
+    const uint8_t* dataPtr = pkt->getConstPtr<uint8_t>();
+    uint64_t addr_nvdla = getAddrNVDLA(pkt->getAddr(), sram);
+    // SRAM or DBBIF
+    AXIResponder *axi = sram ? wr->axi_cvsram : wr->axi_dbb;
+    memStats.read(pkt->getSize());
+    if (replayLog)
+        replayLog->response(wr->tickcount, pkt->getAddr());
+    // a coalesced packet completes one txn per beat
+    for (unsigned offset = 0; offset < pkt->getSize(); offset += AXI_WIDTH / 8)
+        axi->inflight_resp(addr_nvdla + offset, dataPtr + offset);
+}
+
 void
 rtlNVDLA::handleFunctional(PacketPtr pkt) {
     // Just pass this on to the memory side to handle for now.
@@ -489,18 +1077,24 @@ rtlNVDLA::finishTranslation(WholeTranslationState *state) {
 
     } else {
         to_retry_vaddr = req->getVaddr();
+        to_retry_context = req->contextId();
         schedule(retryTranslateEvent, nextCycle());
+        delete [] state->data;
+        delete state;
         return;
     }
 
-    PacketPtr new_pkt = new Packet(req, MemCmd::ReadReq, 64);
-
-    if (memPort.blockedPacket != nullptr) {
-        DPRINTF(rtlNVDLA, "Packet lost\n");
-    } else {
-        new_pkt->allocate();
-        memPort.sendPacket(new_pkt);
-    }
+    // the lines of the trace in this page can be read now
+    tracePageVaddr = req->getVaddr();
+    tracePagePaddr = req->getPaddr();
+    tracePageFlags = req->getFlags();
+    tracePageRequestor = req->requestorId();
+    tracePageValid = true;
+    traceTranslating = false;
+    delete [] state->data;
+    delete state;
+
+    fetchTrace();
 }
 
 // DRAM PORT
@@ -511,6 +1105,8 @@ rtlNVDLA::MemNVDLAPort::sendPacket(PacketPtr pkt, bool timing) {
             pkt->getAddr(), pkt->getSize(), pending_req.size());
         // we add as a pending request, we deal later
         pending_req.push(pkt);
+        inflight++;
+        owner->recordRequest(pkt, sram);
     } else {
         DPRINTF(rtlNVDLA, "Send Mem Req to DRAM %#x size: %d functional\n",
             pkt->getAddr(), pkt->getSize());
@@ -519,10 +1115,31 @@ rtlNVDLA::MemNVDLAPort::sendPacket(PacketPtr pkt, bool timing) {
         // Update all the pointers
         recentData32 = *pkt->getConstPtr<uint32_t>();
         recentData = *pkt->getConstPtr<uint8_t>();
-        recentDataptr = pkt->getConstPtr<uint8_t>();
+        if (pkt->isRead()) {
+            // only grows up to the largest read, then no more allocations
+            if (recentBuf.size() < pkt->getSize())
+                recentBuf.resize(pkt->getSize());
+            pkt->writeData(recentBuf.data());
+        }
+        recentDataptr = recentBuf.data();
+        owner->packetPool.recycle(pkt);
     }
 }
 
+void
+rtlNVDLA::recordRequest(PacketPtr pkt, bool sram) {
+    if (!replayLog)
+        return;
+    uint32_t flags = 0;
+    if (pkt->isWrite())
+        flags |= ReplayRecord::Write;
+    if (sram)
+        flags |= ReplayRecord::Sram;
+    if (pkt->req->isUncacheable())
+        flags |= ReplayRecord::Uncacheable;
+    replayLog->request(wr->tickcount, pkt->getAddr(), pkt->getSize(), flags);
+}
+
 void
 rtlNVDLA::MemNVDLAPort::recvRangeChange() {
     owner->sendRangeChange();
@@ -531,6 +1148,7 @@ rtlNVDLA::MemNVDLAPort::recvRangeChange() {
 bool
 rtlNVDLA::MemNVDLAPort::recvTimingResp(PacketPtr pkt) {
     DPRINTF(rtlNVDLA, "Got response SRAM?: %d\n", sram);
+    inflight--;
     return owner->handleResponseNVDLA(pkt, sram);
 }
 
@@ -601,7 +1219,7 @@ rtlNVDLA::getAddrNVDLA(uint64_t addr, bool sram) {
 const uint8_t *
 rtlNVDLA::readAXIVariable(uint64_t addr, bool sram, bool timing, bool cacheable, unsigned int size) {
     // Update stats
-    stats.nvdla_reads++;
+    stats.nvdla_read_pkts++;
 
     uint64_t real_addr = getRealAddr(addr, sram);
 
@@ -609,11 +1227,9 @@ rtlNVDLA::readAXIVariable(uint64_t addr, bool sram, bool timing, bool cacheable,
             "Read AXI Variable addr: %#x, real_addr %#x, size %d\n",
             addr, real_addr, size);
 
-    RequestPtr req = std::make_shared<Request>(real_addr, size, cacheable ? 0: Request::UNCACHEABLE, 0);
-    PacketPtr packet = nullptr;
-    // we create the real packet, write request
-    packet = Packet::createRead(req);
-    packet->allocate();
+    // we create the real packet, read request
+    PacketPtr packet = packetPool.get(real_addr, size,
+                                      cacheable ? 0 : Request::UNCACHEABLE);
     // send the packet in timing?
     if (sram) {
         sramPort.sendPacket(packet, timing);
@@ -629,6 +1245,7 @@ void
 rtlNVDLA::writeAXI(uint64_t addr, uint8_t data, bool sram, bool timing) {
     // Update stats
     stats.nvdla_writes++;
+    stats.nvdla_write_pkts++;
 
     uint64_t real_addr = getRealAddr(addr, sram);
 
@@ -639,17 +1256,11 @@ rtlNVDLA::writeAXI(uint64_t addr, uint8_t data, bool sram, bool timing) {
     // addr is the physical addr
     // size is one byte
     // flags is physical (vaddr is also the physical one)
-    RequestPtr req = std::make_shared<Request>(real_addr, 1,
-                                               0, 0);
-    PacketPtr packet = nullptr;
     // we create the real packet, write request
-    packet = Packet::createWrite(req);
     // always in Little Endian
-    PacketDataPtr dataAux = new uint8_t[1];
-#ifndef NO_DATA
-    dataAux[0] = data;
-#endif
-    packet->dataDynamic(dataAux);
+    PacketPtr packet = packetPool.get(real_addr, 1, 0, &data);
+    if (timing)
+        memStats.write(1);
     // send the packet in timing?
     if (sram) {
         sramPort.sendPacket(packet, timing);
@@ -659,25 +1270,18 @@ rtlNVDLA::writeAXI(uint64_t addr, uint8_t data, bool sram, bool timing) {
 }
 
 void
-rtlNVDLA::writeAXILong(uint64_t addr, uint32_t length, uint8_t* data, uint64_t mask, bool sram, bool timing, bool cacheable) {
-    stats.nvdla_writes++;
+rtlNVDLA::writeAXILong(uint64_t addr, uint32_t length, const uint8_t* data, const uint64_t* mask, bool sram, bool timing, bool cacheable) {
+    stats.nvdla_write_pkts++;
 
     uint64_t real_addr = getRealAddr(addr, sram);
-    RequestPtr req = std::make_shared<Request>(real_addr, length, cacheable ? 0: Request::UNCACHEABLE, 0);
-#ifndef NO_DATA
-    std::vector<bool> byte_enable_vec(length);
-
-    for (int i = 0; i < length; i++)
-        byte_enable_vec[i] = ((mask >> i) & 1);
-
-    req->setByteEnable(byte_enable_vec);
+#ifdef NO_DATA
+    mask = nullptr;
 #endif
-    PacketPtr packet = nullptr;
-    packet = Packet::createWrite(req);
-
-    // here we directly give the 'data' ptr to pkt.
-    // This is supported by the fact that 'data' is malloced by ourselves
-    packet->dataDynamic(data);
+    PacketPtr packet = packetPool.get(real_addr, length,
+                                      cacheable ? 0 : Request::UNCACHEABLE,
+                                      data, mask);
+    if (timing)
+        memStats.write(length);
     // send the packet in timing?
     if (sram) {
         sramPort.sendPacket(packet, timing);
@@ -686,13 +1290,126 @@ rtlNVDLA::writeAXILong(uint64_t addr, uint32_t length, uint8_t* data, uint64_t m
     }
 }
 
+rtlNVDLA::SpmReplacement::SpmReplacement(replacement_policy::Base *_policy,
+                                         uint32_t num_sets, uint32_t _assoc,
+                                         uint32_t line_size)
+    : policy(_policy), assoc(_assoc), entries((uint64_t)num_sets * _assoc),
+      req(std::make_shared<Request>(0, line_size, 0, 0)),
+      pkt(new Packet(req, MemCmd::ReadReq))
+{
+    for (uint32_t set_id = 0; set_id < num_sets; set_id++) {
+        for (uint32_t way = 0; way < assoc; way++) {
+            ReplaceableEntry &entry = entries[set_id * assoc + way];
+            entry.setPosition(set_id, way);
+            entry.replacementData = policy->instantiateEntry();
+        }
+    }
+    candidates.reserve(assoc);
+}
+
+PacketPtr
+rtlNVDLA::SpmReplacement::access(uint64_t addr)
+{
+    pkt->setAddr(addr);
+    return pkt.get();
+}
+
+void
+rtlNVDLA::SpmReplacement::touch(uint32_t set_id, uint32_t way, uint64_t addr)
+{
+    policy->touch(entries[set_id * assoc + way].replacementData,
+                  access(addr));
+}
+
+void
+rtlNVDLA::SpmReplacement::reset(uint32_t set_id, uint32_t way, uint64_t addr)
+{
+    policy->reset(entries[set_id * assoc + way].replacementData,
+                  access(addr));
+}
+
+void
+rtlNVDLA::SpmReplacement::invalidate(uint32_t set_id, uint32_t way)
+{
+    policy->invalidate(entries[set_id * assoc + way].replacementData);
+}
+
+uint32_t
+rtlNVDLA::SpmReplacement::get_victim(uint32_t set_id)
+{
+    candidates.clear();
+    for (uint32_t way = 0; way < assoc; way++)
+        candidates.push_back(&entries[set_id * assoc + way]);
+    return policy->getVictim(candidates)->getWay();
+}
+
+PacketPtr
+rtlNVDLA::PacketPool::get(Addr addr, unsigned size, Request::Flags flags,
+                          const uint8_t *data, const uint64_t *mask)
+{
+    if (freeSlots.empty()) {
+        slots.emplace_back(new Slot);
+        slots.back()->data.reset(new uint8_t[dataSize]);
+        freeSlots.push_back(slots.back().get());
+    }
+    Slot *slot = freeSlots.back();
+    freeSlots.pop_back();
+
+    // re-arm the request unless the memory system still holds on to it.
+    // setVirt() is how gem5 reuses a Request; the NVDLA has no MMU, so the
+    // vaddr is the paddr
+    if (slot->req && slot->req.use_count() == 1 &&
+        slot->req->getSize() == size) {
+        slot->req->setVirt(addr, size, flags, 0, 0);
+        slot->req->setPaddr(addr);
+    } else {
+        slot->req = std::make_shared<Request>(addr, size, flags, 0);
+    }
+    byteEnable.resize(size);
+    for (unsigned i = 0; i < size; i++)
+        byteEnable[i] = !mask || ((mask[i / 64] >> (i % 64)) & 1);
+    slot->req->setByteEnable(byteEnable);
+
+    PacketPtr pkt = new (slot->pktStorage) Packet(slot->req,
+        data ? Packet::makeWriteCmd(slot->req) :
+               Packet::makeReadCmd(slot->req));
+    uint8_t *buf = (size <= dataSize) ? slot->data.get() : new uint8_t[size];
+#ifndef NO_DATA
+    if (data)
+        memcpy(buf, data, size);
+#endif
+    if (buf == slot->data.get())
+        pkt->dataStatic(buf);
+    else
+        pkt->dataDynamic(buf);
+    pkt->pushSenderState(slot);
+    return pkt;
+}
+
+void
+rtlNVDLA::PacketPool::recycle(PacketPtr pkt)
+{
+    Slot *slot = dynamic_cast<Slot *>(pkt->senderState);
+    if (!slot) {
+        delete pkt;
+        return;
+    }
+    pkt->popSenderState();
+    pkt->~Packet();
+    freeSlots.push_back(slot);
+}
+
 void
 rtlNVDLA::try_get_dma_read_data(uint32_t size) {
     uint8_t dma_temp_buffer[size];
-    bool get_success = dma_rd_engine->tryGet(dma_temp_buffer, size);
-    if (get_success) {
+    Addr addr;
+    // hand over every line fill that is back, whatever order it was issued in
+    while (size_t len = dma_rd_engine->tryGetCompleted(addr, dma_temp_buffer, size)) {
         // we assume only DBB involves DMA. SRAM should not be accessed with DMA
-        wr->axi_dbb->inflight_dma_resp(dma_temp_buffer, size);
+        memStats.read(len);
+        if (replayLog)
+            replayLog->response(wr->tickcount, getRealAddr(addr, false));
+        wr->axi_dbb->inflight_dma_resp(addr, dma_temp_buffer, len);
     }
 }
 
@@ -714,6 +1431,24 @@ rtlNVDLA::regStats() {
     stats.nvdla_writes
         .name(name() + ".nvdla_writes")
         .desc("Number of writes performed");
+    stats.nvdla_read_pkts
+        .name(name() + ".nvdla_read_pkts")
+        .desc("Number of read packets sent, after coalescing");
+    stats.nvdla_write_pkts
+        .name(name() + ".nvdla_write_pkts")
+        .desc("Number of write packets sent, after coalescing");
+    stats.nvdla_skipped_cycles
+        .name(name() + ".nvdla_skipped_cycles")
+        .desc("Number of cycles (in nvdla_cycles) skipped while stalled on memory");
+
+    stats.nvdla_traces
+        .name(name() + ".nvdla_traces")
+        .desc("Number of traces run");
+    stats.nvdla_queued_starts
+        .name(name() + ".nvdla_queued_starts")
+        .desc("Number of traces (in nvdla_traces) started from the "
+              "submission queue when the previous one was done");
+
     stats.nvdla_avgReqCVSRAM
         .init(256)
         .name(name() + ".nvdla_avgReqCVSRAM")
@@ -726,13 +1461,213 @@ rtlNVDLA::regStats() {
         .desc("Histogram Requests onflight DBBIF")
         .flags(pdf);
 
+    stats.nvdla_inflightGrowsCVSRAM
+        .scalar(wr->axi_cvsram->getInflightGrows())
+        .name(name() + ".nvdla_inflightGrowsCVSRAM")
+        .desc("Number of times the inflight read ring of CVSRAM grew on the heap");
+
+    stats.nvdla_inflightGrowsDBBIF
+        .scalar(wr->axi_dbb->getInflightGrows())
+        .name(name() + ".nvdla_inflightGrowsDBBIF")
+        .desc("Number of times the inflight read ring of DBBIF grew on the heap");
+
+    TraceLoaderGem5::dump_summary &dump = trace->dump_stats;
+    stats.nvdla_dumps
+        .scalar(dump.dumps)
+        .name(name() + ".nvdla_dumps")
+        .desc("Number of dump_mem commands checked against their golden answer");
+    stats.nvdla_dump_bytes
+        .scalar(dump.bytes)
+        .name(name() + ".nvdla_dump_bytes")
+        .desc("Number of bytes dumped by dump_mem commands");
+    stats.nvdla_dump_mismatches
+        .scalar(dump.mismatched_dumps)
+        .name(name() + ".nvdla_dump_mismatches")
+        .desc("Number of dump_mem commands not matching their golden answer");
+    stats.nvdla_dump_mismatch_bytes
+        .scalar(dump.mismatch_bytes)
+        .name(name() + ".nvdla_dump_mismatch_bytes")
+        .desc("Number of dumped bytes differing from the golden answer");
+    stats.nvdla_dump_first_mismatch
+        .scalar(dump.first_mismatch)
+        .name(name() + ".nvdla_dump_first_mismatch")
+        .desc("Offset of the first differing byte in the first mismatching dump, -1 if none");
+    stats.nvdla_dump_max_error
+        .scalar(dump.max_error)
+        .name(name() + ".nvdla_dump_max_error")
+        .desc("Largest absolute difference of a dumped byte from the golden answer");
+}
+
+rtlNVDLA::MemStats::MemStats(rtlNVDLA *_owner, const rtlNVDLAParams &params)
+    : statistics::Group(_owner),
+      owner(_owner),
+      bwWindow(params.stats_bw_window),
+      spm(_owner),
+      dma(_owner),
+      dbb(_owner, "dbb", params),
+      cvsram(_owner, "cvsram", params),
+      ADD_STAT(readBytes, statistics::units::Byte::get(),
+               "Bytes read from memory, including DMA line fills"),
+      ADD_STAT(writeBytes, statistics::units::Byte::get(),
+               "Bytes written to memory, including DMA write-backs"),
+      ADD_STAT(readBandwidth, statistics::units::Rate<
+                   statistics::units::Byte, statistics::units::Second>::get(),
+               "Average read bandwidth in Byte/s"),
+      ADD_STAT(writeBandwidth, statistics::units::Rate<
+                   statistics::units::Byte, statistics::units::Second>::get(),
+               "Average write bandwidth in Byte/s"),
+      ADD_STAT(readBytesOverTime, statistics::units::Byte::get(),
+               "Bytes read from memory per stats_bw_window NVDLA cycles"),
+      ADD_STAT(writeBytesOverTime, statistics::units::Byte::get(),
+               "Bytes written to memory per stats_bw_window NVDLA cycles")
+{
+    fatal_if(!bwWindow || !params.stats_bw_windows,
+             "%s: stats_bw_window and stats_bw_windows cannot be 0\n",
+             _owner->name());
+    readBytesOverTime.init(params.stats_bw_windows).flags(statistics::nozero);
+    writeBytesOverTime.init(params.stats_bw_windows).flags(statistics::nozero);
+}
+
+void
+rtlNVDLA::MemStats::regStats()
+{
+    statistics::Group::regStats();
+
+    readBandwidth.flags(statistics::nonan);
+    writeBandwidth.flags(statistics::nonan);
+    readBandwidth = readBytes / simSeconds;
+    writeBandwidth = writeBytes / simSeconds;
+}
+
+rtlNVDLA::MemStats::SpmStats::SpmStats(statistics::Group *parent)
+    : statistics::Group(parent, "spm"),
+      ADD_STAT(hits, statistics::units::Count::get(),
+               "Demand read beats found in the embedded buffer"),
+      ADD_STAT(misses, statistics::units::Count::get(),
+               "Demand read beats not found in the embedded buffer"),
+      ADD_STAT(hitRate, statistics::units::Ratio::get(),
+               "Hit rate of demand read beats in the embedded buffer"),
+      ADD_STAT(evictions, statistics::units::Count::get(),
+               "Valid lines replaced in the embedded buffer"),
+      ADD_STAT(writeBacks, statistics::units::Count::get(),
+               "Dirty lines written back, on eviction or at the end of the trace")
+{
+}
+
+void
+rtlNVDLA::MemStats::SpmStats::regStats()
+{
+    statistics::Group::regStats();
+
+    hitRate.flags(statistics::nonan);
+    hitRate = hits / (hits + misses);
+}
+
+rtlNVDLA::MemStats::DmaStats::DmaStats(statistics::Group *parent)
+    : statistics::Group(parent, "dma"),
+      ADD_STAT(reads, statistics::units::Count::get(),
+               "Line fills issued to the DMA read engine, prefetches included"),
+      ADD_STAT(writes, statistics::units::Count::get(),
+               "Writes issued to the DMA write engine"),
+      ADD_STAT(readBytes, statistics::units::Byte::get(),
+               "Bytes requested from the DMA read engine"),
+      ADD_STAT(writeBytes, statistics::units::Byte::get(),
+               "Bytes given to the DMA write engine"),
+      ADD_STAT(readLatency, statistics::units::Cycle::get(),
+               "NVDLA cycles from issuing a demand line fill to its data"),
+      ADD_STAT(prefetchLatency, statistics::units::Cycle::get(),
+               "NVDLA cycles from issuing a prefetch line fill to its data")
+{
+    readLatency.init(32).flags(statistics::pdf);
+    prefetchLatency.init(32).flags(statistics::pdf);
+}
+
+rtlNVDLA::MemStats::AxiStats::AxiStats(statistics::Group *parent,
+                                       const char *name,
+                                       const rtlNVDLAParams &params)
+    : statistics::Group(parent, name),
+      ADD_STAT(readLatency, statistics::units::Cycle::get(),
+               "NVDLA cycles from a read request to its last beat, by arid"),
+      ADD_STAT(writeLatency, statistics::units::Cycle::get(),
+               "NVDLA cycles from a write request to its last beat, by awid")
+{
+    fatal_if(!params.stats_axi_ids || !params.stats_latency_bucket ||
+             params.stats_latency_max < params.stats_latency_bucket,
+             "%s: invalid stats_axi_ids / stats_latency_bucket / "
+             "stats_latency_max\n", params.name);
+    readLatency
+        .init(params.stats_axi_ids, 0, params.stats_latency_max - 1,
+              params.stats_latency_bucket)
+        .flags(statistics::total | statistics::nozero);
+    writeLatency
+        .init(params.stats_axi_ids, 0, params.stats_latency_max - 1,
+              params.stats_latency_bucket)
+        .flags(statistics::total | statistics::nozero);
+}
+
+unsigned
+rtlNVDLA::MemStats::window()
+{
+    return std::min<uint64_t>(owner->cyclesNVDLA / bwWindow,
+                              readBytesOverTime.size() - 1);
+}
+
+void
+rtlNVDLA::MemStats::read(unsigned bytes)
+{
+    readBytes += bytes;
+    readBytesOverTime[window()] += bytes;
+}
+
+void
+rtlNVDLA::MemStats::write(unsigned bytes)
+{
+    writeBytes += bytes;
+    writeBytesOverTime[window()] += bytes;
+}
 
-    // stats.num_dma_rd
-    //     .name(name() + ".num_dma_rd")
-    //     .desc("Number of DMA read issued by this NVDLA");
-    // stats.num_dma_wr
-    //     .name(name() + ".num_dma_wr")
-    //     .desc("Number of DMA write issued by this NVDLA");
+void
+rtlNVDLA::MemStats::spm_read(bool hit)
+{
+    if (hit)
+        spm.hits++;
+    else
+        spm.misses++;
+}
+
+void
+rtlNVDLA::MemStats::spm_evict()
+{
+    spm.evictions++;
+}
+
+void
+rtlNVDLA::MemStats::spm_write_back()
+{
+    spm.writeBacks++;
+}
+
+void
+rtlNVDLA::MemStats::dma_read_done(bool prefetch, uint64_t cycles)
+{
+    if (prefetch)
+        dma.prefetchLatency.sample(cycles);
+    else
+        dma.readLatency.sample(cycles);
+}
+
+void
+rtlNVDLA::MemStats::axi_read_done(bool sram, uint8_t arid, uint64_t cycles)
+{
+    statistics::VectorDistribution &lat = (sram ? cvsram : dbb).readLatency;
+    lat[std::min<unsigned>(arid, lat.size() - 1)].sample(cycles);
+}
+
+void
+rtlNVDLA::MemStats::axi_write_done(bool sram, uint8_t awid, uint64_t cycles)
+{
+    statistics::VectorDistribution &lat = (sram ? cvsram : dbb).writeLatency;
+    lat[std::min<unsigned>(awid, lat.size() - 1)].sample(cycles);
 }
 
 } //End namespace gem5
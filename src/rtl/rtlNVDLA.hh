@@ -31,6 +31,8 @@
 #ifndef __RTL_NVDLA_VERILATOR_HH__
 #define __RTL_NVDLA_VERILATOR_HH__
 
+#include <deque>
+#include <memory>
 #include <string>
 #include <vector>
 #include <utility>
@@ -43,7 +45,10 @@
 #include "cpu/translation.hh"
 #include "debug/rtlNVDLA.hh"
 #include "debug/rtlNVDLADebug.hh"
+#include "mem/cache/replacement_policies/base.hh"
 #include "params/rtlNVDLA.hh"
+#include "rtl/axiLogWriter.hh"
+#include "rtl/replayTrace.hh"
 #include "rtl/rtlObject.hh"
 #include "rtl/traceLoaderGem5.hh"
 #include "sim/system.hh"
@@ -83,20 +88,26 @@ class rtlNVDLA : public rtlObject
             RequestPort(name, owner),
             owner(owner),
             sram(sram_),
-            blockedRetry(false)
+            blockedRetry(false),
+            inflight(0)
         { }
 
         uint8_t recentData;
 
         uint32_t recentData32;
 
+        // points into recentBuf, which holds the data of the last atomic
+        // read, so that its packet goes back to the pool right away
         const uint8_t *recentDataptr;
+        std::vector<uint8_t> recentBuf;
 
         std::queue<PacketPtr> pending_req;
 
         bool sram;
         // if we are blocked due to a req retry
         bool blockedRetry;
+        // timing packets given to sendPacket that have no response yet
+        uint32_t inflight;
 
         /**
          * Send a packet across this port. This is called by the owner and
@@ -197,43 +208,346 @@ class rtlNVDLA : public rtlObject
 
     DmaPort dmaPort;
 
-    int bytesToRead;    // it works as a counter
-    unsigned int bytesReaded;
+    uint32_t bytesToRead;
 
     // True if this is currently blocked waiting for a response.
     bool blocked;
 
+    /**
+     * Submission queue. Every start request of the CPU is a trace (vaddr,
+     * size, context) queued here, so that several traces can be submitted
+     * at once.
+     * When a trace is done the CPU gets its finish packet and the next
+     * queued trace starts right away, without waiting for the CPU.
+     */
+    struct TraceSubmission
+    {
+        Addr vaddr;
+        uint32_t size;
+        // the submitting thread, the trace is in its address space
+        ContextID context;
+    };
+    std::deque<TraceSubmission> submitQueue;
+    // a trace is being loaded or run
+    bool traceActive;
+
+    void startNextTrace();
+
     const unsigned int max_req_inflight;
 
     const uint32_t freq_ratio;
 
     uint32_t id_nvdla;
+    // unique among the NVDLAs of all the CPUs, unlike id_nvdla
+    uint32_t accel_index;
 
     uint64_t baseAddrDRAM;
     uint64_t baseAddrSRAM;
 
     uint32_t startMemRegion;
     uint32_t startBaseTrace;
-    char *ptrTrace;
+
+    /**
+     * Trace fetch. The trace is read through mem_side one cache line at a
+     * time, translating once per page and keeping up to trace_fetch_depth
+     * line reads in flight. The register commands are handed to the trace
+     * loader as soon as they have arrived contiguously from the start of
+     * the trace, and the NVDLA is reset and starts ticking after the first
+     * of them while the rest (e.g., large load_mem payloads) keeps loading.
+     * With prefetch_enable it waits for the whole trace, since the read
+     * variable log comes last. trace_functional_load instead reads the whole
+     * trace at once through a TranslatingPortProxy, taking no simulated time.
+     */
+    struct TraceReadState : public Packet::SenderState
+    {
+        // offset of the line from traceFetchBase
+        Addr offset;
+        TraceReadState(Addr _offset) : offset(_offset) { }
+    };
+
+    const uint32_t trace_fetch_depth;
+    const bool trace_functional_load;
+    std::vector<char> traceData;
+    Addr traceVaddr;
+    ContextID traceContext;     // translates traceVaddr
+    Addr traceFetchBase;        // traceVaddr rounded down to a line
+    Addr traceFetchNext;        // vaddr of the next line to read
+    Addr tracePageVaddr;
+    Addr tracePagePaddr;
+    Request::Flags tracePageFlags;
+    RequestorID tracePageRequestor;
+    bool tracePageValid;
+    bool traceTranslating;
+    uint32_t traceReadsInFlight;
+    std::vector<bool> traceLineArrived;
+    uint32_t traceLinesArrived;     // lines arrived contiguously from traceFetchBase
+    bool traceCmdsLoaded;
+    bool nvdlaStarted;
+    EventFunctionWrapper functionalTraceEvent;
+
+    void fetchTrace();
+    void loadTraceFunctional();
+    void traceArrived(uint32_t avail);
+    // the register trace has been parsed and executed completely
+    bool csbDone() { return traceCmdsLoaded && wr->csb->done(); }
+
+    /**
+     * Out-of-order DMA read engine that keeps up to max_pending line fills
+     * in flight and wakes the NVDLA up whenever some of them complete.
+     * Fills are tagged by their SPM line address.
+     */
+    class DmaReadEngineNVDLA : public DmaNvdla
+    {
+      private:
+        rtlNVDLA *owner;
+
+      public:
+        DmaReadEngineNVDLA(rtlNVDLA *owner, DmaPort &port,
+                           unsigned line_size, unsigned max_pending,
+                           Request::Flags flags=0) :
+            DmaNvdla(port, false, line_size * max_pending, line_size,
+                     max_pending, flags, true),
+            owner(owner)
+        { }
+
+      protected:
+        void onCompletion() override { owner->wakeUp(); }
+    };
+
+    /**
+     * Recycles the packets the RTL model sends to memory. A slot holds the
+     * storage of a Packet, its Request and its data, and rides along as the
+     * packet's sender state. Handing the response to recycle() puts the slot
+     * back on the free list, so after warming up no memory request of the
+     * model allocates anything.
+     */
+    class PacketPool
+    {
+      private:
+        struct Slot : public Packet::SenderState
+        {
+            alignas(Packet) uint8_t pktStorage[sizeof(Packet)];
+            std::unique_ptr<uint8_t[]> data;
+            RequestPtr req;
+        };
+        const unsigned dataSize;
+        std::vector<std::unique_ptr<Slot>> slots;
+        std::vector<Slot *> freeSlots;
+        std::vector<bool> byteEnable;
+
+      public:
+        /** Packets up to data_size bytes use the buffer of their slot. */
+        explicit PacketPool(unsigned data_size) : dataSize(data_size) { }
+
+        /**
+         * Build a read (data == nullptr) or write packet in a free slot.
+         * mask holds one enable bit per byte, nullptr enables them all.
+         */
+        PacketPtr get(Addr addr, unsigned size, Request::Flags flags,
+                      const uint8_t *data=nullptr,
+                      const uint64_t *mask=nullptr);
+        /** Give back a packet, deleting it if it is not from the pool. */
+        void recycle(PacketPtr pkt);
+    };
+
+    /**
+     * Lets the embedded buffer pick its victims with a gem5 replacement
+     * policy. Each line of the buffer is a ReplaceableEntry, instantiated
+     * set by set so that policies keeping per-set state (e.g., tree-PLRU)
+     * group them as a cache would. Policies training on the access (e.g.,
+     * SHiP) get a packet carrying the line address.
+     */
+    class SpmReplacement : public spmReplacementPolicy
+    {
+      private:
+        replacement_policy::Base *const policy;
+        const uint32_t assoc;
+        std::vector<ReplaceableEntry> entries;
+        ReplacementCandidates candidates;
+        RequestPtr req;
+        std::unique_ptr<Packet> pkt;
+
+        PacketPtr access(uint64_t addr);
+
+      public:
+        SpmReplacement(replacement_policy::Base *_policy, uint32_t num_sets,
+                       uint32_t _assoc, uint32_t line_size);
+
+        void touch(uint32_t set_id, uint32_t way, uint64_t addr) override;
+        void reset(uint32_t set_id, uint32_t way, uint64_t addr) override;
+        void invalidate(uint32_t set_id, uint32_t way) override;
+        uint32_t get_victim(uint32_t set_id) override;
+    };
 
     struct nvdla_stats
     {
         statistics::Scalar nvdla_cycles;
+        statistics::Scalar nvdla_skipped_cycles;
+        statistics::Scalar nvdla_traces;
+        statistics::Scalar nvdla_queued_starts;
         statistics::Scalar nvdla_reads;
         statistics::Scalar nvdla_writes;
+        statistics::Scalar nvdla_read_pkts;
+        statistics::Scalar nvdla_write_pkts;
         statistics::Histogram nvdla_avgReqCVSRAM;
         statistics::Histogram nvdla_avgReqDBBIF;
+        statistics::Value nvdla_inflightGrowsCVSRAM;
+        statistics::Value nvdla_inflightGrowsDBBIF;
+
+        // output check of the dump_mem commands, see TraceLoaderGem5::dump_summary
+        statistics::Value nvdla_dumps;
+        statistics::Value nvdla_dump_bytes;
+        statistics::Value nvdla_dump_mismatches;
+        statistics::Value nvdla_dump_mismatch_bytes;
+        statistics::Value nvdla_dump_first_mismatch;
+        statistics::Value nvdla_dump_max_error;
+    };
+    nvdla_stats stats;
 
-        // statistics::Scalar num_dma_rd;
-        // statistics::Scalar num_dma_wr;
+    /**
+     * Embedded buffer, DMA and AXI statistics. The model reports its
+     * events through the nvdlaStatsRecorder hook of the wrapper, so these
+     * need no axilog and are reset and dumped (e.g., periodically) with
+     * all the other stats. Latencies are in NVDLA cycles; bytes count the
+     * timing traffic with memory, including DMA. The groups below are
+     * children of the rtlNVDLA, the rest is merged into it.
+     */
+    class MemStats : public statistics::Group, public nvdlaStatsRecorder
+    {
+      private:
+        rtlNVDLA *owner;
+        const uint32_t bwWindow;
+
+        unsigned window();
 
-        // statistics::Scalar num_spm_hit;
-        // statistics::Scalar num_spm_miss;
-        // statistics::Scalar num_spm_use;
+      public:
+        struct SpmStats : public statistics::Group
+        {
+            SpmStats(statistics::Group *parent);
+            void regStats() override;
+
+            statistics::Scalar hits;
+            statistics::Scalar misses;
+            statistics::Formula hitRate;
+            statistics::Scalar evictions;
+            statistics::Scalar writeBacks;
+        } spm;
+
+        struct DmaStats : public statistics::Group
+        {
+            DmaStats(statistics::Group *parent);
+
+            statistics::Scalar reads;
+            statistics::Scalar writes;
+            statistics::Scalar readBytes;
+            statistics::Scalar writeBytes;
+            statistics::Histogram readLatency;
+            statistics::Histogram prefetchLatency;
+        } dma;
+
+        struct AxiStats : public statistics::Group
+        {
+            AxiStats(statistics::Group *parent, const char *name,
+                     const rtlNVDLAParams &params);
+
+            // by arid / awid, larger ids share the last entry
+            statistics::VectorDistribution readLatency;
+            statistics::VectorDistribution writeLatency;
+        } dbb, cvsram;
+
+        statistics::Scalar readBytes;
+        statistics::Scalar writeBytes;
+        statistics::Formula readBandwidth;
+        statistics::Formula writeBandwidth;
+        // bytes per stats_bw_window NVDLA cycles, later ones in the last entry
+        statistics::Vector readBytesOverTime;
+        statistics::Vector writeBytesOverTime;
+
+        MemStats(rtlNVDLA *owner, const rtlNVDLAParams &params);
+        void regStats() override;
+
+        void read(unsigned bytes);
+        void write(unsigned bytes);
+
+        void spm_read(bool hit) override;
+        void spm_evict() override;
+        void spm_write_back() override;
+        void dma_read_done(bool prefetch, uint64_t cycles) override;
+        void axi_read_done(bool sram, uint8_t arid, uint64_t cycles) override;
+        void axi_write_done(bool sram, uint8_t awid, uint64_t cycles) override;
     };
-    nvdla_stats stats;
+    MemStats memStats;
+
     void processOutput(outputNVDLA& out);
 
+    /**
+     * Event queue the tick event (and so the RTL model) runs on. It is the
+     * queue of this object unless tick_eventq_index asks for a separate one,
+     * in which case everything touching gem5 objects is done after migrating
+     * back to eventQueue(), and responses are buffered in pending_resp
+     * until the model thread picks them up. The other way round, scheduling
+     * the tick, waking the model up and loading trace commands into a
+     * running model migrate to tickEventQueue.
+     */
+    EventQueue *tickEventQueue;
+    bool parallel_tick;
+    std::queue<std::pair<PacketPtr, bool>> pending_resp;
+
+    void scheduleTick(Tick when);
+    void deliverResponses();
+
+    /**
+     * Idle-cycle skipping. Once the RTL has been stalled on memory (see
+     * Wrapper_nvdla::stalledOnMemory) for idle_skip_threshold cycles the
+     * tick is not rescheduled. The next read response or DMA fill calls
+     * wakeUp(), which accounts the skipped cycles and resumes ticking on
+     * the same cycle grid.
+     */
+    const uint32_t idle_skip_threshold;
+    uint32_t idle_cycles;
+    bool sleeping;
+    Tick sleep_next_tick;
+
+    void wakeUp();
+
+    /**
+     * Checkpointing. Draining freezes the RTL: the tick event does not
+     * evaluate it any more and remembers its time in frozenTick, while
+     * drainEvent keeps handing memory responses and DMA fills over to the
+     * model until nothing is in flight. The model state around the RTL is
+     * written next to the checkpoint by Wrapper_nvdla::save, the RTL
+     * itself needs a model verilated with --savable (NVDLA_VL_SAVABLE).
+     * drainResume() ticks again from frozenTick on the same cycle grid.
+     */
+    Tick frozenTick;
+    EventFunctionWrapper drainEvent;
+
+    void drainPump();
+    // no memory access, trace read or DMA fill of this NVDLA is in flight
+    bool memoryIdle() const;
+
+    // layers (interrupts) completed by the current trace, with
+    // checkpoint_layer the simulation exits with "checkpoint" after it
+    uint32_t layersDone;
+    const uint32_t checkpoint_layer;
+
+    PacketPool packetPool;
+
+    /**
+     * Burst coalescing. Contiguous timing beats produced in the same cycle
+     * (the beats of an AXI burst, or back-to-back long writes) are merged
+     * into one packet of up to max_coalesce_bytes that does not cross a
+     * max_coalesce_bytes boundary. Read responses are split back into one
+     * inflight_resp() per beat.
+     */
+    const uint32_t max_coalesce_bytes;
+    std::vector<uint8_t> coalesceData;
+    std::vector<uint64_t> coalesceMask;
+
+    void issueReads(outputNVDLA& out);
+    void issueLongWrites(outputNVDLA& out);
+    void deliverReadData(PacketPtr pkt, bool sram);
+
 public:
 
     // NVDLA pointers
@@ -248,7 +562,7 @@ public:
     void initNVDLA(bool use_shared_spm);
     void initRTLModel() override;
     void endRTLModel() override;
-    void loadTraceNVDLA(char *ptr);
+    void startNVDLA();
 
     // variables for the NVDLA
     int quiesc_timer;
@@ -268,7 +582,7 @@ public:
 
     const uint8_t * readAXIVariable(uint64_t addr, bool sram, bool timing, bool cacheable, unsigned int size);
     void writeAXI(uint64_t addr, uint8_t data, bool sram, bool timing);
-    void writeAXILong(uint64_t addr, uint32_t length, uint8_t* data, uint64_t mask, bool sram, bool timing, bool cacheable);
+    void writeAXILong(uint64_t addr, uint32_t length, const uint8_t* data, const uint64_t* mask, bool sram, bool timing, bool cacheable);
 
     uint64_t getRealAddr(uint64_t addr, bool sram);
     uint64_t getAddrNVDLA(uint64_t addr, bool sram);
@@ -277,16 +591,27 @@ public:
      */
     void regStats() override;
 
+    DrainState drain() override;
+    void drainResume() override;
+    void serialize(CheckpointOut &cp) const override;
+    void unserialize(CheckpointIn &cp) override;
+
     int prefetch_enable;
     uint32_t pft_threshold;
+    uint32_t dma_pft_threshold;
+    uint32_t pft_lookahead;
+    uint32_t pft_depth;
+    uint32_t pft_max_bw;
 
     uint32_t spm_latency;
     uint32_t spm_line_size;
     uint32_t spm_line_num;
     uint32_t assoc;
+    bool flat_spm;
+    std::unique_ptr<SpmReplacement> spmReplacement;
 
     int dma_enable;
-    DmaReadFifo* dma_rd_engine;
+    DmaNvdla* dma_rd_engine;
     DmaNvdla* dma_wr_engine;
 
     BufferMode buffer_mode;    // control the mode of using embedded SPM / cache, whether as an all-in-one buffer or simply a prefetch buffer
@@ -294,6 +619,42 @@ public:
 
     std::string print_path;
 
+    /**
+     * Writes the AXI_RESP_FAST_IO log of this NVDLA to print_path.<id> on a
+     * host thread, print buffers are swapped with it when they fill up.
+     */
+    std::unique_ptr<AxiLogWriter> axiLog;
+    void flushAxiLog();
+
+    /**
+     * Records the timing requests of this NVDLA (after coalescing), its
+     * DMA fills and their responses to replay_trace.<id>, so that
+     * replayNVDLA can replay its traffic without the RTL.
+     */
+    std::unique_ptr<ReplayTraceWriter> replayLog;
+    void recordRequest(PacketPtr pkt, bool sram);
+
+    /**
+     * Write a load_mem payload of the trace to memory at once, with
+     * functional accesses through the DRAM or SRAM port instead of one
+     * atomic packet per beat.
+     */
+    const bool bulk_load_mem;
+    void loadMemBulk(uint32_t addr, const uint8_t *buf, uint32_t len, bool sram);
+
+    // write the tensors of dump_mem commands to files, they are checked in memory either way
+    const bool write_dump_files;
+
+    // worker threads of the multi-threaded verilator model, 0 if single-threaded
+    const int verilator_threads;
+    // first host cpu to pin worker threads to, accelerator accel_index
+    // takes the verilator_threads cpus from base + accel_index * threads on.
+    // -1 leaves them to the OS
+    const int verilator_cpu_base;
+
+    // how the RTL is reset when a trace is loaded, see ResetMode
+    const uint32_t fast_reset;
+
     void try_get_dma_read_data(uint32_t size);
 };
 
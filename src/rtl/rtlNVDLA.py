@@ -30,6 +30,7 @@
 from m5.params import *
 from m5.proxy import *
 from m5.objects.rtlObject import rtlObject
+from m5.objects.ReplacementPolicies import BaseReplacementPolicy
 
 class rtlNVDLA(rtlObject):
     type = 'rtlNVDLA'
@@ -57,16 +58,52 @@ class rtlNVDLA(rtlObject):
 
     spm_line_size = Param.UInt32(1024, "The minimal granularity to copy data from memory to SPM")
 
+    dma_read_channels = Param.UInt32(0, "Line fills the DMA read engine keeps in flight and completes out of "
+                                        "order, 0 for one per embedded buffer line")
+
     prefetch_enable = Param.UInt32(0, "Whether to issue software prefetch when inflight read queue is under-fed")
 
     pft_threshold = Param.UInt32(16, "the threshold of current inflight memory requests to launch software prefetch")
 
+    dma_pft_threshold = Param.UInt32(8, "Prefetch only while fewer DMA line fills are in flight")
+
+    pft_lookahead = Param.UInt32(1, "Number of upcoming read-only variables (e.g., the weights of the next layers) "
+                                    "prefetched at once, one line per cycle each")
+
+    pft_depth = Param.UInt32(0, "Bytes a read-only variable is prefetched ahead of the reads of the NVDLA, "
+                                "0 for no limit")
+
+    pft_max_bw = Param.UInt32(0, "Stop prefetching while the measured read bandwidth from memory is above this "
+                                 "many bytes per NVDLA cycle, 0 for no limit")
+
     assoc = Param.String("full", "The associativity of the embedded buffer")
+
+    flat_spm = Param.Bool(False, "Lay out each set of the embedded buffer as contiguous data & tag arrays "
+                                 "with an O(1) LRU instead of per-line vectors, a std::list and a std::unordered_map")
+
+    spm_replacement_policy = Param.BaseReplacementPolicy(NULL, "Replacement policy of the embedded buffer, "
+                                                               "LRU if not given (cannot be used with flat_spm)")
     
     id_nvdla = Param.UInt64(0, "id of the NVDLA")
 
+    accel_index = Param.Int(-1, "Index of the NVDLA among the NVDLAs of all the CPUs (id_nvdla restarts on "
+                                "every CPU), names its axilog and replay streams and tags their records, "
+                                "and picks its host cpus (see verilator_cpu_base). -1: id_nvdla")
+
     maxReq = Param.UInt64(4, "Max Request inflight for NVDLA")
 
+    trace_fetch_depth = Param.UInt32(16, "Cache line reads mem_side keeps in flight while loading the trace")
+
+    trace_functional_load = Param.Bool(False, "Read the whole trace at once through a functional port proxy "
+                                              "instead of timing reads on mem_side")
+
+    write_dump_files = Param.Bool(True, "Write the tensors of dump_mem trace commands to the files named in "
+                                        "the trace. They are compared with the golden answer in memory either way")
+
+    bulk_load_mem = Param.Bool(False, "Write load_mem payloads of the trace with functional accesses through "
+                                      "a port proxy instead of one atomic packet per beat. Caches on the "
+                                      "way are updated but do not allocate the lines")
+
     base_addr_dram = Param.UInt64(0xA0000000, "")
 
     base_addr_sram = Param.UInt64(0xB0000000, "")
@@ -75,4 +112,50 @@ class rtlNVDLA(rtlObject):
 
     use_fake_mem = Param.Bool(False, "Whether to use fake memory to simulate")
 
-    print_path = Param.String("", "The path to store output logs of NVDLA")
+    print_path = Param.String("", "The path to store output logs of NVDLA, NVDLA i writes to <print_path>.i "
+                                  "and its tick index to <print_path>.i.idx")
+
+    axilog_compression = Param.Int(1, "zlib level of the blocks of the output log, 0 stores them uncompressed")
+
+    replay_trace = Param.String("", "Record the memory requests of NVDLA i and the responses gating them to "
+                                    "<replay_trace>.i, to be replayed by replayNVDLA without the RTL")
+
+    verilator_threads = Param.UInt32(0, "Worker threads of the verilated model, must match "
+                                        "the library linked in (0: single-threaded library_vcd_opt)")
+
+    verilator_cpu_base = Param.Int(-1, "First host cpu to pin verilator worker threads to, "
+                                       "accelerator i (accel_index) uses [base + i * threads, base + (i + 1) * threads). "
+                                       "-1: no pinning")
+
+    fast_reset = Param.UInt32(0, "How the RTL is reset on every trace and reset command. full(0): clock the "
+                                 "reset sequence; snapshot(1): restore the state after the first reset of the "
+                                 "process; check(2): as snapshot, also run the full reset and check that both "
+                                 "match bit for bit. 1 and 2 need a model verilated with --savable")
+
+    tick_eventq_index = Param.UInt32(0, "Event queue (host thread) to run the RTL model on. 0 keeps it on "
+                                        "the queue of this object, otherwise memory-side work migrates back to "
+                                        "it and root.sim_quantum has to be set")
+
+    idle_skip_threshold = Param.UInt32(0, "Stop ticking the RTL after this many consecutive cycles stalled on "
+                                          "memory and resume on the next response, counting skipped cycles "
+                                          "in nvdla_cycles (0: always tick)")
+
+    checkpoint_layer = Param.UInt32(0, "Exit the simulation loop with \"checkpoint\" once this many layers "
+                                       "(interrupts) of the trace are done, so that a checkpoint of the running "
+                                       "NVDLA can be taken. Needs a model verilated with --savable (0: never)")
+
+    max_coalesce_bytes = Param.UInt32(64, "Largest packet contiguous AXI beats of the same cycle are merged "
+                                          "into, a power of two (64: one packet per beat). Larger than a cache "
+                                          "line only without caches between the NVDLA and memory")
+
+    stats_bw_window = Param.UInt32(10000, "NVDLA cycles per entry of readBytesOverTime / writeBytesOverTime")
+
+    stats_bw_windows = Param.UInt32(100, "Entries of readBytesOverTime / writeBytesOverTime, traffic after the "
+                                         "last window is added to the last entry")
+
+    stats_axi_ids = Param.UInt32(16, "AXI ids with their own read / write latency distribution, larger ids "
+                                     "share the last one")
+
+    stats_latency_max = Param.UInt32(4096, "Largest AXI latency (NVDLA cycles) the distributions have buckets for")
+
+    stats_latency_bucket = Param.UInt32(32, "Bucket size (NVDLA cycles) of the AXI latency distributions")
@@ -43,6 +43,7 @@ rtlObject::rtlObject(const rtlObjectParams &params) :
     enableObject(params.enableRTLObject),
     enableWaveform(params.enableWaveform),
     to_retry_vaddr(0),
+    to_retry_context(0),
     tickEvent([this]{ tick(); }, params.name + " tick"),
     retryTranslateEvent([this]{ retryTranslate(); }, params.name + " retryTranslate"),
     cyclesStat(0)
@@ -96,9 +97,6 @@ rtlObject::CPUSidePort::recvTimingReq(PacketPtr pkt)
             pkt->getSize(),
             pkt->req->getVaddr(),
             pkt->req->getPaddr());
-
-    } else {
-        owner->handleRequest(pkt);
     }
     // Try to handle the request by calling to
     // handleRequest() function to be implemented in
@@ -221,7 +219,7 @@ rtlObject::finishTranslation(WholeTranslationState *state) {
 void
 rtlObject::retryTranslate() {
     printf("retryTranslate at tick = %lu\n", curTick());
-    startTranslate(to_retry_vaddr, 0);
+    startTranslate(to_retry_vaddr, to_retry_context);
 }
 
 void
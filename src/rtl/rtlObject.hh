@@ -247,6 +247,7 @@ protected:
     bool enableWaveform;
 
     Addr to_retry_vaddr;
+    ContextID to_retry_context;
 
     /** The tick event used for scheduling CPU ticks. */
     EventFunctionWrapper tickEvent;
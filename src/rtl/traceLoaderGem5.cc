@@ -21,6 +21,11 @@ TraceLoaderGem5::TraceLoaderGem5(CSBMaster *_csb,
         axi_cvsram = _axi_cvsram;
         _test_passed = 1;
         base_addr = -1;
+        parsed = 0;
+        cmds_done = false;
+        write_dump_files = true;
+        dump_stats = dump_summary();
+        dump_stats.first_mismatch = -1;
     }
 
 void
@@ -35,9 +40,38 @@ TraceLoaderGem5::read_local(int &last, const char *buffer_trace,
     last += nbytes;
 }
 
-void
-TraceLoaderGem5::load(const char *trace) {
-    int last = 0;
+uint32_t
+TraceLoaderGem5::cmd_size(const char *trace, uint32_t pos, uint32_t avail) {
+    uint32_t len, namelen;
+    if (pos + 1 > avail)
+        return 0;
+    switch ((unsigned char)trace[pos]) {
+    case 2:
+    case 6:
+        return 9;
+    case 3:
+        return 13;
+    case 4:
+        if (pos + 9 > avail)
+            return 0;
+        memcpy(&len, trace + pos + 5, 4);
+        if (pos + 9 + len + 4 > avail)
+            return 0;
+        memcpy(&namelen, trace + pos + 9 + len, 4);
+        return 9 + len + 4 + namelen;
+    case 5:
+        if (pos + 9 > avail)
+            return 0;
+        memcpy(&len, trace + pos + 5, 4);
+        return 9 + len;
+    default:    // 1, 7, 0xff, and unknown commands abort below
+        return 1;
+    }
+}
+
+bool
+TraceLoaderGem5::load(const char *trace, uint32_t avail) {
+    int last = parsed;
     unsigned char cmd;
 
 // original
@@ -46,7 +80,11 @@ TraceLoaderGem5::load(const char *trace) {
 #define VERILY_READ(p, n) {\
     read_local(last, (trace), (p), (n));\
 }
-    do {
+    while (!cmds_done) {
+        uint32_t size = cmd_size(trace, parsed, avail);
+        if (size == 0 || parsed + size > avail)
+            break;      // wait for the rest of this command to arrive
+        last = parsed;
         VERILY_READ(&cmd, 1);
 
         switch (cmd) {
@@ -97,6 +135,7 @@ TraceLoaderGem5::load(const char *trace) {
             op.addr = addr;
             op.len = len;
             op.buf = buf;
+            op.buf_len = len;
             op.fname = fname;
             opq.push(op);
             csb->ext_event(TRACE_AXIEVENT);
@@ -120,6 +159,8 @@ TraceLoaderGem5::load(const char *trace) {
             op.addr = addr;
             op.len = len;
             op.buf = buf;
+            op.buf_len = len;
+            op.fname = nullptr;
             opq.push(op);
             csb->ext_event(TRACE_AXIEVENT);
             base_addr = addr&0xF0000000;
@@ -150,9 +191,19 @@ TraceLoaderGem5::load(const char *trace) {
             printf("unknown command %c\n", cmd);
             abort();
         }
-    } while (cmd != 0xFF);
+        parsed = last;
+        cmds_done = cmd == 0xFF;
+    }
 
-    trace_size = last;      // update reg trace size
+    if (cmds_done)
+        trace_size = parsed;    // update reg trace size
+    return cmds_done;
+}
+
+void
+TraceLoaderGem5::reset_load() {
+    parsed = 0;
+    cmds_done = false;
 }
 
 void
@@ -204,29 +255,26 @@ TraceLoaderGem5::axievent(int* waiting_for_gem5_mem) {
         const uint8_t *buf = op.buf;
         printf("AXI: loading (TRACE) memory at 0x%08x, length = %d\n", op.addr, op.len);
         // todo: for use_fake_mem, write to / dump from fake ram
-        for (int pos = 0; pos < op.len; pos += AXI_WIDTH / 8) {
-            axi->wrapper->addLongWriteReq(axi->sram, false, false,
-                                          op.addr + pos,
-                                          (op.len - pos) < AXI_WIDTH / 8 ? (op.len - pos) : AXI_WIDTH / 8,
-                                          buf + pos, 0xffffffffffffffff);
+        if (bulk_load) {
+            bulk_load(op.addr, buf, op.len, axi->sram);
+        } else {
+            for (int pos = 0; pos < op.len; pos += AXI_WIDTH / 8) {
+                axi->wrapper->addLongWriteReq(axi->sram, false, false,
+                                              op.addr + pos,
+                                              (op.len - pos) < AXI_WIDTH / 8 ? (op.len - pos) : AXI_WIDTH / 8,
+                                              buf + pos, 0xffffffffffffffff);
+            }
         }
+        // both paths have copied the payload
+        free((void *)op.buf);
         break;
     }
 
     case AXI_DUMPMEM: {
-        int fd;
-        const uint8_t *buf = op.buf;
-        int matched = 1;
-
         if (!*waiting_for_gem5_mem) {
-            // create the file to dump to
             printf("AXI: dumping memory to %s, length = %d\n", op.fname, op.len);
-            fd = creat(op.fname, 0666);
-            if (!fd) {
-                perror("creat(dumpmem)");
-                break;
-            }
-            close(fd);
+            dump_data.clear();
+            dump_data.reserve(op.len);
 
             // issue memory reading request
             axi->read_for_traceLoaderGem5(op.addr, op.len);
@@ -264,15 +312,9 @@ TraceLoaderGem5::axievent(int* waiting_for_gem5_mem) {
                     op.len -= (AXI_WIDTH / 8);
                 }
 
-                // continue writing the file created above
-                fd = open(op.fname, O_WRONLY | O_APPEND);
-                if (!fd) {
-                    perror("Open file failed.\n");
-                    abort();
-                }
-
-                write(fd, read_response_buffer + (old_op_addr - txn_start_addr), bytes_to_write);
-                close(fd);
+                // keep the tensor in memory, it is checked and written once complete
+                const uint8_t *resp = read_response_buffer + (old_op_addr - txn_start_addr);
+                dump_data.insert(dump_data.end(), resp, resp + bytes_to_write);
 
                 if (op.len <= 0) {
                     if (axi->getRequestsOnFlight() != 0) {
@@ -280,26 +322,7 @@ TraceLoaderGem5::axievent(int* waiting_for_gem5_mem) {
                         abort();
                     }
                     *waiting_for_gem5_mem = 0;
-
-                    // check answer
-                    uint8_t check_byte, bytes_got = 0;
-                    int byte_cnt = 0;
-                    fd = open(op.fname, O_RDONLY);
-                    while (1) {
-                        bytes_got = read(fd, &check_byte, 1);
-                        if (bytes_got == 0)
-                            break;
-                        if (check_byte != *buf && matched) {
-                            printf("Memory dump does not match golden answer at byte %d:exp 0x%02x, got 0x%02x, and maybe others too.\n", byte_cnt, *buf, check_byte);
-                            matched = 0;
-                            _test_passed = 0;
-                        }
-                        buf++;
-                        byte_cnt++;
-                    }
-                    close(fd);
-                    if (matched)
-                        printf("AXI: memory dump matched reference.\n");
+                    check_dump(op);
                 }
             }
         }
@@ -313,6 +336,54 @@ TraceLoaderGem5::axievent(int* waiting_for_gem5_mem) {
         opq.pop();
 }
 
+void
+TraceLoaderGem5::check_dump(const axi_op &op) {
+    const uint8_t *buf = op.buf;
+    size_t len = dump_data.size();
+    const uint8_t *got = dump_data.data();
+
+    dump_stats.dumps++;
+    dump_stats.bytes += len;
+
+    if (memcmp(got, buf, len) == 0) {
+        printf("AXI: memory dump matched reference.\n");
+    } else {
+        // only walk the bytes on a mismatch, a plain loop the compiler vectorizes
+        size_t first = 0;
+        while (got[first] == buf[first])
+            first++;
+        uint64_t mismatches = 0;
+        uint32_t max_error = 0;
+        for (size_t i = first; i < len; i++) {
+            uint32_t error = got[i] > buf[i] ? got[i] - buf[i] : buf[i] - got[i];
+            mismatches += error != 0;
+            max_error = error > max_error ? error : max_error;
+        }
+        printf("Memory dump does not match golden answer at byte %lu:exp 0x%02x, got 0x%02x, "
+               "%lu of %lu bytes differ, max error %u.\n",
+               first, buf[first], got[first], mismatches, len, max_error);
+        _test_passed = 0;
+
+        if (dump_stats.first_mismatch < 0)
+            dump_stats.first_mismatch = first;
+        dump_stats.mismatched_dumps++;
+        dump_stats.mismatch_bytes += mismatches;
+        if (max_error > dump_stats.max_error)
+            dump_stats.max_error = max_error;
+    }
+
+    if (write_dump_files) {
+        int fd = creat(op.fname, 0666);
+        if (fd < 0) {
+            perror("creat(dumpmem)");
+        } else {
+            if (write(fd, got, len) != (ssize_t)len)
+                perror("write(dumpmem)");
+            close(fd);
+        }
+    }
+}
+
 int
 TraceLoaderGem5::test_passed() {
     return _test_passed;
@@ -323,6 +394,64 @@ TraceLoaderGem5::getBaseAddr() {
     return base_addr;
 }
 
+void
+TraceLoaderGem5::save(std::ostream &os) {
+    std::queue<axi_op> q(opq);
+    ckpt_save(os, (uint64_t)q.size());
+    for (; !q.empty(); q.pop()) {
+        const axi_op &op = q.front();
+        ckpt_save(os, op.opcode);
+        ckpt_save(os, op.addr);
+        ckpt_save(os, op.len);
+        ckpt_save(os, op.buf_len);
+        os.write((const char *)op.buf, op.buf_len);
+        ckpt_save(os, std::string(op.fname ? op.fname : ""));
+    }
+
+    ckpt_save(os, base_addr);
+    ckpt_save(os, trace_size);
+    ckpt_save(os, parsed);
+    ckpt_save(os, cmds_done);
+    ckpt_save(os, _test_passed);
+    ckpt_save(os, dump_data);
+    ckpt_save(os, dump_stats);
+    ckpt_save(os, trace_and_rd_log_size);
+}
+
+void
+TraceLoaderGem5::restore(std::istream &is) {
+    for (; !opq.empty(); opq.pop()) {
+        free((void *)opq.front().buf);
+        free((void *)opq.front().fname);
+    }
+
+    uint64_t num_ops = 0;
+    ckpt_restore(is, num_ops);
+    for (uint64_t i = 0; i < num_ops && is; i++) {
+        axi_op op;
+        std::string fname;
+        ckpt_restore(is, op.opcode);
+        ckpt_restore(is, op.addr);
+        ckpt_restore(is, op.len);
+        ckpt_restore(is, op.buf_len);
+        uint8_t *buf = (uint8_t *)malloc(op.buf_len);
+        is.read((char *)buf, op.buf_len);
+        op.buf = buf;
+        ckpt_restore(is, fname);
+        op.fname = op.opcode == AXI_DUMPMEM ? strdup(fname.c_str()) : nullptr;
+        opq.push(op);
+    }
+
+    ckpt_restore(is, base_addr);
+    ckpt_restore(is, trace_size);
+    ckpt_restore(is, parsed);
+    ckpt_restore(is, cmds_done);
+    ckpt_restore(is, _test_passed);
+    ckpt_restore(is, dump_data);
+    ckpt_restore(is, dump_stats);
+    ckpt_restore(is, trace_and_rd_log_size);
+}
+
 } // namespace gem5
 
 
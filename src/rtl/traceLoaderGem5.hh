@@ -14,6 +14,11 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <unistd.h>
+
+#include <functional>
+#include <vector>
+
 #include "axiResponder.hh"
 #include "csbMaster.hh"
 
@@ -31,7 +36,8 @@ class TraceLoaderGem5 {
         uint32_t addr;
         uint32_t len;
         const uint8_t *buf;
-        const char *fname;
+        uint32_t buf_len;       // len changes while a dump is read, this is the size of buf
+        const char *fname;      // nullptr for AXI_LOADMEM
     };
     std::queue<axi_op> opq;
 
@@ -40,11 +46,35 @@ class TraceLoaderGem5 {
 
     uint32_t base_addr;
     uint32_t trace_size;    // this value will be valid after trace->load(), where we find 0xff as the end of trace
+    int parsed;             // bytes of the trace parsed by the previous calls to load()
+    bool cmds_done;         // 0xff has been parsed
+
+    // size of the command at pos, 0 if its header is not within the first avail bytes yet
+    uint32_t cmd_size(const char *trace, uint32_t pos, uint32_t avail);
 
     int _test_passed;
 
+    std::vector<uint8_t> dump_data;     // the tensor of the AXI_DUMPMEM being read
+
+    // compare a completed dump with its golden answer and optionally write it out
+    void check_dump(const axi_op &op);
+
 public:
     uint32_t trace_and_rd_log_size; // this value will be valid right after receiving CPU launch accel pkt
+    // if set, writes a whole load_mem payload to memory at once instead of one addLongWriteReq per beat
+    std::function<void(uint32_t addr, const uint8_t *buf, uint32_t len, bool sram)> bulk_load;
+    // write each dumped tensor to the file named in the trace
+    bool write_dump_files;
+
+    // mismatches of all dumps against their golden answers
+    struct dump_summary {
+        uint64_t dumps;
+        uint64_t bytes;
+        uint64_t mismatched_dumps;
+        uint64_t mismatch_bytes;
+        int64_t first_mismatch;     // byte offset in the first mismatching dump, -1 if none
+        uint64_t max_error;         // largest absolute difference of a byte
+    } dump_stats;
     enum stop_type {
         TRACE_CONTINUE = 0,
         TRACE_AXIEVENT,
@@ -59,14 +89,22 @@ public:
     void read_local(int &last, const char *buffer_trace,
                     void *buffer, unsigned int nbytes);
 
-    void load(const char *fname) ;
+    // parse the commands that are complete within the first avail bytes of the trace,
+    // resuming after the ones parsed by previous calls. Returns true once 0xff was parsed
+    bool load(const char *fname, uint32_t avail = 0xffffffff);
     void load_read_var_log(const char* fname);
+    // start over with a new trace of trace_and_rd_log_size bytes
+    void reset_load();
 
     void axievent(int* waiting_for_gem5_mem);
 
     int test_passed();
 
     uint32_t getBaseAddr();
+
+    // checkpoint of the commands not done yet and the dump being read, see Wrapper_nvdla::save
+    void save(std::ostream &os);
+    void restore(std::istream &is);
 };
 
 } // namespace gem5
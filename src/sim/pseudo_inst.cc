@@ -599,7 +599,7 @@ startaccel(ThreadContext *tc, Addr addr, uint64_t elements, Addr region_mem)
     DPRINTF(PseudoInst,
             "PseudoInst::startaccel(%#x, %d)\n", addr, elements);
 
-    tc->getCpuPtr()->startAccel(addr,elements, region_mem);
+    tc->getCpuPtr()->startAccel(tc, addr, elements, region_mem);
 
 
 }
@@ -616,7 +616,7 @@ startaccelid(ThreadContext *tc, Addr addr, uint64_t elements, Addr region_mem, i
     DPRINTF(PseudoInst,
             "PseudoInst::startaccelid(%#x, %d, %d)\n", addr, elements, accel_id);
 
-    tc->getCpuPtr()->startAccelID(addr, elements, region_mem, accel_id);
+    tc->getCpuPtr()->startAccelID(tc, addr, elements, region_mem, accel_id);
 }
 
 //
@@ -649,5 +649,18 @@ waitaccelid(ThreadContext *tc, int accel_id)
     return tc->getCpuPtr()->waitAccelID(accel_id);
 }
 
+//
+// Blocking version of waitaccelid, the thread is suspended until one of
+// the accelerators sends its finish packet.
+//
+uint64_t
+sleepaccel(ThreadContext *tc, uint64_t accel_mask)
+{
+    DPRINTF(PseudoInst,
+            "PseudoInst::sleepaccel(%#x)\n", accel_mask);
+
+    return tc->getCpuPtr()->sleepAccel(tc, accel_mask);
+}
+
 } // namespace pseudo_inst
 } // namespace gem5
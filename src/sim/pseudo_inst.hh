@@ -98,6 +98,7 @@ void startaccelid(ThreadContext *tc, Addr addr,
                 uint64_t elements, Addr region_mem, int accel_id);
 uint64_t waitaccel(ThreadContext *tc, Addr addr, uint64_t elements);
 uint64_t waitaccelid(ThreadContext *tc, int accel_id);
+uint64_t sleepaccel(ThreadContext *tc, uint64_t accel_mask);
 void m5Syscall(ThreadContext *tc);
 void togglesync(ThreadContext *tc);
 void triggerWorkloadEvent(ThreadContext *tc);
@@ -238,9 +239,9 @@ pseudoInstWork(ThreadContext *tc, uint8_t func, uint64_t &result)
         result = invokeSimcall<ABI, store_ret>(tc, waitaccelid);
         return true;
 
-      case M5OP_RESERVED5:
-        warn("Unimplemented m5 op (%#x)\n", func);
-        return false;
+      case M5OP_SLEEP_ACCEL:
+        result = invokeSimcall<ABI, store_ret>(tc, sleepaccel);
+        return true;
 
       /* dist-gem5 functions */
       case M5OP_DIST_TOGGLE_SYNC: